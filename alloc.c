@@ -0,0 +1,206 @@
+#define _GNU_SOURCE
+#include <malloc.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "alloc.h"
+#include "tokenizer.h"
+
+#ifdef ALLOC_ACCOUNTING
+
+/* Here they are libc's own. */
+#undef malloc
+#undef calloc
+#undef realloc
+#undef strdup
+#undef strndup
+#undef free
+
+/* In front of every counted block. The tag, the constant mixed with the block's address,
+ * comes last: the 8 bytes before a block libc made are its chunk's size, which never
+ * looks like it, and are always there to be read. */
+struct header {
+  size_t size;
+  int slot;
+  char pad[12];
+  uint64_t tag;
+};
+
+#define TAG 0xa110c8eda110c8edULL
+#define SLOTS 64
+
+struct counter {
+  const char *file;
+  uint64_t allocs, frees;
+  uint64_t blocks, bytes, peak; /* live ones, and the most bytes there have been */
+};
+
+static struct counter counters[SLOTS];
+static int nslots;
+
+static int slot_of(int *slot, const char *file) {
+  if (*slot >= 0)
+    return *slot;
+  for (int i = 0; i < nslots; i++)
+    if (strcmp(counters[i].file, file) == 0)
+      return *slot = i;
+  if (nslots == SLOTS)
+    return *slot = SLOTS - 1; /* a file too many shares the last one */
+  counters[nslots].file = file;
+  return *slot = nslots++;
+}
+
+static void *count(struct header *h, size_t size, int slot) {
+  if (h == NULL)
+    return NULL;
+  struct counter *c = &counters[slot];
+  h->size = size;
+  h->slot = slot;
+  h->tag = TAG ^ (uintptr_t) (h + 1);
+  c->allocs++;
+  c->blocks++;
+  c->bytes += size;
+  if (c->bytes > c->peak)
+    c->peak = c->bytes;
+  return h + 1;
+}
+
+/* Reads below a block libc made, which a sanitizer would call an overflow. */
+__attribute__((no_sanitize_address))
+static struct header *ours(void *p) {
+  struct header *h = (struct header *) p - 1;
+  return h->tag == (TAG ^ (uintptr_t) p) ? h : NULL;
+}
+
+static void uncount(struct header *h) {
+  struct counter *c = &counters[h->slot];
+  c->frees++;
+  c->blocks--;
+  c->bytes -= h->size;
+  h->tag = 0;
+}
+
+void *alloc_malloc(size_t size, int *slot, const char *file) {
+  if (size > SIZE_MAX - sizeof(struct header))
+    return NULL;
+  return count(malloc(sizeof(struct header) + size), size, slot_of(slot, file));
+}
+
+void *alloc_calloc(size_t n, size_t size, int *slot, const char *file) {
+  if (size != 0 && n > (SIZE_MAX - sizeof(struct header)) / size)
+    return NULL;
+  return count(calloc(1, sizeof(struct header) + n * size), n * size, slot_of(slot, file));
+}
+
+void *alloc_realloc(void *p, size_t size, int *slot, const char *file) {
+  if (p == NULL)
+    return alloc_malloc(size, slot, file);
+  struct header *h = ours(p);
+  if (h == NULL) {
+    /* libc's block becomes one of ours */
+    void *q = alloc_malloc(size, slot, file);
+    if (q != NULL) {
+      size_t old = malloc_usable_size(p);
+      memcpy(q, p, old < size ? old : size);
+      free(p);
+    }
+    return q;
+  }
+  if (size > SIZE_MAX - sizeof(struct header))
+    return NULL;
+  int owner = h->slot;
+  size_t old = h->size;
+  struct header *moved = realloc(h, sizeof(struct header) + size);
+  if (moved == NULL)
+    return NULL;
+  counters[owner].bytes -= old;
+  counters[owner].blocks--;
+  counters[owner].allocs--;
+  return count(moved, size, owner);
+}
+
+char *alloc_strdup(const char *s, int *slot, const char *file) {
+  size_t n = strlen(s) + 1;
+  char *copy = alloc_malloc(n, slot, file);
+  return copy ? memcpy(copy, s, n) : NULL;
+}
+
+char *alloc_strndup(const char *s, size_t n, int *slot, const char *file) {
+  n = strnlen(s, n);
+  char *copy = alloc_malloc(n + 1, slot, file);
+  if (copy == NULL)
+    return NULL;
+  memcpy(copy, s, n);
+  copy[n] = '\0';
+  return copy;
+}
+
+void alloc_free(void *p) {
+  if (p == NULL)
+    return;
+  struct header *h = ours(p);
+  if (h == NULL) {
+    free(p);
+    return;
+  }
+  uncount(h);
+  free(h);
+}
+
+static long rss_kb(void) {
+  long pages = 0;
+  FILE *f = fopen("/proc/self/statm", "r");
+  if (f != NULL) {
+    if (fscanf(f, "%*d %ld", &pages) != 1)
+      pages = 0;
+    fclose(f);
+  }
+  return pages * (sysconf(_SC_PAGESIZE) / 1024);
+}
+
+int cmd_alloc(struct tokens *tokens) {
+  bool total_only = tokens_get_length(tokens) > 1 && strcmp(tokens_get_token(tokens, 1), "-t") == 0;
+  if (tokens_get_length(tokens) > 1 && !total_only) {
+    fprintf(stderr, "usage: alloc [-t]\n");
+    return 2;
+  }
+  struct counter total = {"total", 0, 0, 0, 0, 0};
+  if (!total_only)
+    printf("%-14s %12s %12s %12s %12s %12s\n", "file", "allocs", "frees", "live", "live bytes",
+        "peak bytes");
+  for (int i = 0; i < nslots; i++) {
+    const struct counter *c = &counters[i];
+    if (!total_only)
+      printf("%-14s %12llu %12llu %12llu %12llu %12llu\n", c->file,
+          (unsigned long long) c->allocs, (unsigned long long) c->frees,
+          (unsigned long long) c->blocks, (unsigned long long) c->bytes,
+          (unsigned long long) c->peak);
+    total.allocs += c->allocs;
+    total.frees += c->frees;
+    total.blocks += c->blocks;
+    total.bytes += c->bytes;
+    total.peak += c->peak;
+  }
+  if (total_only) {
+    printf("blocks=%llu bytes=%llu rss_kb=%ld\n", (unsigned long long) total.blocks,
+        (unsigned long long) total.bytes, rss_kb());
+    return 0;
+  }
+  printf("%-14s %12llu %12llu %12llu %12llu %12s\n", total.file,
+      (unsigned long long) total.allocs, (unsigned long long) total.frees,
+      (unsigned long long) total.blocks, (unsigned long long) total.bytes, "");
+  printf("rss %ld KB\n", rss_kb());
+  return 0;
+}
+
+#else
+
+int cmd_alloc(struct tokens *tokens) {
+  fprintf(stderr, "alloc: the shell was built without ALLOC_ACCOUNTING=1\n");
+  return 1;
+}
+
+#endif
@@ -0,0 +1,46 @@
+#pragma once
+
+/* Allocation accounting, for a build made with make ALLOC_ACCOUNTING=1: every file is
+ * compiled with this header included first, so its malloc(), calloc(), realloc(),
+ * strdup(), strndup() and free() go through the functions below, which count calls,
+ * live blocks and live bytes for the source file they were made in. The alloc builtin
+ * prints the counts. Memory libc allocates itself (asprintf(), open_memstream(),
+ * getcwd(NULL, 0)) isn't counted, and free() hands it back to libc as it is. */
+
+#include <stddef.h>
+
+struct tokens;
+
+/* alloc [-t]: the counts per file and in total, or only the total line. Without
+ * ALLOC_ACCOUNTING there is nothing to print and it fails. */
+int cmd_alloc(struct tokens *tokens);
+
+#ifdef ALLOC_ACCOUNTING
+
+/* What these declare has to be seen before the macros below exist; the files this is
+ * put in front of want the GNU extensions of them. */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <malloc.h>
+#include <stdlib.h>
+#include <string.h>
+
+void *alloc_malloc(size_t size, int *slot, const char *file);
+void *alloc_calloc(size_t n, size_t size, int *slot, const char *file);
+void *alloc_realloc(void *p, size_t size, int *slot, const char *file);
+char *alloc_strdup(const char *s, int *slot, const char *file);
+char *alloc_strndup(const char *s, size_t n, int *slot, const char *file);
+void alloc_free(void *p);
+
+/* Which counters this file's allocations go to, found on the first one. */
+static int alloc_slot __attribute__((unused)) = -1;
+
+#define malloc(size) alloc_malloc(size, &alloc_slot, __FILE__)
+#define calloc(n, size) alloc_calloc(n, size, &alloc_slot, __FILE__)
+#define realloc(p, size) alloc_realloc(p, size, &alloc_slot, __FILE__)
+#define strdup(s) alloc_strdup(s, &alloc_slot, __FILE__)
+#define strndup(s, n) alloc_strndup(s, n, &alloc_slot, __FILE__)
+#define free(p) alloc_free(p)
+
+#endif
@@ -0,0 +1,394 @@
+#define _GNU_SOURCE
+#include <ctype.h>
+#include <limits.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "arith.h"
+#include "expand.h"
+#include "vars.h"
+
+/* A variable's value is itself an expression; this deep and no further (x=x). */
+#define ARITH_MAX_DEPTH 16
+
+/* A recursive descent parser that computes as it goes. */
+struct arith {
+  const char *expr;
+  const char *p;    /* where parsing is */
+  bool skip;        /* the side of && || ?: not taken: no assignments, no errors */
+  bool failed;
+  int depth;
+};
+
+static const struct {
+  const char *op;
+  int prec;
+} binops[] = {
+  /* two-byte operators first, so < doesn't take << or <= */
+  {"||", 1}, {"&&", 2}, {"==", 6}, {"!=", 6}, {"<=", 7}, {">=", 7}, {"<<", 8}, {">>", 8},
+  {"|", 3}, {"^", 4}, {"&", 5}, {"<", 7}, {">", 7}, {"+", 9}, {"-", 9}, {"*", 10}, {"/", 10},
+  {"%", 10},
+};
+
+static const char *const assignops[] = {
+  "<<=", ">>=", "*=", "/=", "%=", "+=", "-=", "&=", "^=", "|=", "=",
+};
+
+static long long eval(struct arith *a);
+static long long comma(struct arith *a);
+static long long assign(struct arith *a);
+
+static void fail(struct arith *a, const char *what) {
+  if (a->failed)
+    return;
+  a->failed = true;
+  if (*a->p != '\0')
+    fprintf(stderr, "%s: %s (at \"%s\")\n", a->expr, what, a->p);
+  else
+    fprintf(stderr, "%s: %s\n", a->expr, what);
+}
+
+static void skip_space(struct arith *a) {
+  while (isspace((unsigned char) *a->p))
+    a->p++;
+}
+
+static bool is_name_start(char c) {
+  return isalpha((unsigned char) c) || c == '_';
+}
+
+static size_t name_length(const char *s) {
+  size_t n = 0;
+  if (is_name_start(s[0]))
+    while (isalnum((unsigned char) s[n]) || s[n] == '_')
+      n++;
+  return n;
+}
+
+/* The number at *s in base 10, 0x16, 0 (8) or base#, moving *s past it; false if it
+ * has a digit its base doesn't. */
+static bool parse_number(const char **s, long long *value) {
+  const char *p = *s;
+  int base = 10;
+  if (p[0] == '0' && (p[1] == 'x' || p[1] == 'X')) {
+    base = 16;
+    p += 2;
+  } else if (p[0] == '0') {
+    base = 8;
+  } else {
+    char *hash;
+    long b = strtol(p, &hash, 10);
+    if (*hash == '#') {
+      if (b < 2 || b > 64)
+        return false;
+      base = b;
+      p = hash + 1;
+    }
+  }
+  unsigned long long v = 0;
+  const char *start = p;
+  for (;; p++) {
+    int d;
+    if (isdigit((unsigned char) *p))
+      d = *p - '0';
+    else if (*p >= 'a' && *p <= 'z')
+      d = *p - 'a' + 10;
+    else if (*p >= 'A' && *p <= 'Z')
+      d = base <= 36 ? *p - 'A' + 10 : *p - 'A' + 36;
+    else if (*p == '@' && base > 36)
+      d = 62;
+    else if (*p == '_' && base > 36)
+      d = 63;
+    else
+      break;
+    if (d >= base)
+      return false;
+    v = v * base + d;
+  }
+  if (p == start && base != 8)
+    return false;
+  *value = (long long) v;
+  *s = p;
+  return true;
+}
+
+static long long var_value(struct arith *a, const char *name) {
+  const char *value = vars_get(name);
+  if (value == NULL || *value == '\0')
+    return 0;
+  const char *p = value;
+  long long n;
+  bool negative = *p == '-';
+  p += negative || *p == '+';
+  if (isdigit((unsigned char) *p) && parse_number(&p, &n) && *p == '\0')
+    return negative ? (long long) (0ULL - n) : n;
+  if (a->depth == ARITH_MAX_DEPTH) {
+    fail(a, "expression recursion too deep");
+    return 0;
+  }
+  struct arith inner = {value, value, a->skip, false, a->depth + 1};
+  n = eval(&inner);
+  a->failed |= inner.failed;
+  return n;
+}
+
+static void var_store(struct arith *a, const char *name, long long value) {
+  if (a->skip || a->failed)
+    return;
+  char number[24];
+  snprintf(number, sizeof(number), "%lld", value);
+  if (vars_set(name, number, 0) == -1) {
+    fprintf(stderr, "%s: readonly variable\n", name);
+    a->failed = true;
+  }
+}
+
+/* a op b as C computes it, but wrapping around on overflow instead of trapping. */
+static long long apply(struct arith *a, const char *op, long long l, long long r) {
+  unsigned long long ul = l, ur = r;
+  switch (op[0]) {
+  case '+': return (long long) (ul + ur);
+  case '-': return (long long) (ul - ur);
+  case '*': return (long long) (ul * ur);
+  case '/':
+  case '%':
+    if (r == 0) {
+      if (!a->skip)
+        fail(a, "division by 0");
+      return 0;
+    }
+    if (l == LLONG_MIN && r == -1)
+      return op[0] == '/' ? l : 0;
+    return op[0] == '/' ? l / r : l % r;
+  case '<':
+    if (op[1] == '<')
+      return (long long) (ul << (r & 63));
+    return op[1] == '=' ? l <= r : l < r;
+  case '>':
+    if (op[1] == '>')
+      return l >> (r & 63);
+    return op[1] == '=' ? l >= r : l > r;
+  case '=': return l == r;
+  case '!': return l != r;
+  case '&': return l & r;
+  case '^': return l ^ r;
+  case '|': return l | r;
+  }
+  return 0;
+}
+
+static long long primary(struct arith *a) {
+  skip_space(a);
+  long long value = 0;
+  if (*a->p == '(') {
+    a->p++;
+    value = comma(a);
+    skip_space(a);
+    if (*a->p != ')') {
+      fail(a, "missing )");
+      return 0;
+    }
+    a->p++;
+    return value;
+  }
+  if (isdigit((unsigned char) *a->p)) {
+    if (!parse_number(&a->p, &value) || isalnum((unsigned char) *a->p))
+      fail(a, "bad number");
+    return value;
+  }
+  size_t n = name_length(a->p);
+  if (n == 0) {
+    fail(a, "operand expected");
+    return 0;
+  }
+  char name[n + 1];
+  memcpy(name, a->p, n);
+  name[n] = '\0';
+  a->p += n;
+  value = var_value(a, name);
+  skip_space(a);
+  if ((a->p[0] == '+' || a->p[0] == '-') && a->p[1] == a->p[0]) {
+    var_store(a, name, value + (a->p[0] == '+' ? 1 : -1));
+    a->p += 2;
+  }
+  return value;
+}
+
+static long long unary(struct arith *a) {
+  skip_space(a);
+  char c = *a->p;
+  if ((c == '+' || c == '-') && a->p[1] == c) {
+    const char *after = a->p + 2;
+    while (isspace((unsigned char) *after))
+      after++;
+    size_t n = name_length(after);
+    if (n > 0) {
+      char name[n + 1];
+      memcpy(name, after, n);
+      name[n] = '\0';
+      a->p = after + n;
+      long long value = var_value(a, name) + (c == '+' ? 1 : -1);
+      var_store(a, name, value);
+      return value;
+    }
+  }
+  if (c == '+' || c == '-' || c == '!' || c == '~') {
+    a->p++;
+    long long value = unary(a);
+    return c == '-' ? (long long) (0ULL - value) : c == '!' ? !value : c == '~' ? ~value : value;
+  }
+  return primary(a);
+}
+
+/* The binary operator at p, -1 if there's none; an assignment like += isn't one. */
+static int binop(struct arith *a) {
+  skip_space(a);
+  for (size_t k = 0; k < sizeof(binops) / sizeof(binops[0]); k++) {
+    size_t n = strlen(binops[k].op);
+    if (strncmp(a->p, binops[k].op, n) != 0)
+      continue;
+    if (a->p[n] == '=' && binops[k].prec != 6 && strcmp(binops[k].op, "<=") != 0 &&
+        strcmp(binops[k].op, ">=") != 0)
+      return -1;
+    return k;
+  }
+  return -1;
+}
+
+/* Operators of precedence min and up, left to right. */
+static long long binary(struct arith *a, int min) {
+  long long left = unary(a);
+  int k;
+  while (!a->failed && (k = binop(a)) >= 0 && binops[k].prec >= min) {
+    const char *op = binops[k].op;
+    a->p += strlen(op);
+    if (strcmp(op, "&&") == 0 || strcmp(op, "||") == 0) {
+      bool skip = a->skip, decided = (op[0] == '&') == !left;
+      a->skip |= decided;
+      long long right = binary(a, binops[k].prec + 1);
+      a->skip = skip;
+      left = decided ? op[0] == '|' : right != 0;
+    } else {
+      left = apply(a, op, left, binary(a, binops[k].prec + 1));
+    }
+  }
+  return left;
+}
+
+static long long ternary(struct arith *a) {
+  long long cond = binary(a, 1);
+  skip_space(a);
+  if (*a->p != '?' || a->failed)
+    return cond;
+  a->p++;
+  bool skip = a->skip;
+  a->skip = skip || !cond;
+  long long then = comma(a);
+  skip_space(a);
+  if (*a->p != ':') {
+    fail(a, "missing :");
+    return 0;
+  }
+  a->p++;
+  a->skip = skip || cond;
+  long long otherwise = ternary(a);
+  a->skip = skip;
+  return cond ? then : otherwise;
+}
+
+static long long assign(struct arith *a) {
+  skip_space(a);
+  size_t n = name_length(a->p);
+  const char *op = a->p + n;
+  while (n > 0 && isspace((unsigned char) *op))
+    op++;
+  for (size_t k = 0; n > 0 && k < sizeof(assignops) / sizeof(assignops[0]); k++) {
+    size_t len = strlen(assignops[k]);
+    if (strncmp(op, assignops[k], len) != 0 || (len == 1 && op[1] == '='))
+      continue;
+    char name[n + 1];
+    memcpy(name, a->p, n);
+    name[n] = '\0';
+    a->p = op + len;
+    long long value = assign(a);
+    if (len > 1) {
+      char bin[3] = {assignops[k][0], len == 3 ? assignops[k][1] : '\0', '\0'};
+      value = apply(a, bin, var_value(a, name), value);
+    }
+    var_store(a, name, value);
+    return value;
+  }
+  return ternary(a);
+}
+
+static long long comma(struct arith *a) {
+  long long value = assign(a);
+  skip_space(a);
+  while (*a->p == ',' && !a->failed) {
+    a->p++;
+    value = assign(a);
+    skip_space(a);
+  }
+  return value;
+}
+
+static long long eval(struct arith *a) {
+  skip_space(a);
+  if (*a->p == '\0')
+    return 0; /* $(( )) is 0 */
+  long long value = comma(a);
+  skip_space(a);
+  if (*a->p != '\0')
+    fail(a, "syntax error");
+  return value;
+}
+
+int arith_eval(const char *expr, long long *result) {
+  struct arith a = {expr, expr, false, false, 0};
+  *result = eval(&a);
+  return a.failed ? -1 : 0;
+}
+
+size_t arith_command_words(struct tokens *tokens, size_t i) {
+  size_t len = tokens_get_length(tokens);
+  if (i >= len || strncmp(tokens_get_raw(tokens, i), "((", 2) != 0)
+    return 0;
+  for (size_t j = i; j < len; j++) {
+    const char *raw = tokens_get_raw(tokens, j);
+    size_t n = strlen(raw);
+    if (n >= 2 && strcmp(raw + n - 2, "))") == 0 && (j > i || n >= 4))
+      return j - i + 1;
+  }
+  return 0;
+}
+
+char *arith_command_text(struct tokens *tokens, size_t i, size_t n) {
+  size_t size = 1;
+  for (size_t j = i; j < i + n; j++)
+    size += strlen(tokens_get_raw(tokens, j)) + 1;
+  char *text = malloc(size), *o = text;
+  for (size_t j = i; j < i + n; j++) {
+    const char *raw = tokens_get_raw(tokens, j);
+    size_t len = strlen(raw);
+    if (j == i) {
+      raw += 2;
+      len -= 2;
+    }
+    if (j == i + n - 1)
+      len -= 2;
+    memcpy(o, raw, len);
+    o += len;
+    *o++ = ' ';
+  }
+  *o = '\0';
+  return text;
+}
+
+int arith_command(const char *text, bool literal) {
+  char *expanded = literal ? NULL : expand_string(text);
+  long long value;
+  int rc = arith_eval(expanded ? expanded : text, &value);
+  free(expanded);
+  return rc == -1 || value == 0 ? 1 : 0;
+}
@@ -0,0 +1,20 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "tokenizer.h"
+
+/* Evaluates expr (already expanded) as a C integer expression in 64 bits: numbers
+ * (0x hex, 0 octal, base#digits), variables by name, assignments and ++/--, ?:, and
+ * the C operators with C precedence. Returns -1 after a message on an error. */
+int arith_eval(const char *expr, long long *result);
+
+/* How many words the (( ... )) command starting at word i takes, 0 if none starts there. */
+size_t arith_command_words(struct tokens *tokens, size_t i);
+
+/* The expression of the n words of a (( ... )) command at word i, as written; malloc()ed. */
+char *arith_command_text(struct tokens *tokens, size_t i, size_t n);
+
+/* The status of (( expr )) for text, expanded first unless literal: 0 if the value is
+ * not 0, 1 if it is or expr is wrong. */
+int arith_command(const char *text, bool literal);
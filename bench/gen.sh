@@ -0,0 +1,97 @@
+#!/bin/sh
+# Writes the benchmark workloads into DIR.
+#
+# usage: gen.sh DIR [SCALE]
+#
+# Every workload is a plain script that ./shell, dash and bash all accept
+# on stdin (one command list per line, no loops but in loops.sh), next to a
+# NAME.count file holding the number of simple commands it runs.  Output is fully
+# deterministic for a given SCALE so runs can be compared across machines.
+
+set -e
+
+dir=$1
+scale=${2:-1}
+if [ -z "$dir" ]; then
+  echo "usage: $0 DIR [SCALE]" >&2
+  exit 2
+fi
+mkdir -p "$dir"
+dir=$(cd "$dir" && pwd)
+
+# Synthetic application log used by the pipeline and redirect workloads.
+awk -v n=$((2000 * scale)) 'BEGIN {
+  split("INFO INFO INFO WARN ERROR DEBUG", lvl, " ");
+  split("auth db cache http queue worker", mod, " ");
+  for (i = 0; i < n; i++)
+    printf "2018-03-%02d 12:%02d:%02d %s %s request=%d took=%dms\n",
+        i % 28 + 1, i % 60, (i * 7) % 60, lvl[i % 6 + 1], mod[(i * 5) % 6 + 1],
+        i, (i * 37) % 1000;
+}' > "$dir/app.log"
+
+# Tight loop of builtins: cd and pwd, unrolled.
+awk -v n=$((5000 * scale)) 'BEGIN {
+  for (i = 0; i < n; i++) print (i % 2 ? "pwd" : "cd /");
+}' > "$dir/builtins.sh"
+echo $((5000 * scale)) > "$dir/builtins.count"
+
+# Many short external commands.
+awk -v n=$((500 * scale)) 'BEGIN {
+  split("true;ls /;date +%s;echo hello;uname -s", c, ";");
+  for (i = 0; i < n; i++) print c[i % 5 + 1];
+}' > "$dir/externals.sh"
+echo $((500 * scale)) > "$dir/externals.count"
+
+# Deep && / || chains, 16 commands per line.
+awk -v n=$((40 * scale)) 'BEGIN {
+  for (i = 0; i < n; i++) {
+    line = "true";
+    for (j = 1; j < 16; j++)
+      line = line (j % 4 == 3 ? " || false" : " && true");
+    print line;
+  }
+}' > "$dir/andor.sh"
+echo $((40 * scale * 16)) > "$dir/andor.count"
+
+# Long pipelines over the log, 7 stages per line.
+awk -v n=$((40 * scale)) -v logfile="$dir/app.log" 'BEGIN {
+  split("ERROR WARN INFO DEBUG", lvl, " ");
+  for (i = 0; i < n; i++)
+    printf "cat %s | grep %s | cut -d \" \" -f 5 | sort | uniq -c | sort -rn | head -n 3\n",
+        logfile, lvl[i % 4 + 1];
+}' > "$dir/pipeline.sh"
+echo $((40 * scale * 7)) > "$dir/pipeline.count"
+
+# Redirect-heavy log processing: filter, append, sort and count via files.
+awk -v n=$((100 * scale)) -v d="$dir" 'BEGIN {
+  split("ERROR WARN INFO DEBUG", lvl, " ");
+  for (i = 0; i < n; i++) {
+    printf "grep %s < %s/app.log > %s/level.out\n", lvl[i % 4 + 1], d, d;
+    printf "cut -d \" \" -f 5 < %s/level.out >> %s/modules.out\n", d, d;
+    printf "sort < %s/modules.out > %s/modules.sorted\n", d, d;
+    printf "wc -l < %s/modules.sorted >> %s/counts.out\n", d, d;
+  }
+}' > "$dir/redirect.sh"
+echo $((100 * scale * 4)) > "$dir/redirect.count"
+
+# Interpreter overhead: nested for loops whose bodies are a case and builtins,
+# 3 commands per iteration and nothing forked.
+awk -v n=$((100 * scale)) 'BEGIN {
+  inner = "0";
+  for (j = 1; j < 100; j++)
+    inner = inner " " j;
+  outer = "0";
+  for (i = 1; i < n; i++)
+    outer = outer " " i;
+  print "for i in " outer;
+  print "do";
+  print "  for j in " inner "; do";
+  print "    case $j in";
+  print "      *0) X=$i$j ;;";
+  print "      *) : ;;";
+  print "    esac";
+  print "    true";
+  print "  done";
+  print "done";
+}' > "$dir/loops.sh"
+echo $((100 * scale * 100 * 3)) > "$dir/loops.count"
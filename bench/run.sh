@@ -0,0 +1,62 @@
+#!/bin/sh
+# Runs the workload suite under ./shell, dash and bash and prints a table.
+#
+# usage: run.sh [-s SCALE] [-r REPEAT] [WORKLOAD...]
+#
+# Each workload is fed to every shell on stdin REPEAT times and the fastest
+# run is reported.  Shells that are not installed are skipped.  Columns:
+#   cmds      simple commands in the script
+#   cmds/s    cmds divided by wall time
+#   wall/user/sys   seconds, including every child the shell waited for
+#   maxrss    peak resident set size in KiB (largest of shell and children)
+
+set -e
+
+here=$(cd "$(dirname "$0")" && pwd)
+root=$(dirname "$here")
+scale=1
+repeat=3
+while getopts s:r: opt; do
+  case $opt in
+    s) scale=$OPTARG ;;
+    r) repeat=$OPTARG ;;
+    *) echo "usage: $0 [-s SCALE] [-r REPEAT] [WORKLOAD...]" >&2; exit 2 ;;
+  esac
+done
+shift $((OPTIND - 1))
+workloads=${*:-"builtins externals andor pipeline redirect loops"}
+
+[ -x "$root/shell" ] || make -C "$root" shell >/dev/null
+[ -x "$here/measure" ] || make -C "$root" bench/measure >/dev/null
+
+work=$(mktemp -d "${TMPDIR:-/tmp}/shbench.XXXXXX")
+trap 'rm -rf "$work"' EXIT INT TERM
+sh "$here/gen.sh" "$work" "$scale"
+
+shells="$root/shell"
+for s in dash bash; do
+  if command -v $s >/dev/null 2>&1; then
+    shells="$shells $(command -v $s)"
+  fi
+done
+
+printf "%-10s %-6s %7s %10s %9s %9s %9s %9s\n" \
+    workload shell cmds cmds/s wall user sys maxrss
+for w in $workloads; do
+  count=$(cat "$work/$w.count")
+  for sh in $shells; do
+    best=
+    i=0
+    while [ $i -lt "$repeat" ]; do
+      rm -f "$work"/*.out "$work"/*.sorted
+      r=$(cd "$work" && "$here/measure" "$work/$w.sh" "$sh")
+      best=$(printf "%s\n%s\n" "$best" "$r" | awk 'NF { print }' | sort -n | head -n 1)
+      i=$((i + 1))
+    done
+    echo "$best" | awk -v w="$w" -v s="$(basename "$sh")" -v c="$count" '{
+      printf "%-10s %-6s %7d %10.0f %9.3f %9.3f %9.3f %9d%s\n",
+          w, s, c, c / ($1 > 0 ? $1 : 1e-9), $1, $2, $3, $4,
+          ($5 != 0 ? "  (exit " $5 ")" : "");
+    }'
+  done
+done
@@ -0,0 +1,130 @@
+#!/bin/sh
+# Feeds an allocation-counting shell a long mixed script and fails if its live
+# allocations or its RSS keep growing.
+#
+# usage: soak.sh [-n COMMANDS] [-c CHECKPOINTS] [SHELL]
+#
+# SHELL (bench/shell-alloc, from make soak) runs the same chunk of commands over
+# and over -- builtins, assignments, expansions, arithmetic, functions, loops,
+# case, test and [[ ]], read and mapfile from here-documents, command
+# substitution, groups, subshells, pipelines, redirections, a few programs --
+# until COMMANDS simple commands have run (1000000), and prints 'alloc -t' at
+# CHECKPOINTS points along the way (50).  The first fifth is warm-up: tables
+# grow and buffers reach their size there.  After it, the live blocks in the
+# second half may not go past the most seen in the first half by more than
+# BLOCK_SLACK, nor RSS by more than RSS_SLACK_KB.
+
+set -e
+
+here=$(cd "$(dirname "$0")" && pwd)
+commands=1000000
+checkpoints=50
+while getopts n:c: opt; do
+  case $opt in
+    n) commands=$OPTARG ;;
+    c) checkpoints=$OPTARG ;;
+    *) echo "usage: $0 [-n COMMANDS] [-c CHECKPOINTS] [SHELL]" >&2; exit 2 ;;
+  esac
+done
+shift $((OPTIND - 1))
+shell=${1:-$here/shell-alloc}
+BLOCK_SLACK=${BLOCK_SLACK:-64}
+RSS_SLACK_KB=${RSS_SLACK_KB:-1024}
+
+if ! echo 'alloc -t' | "$shell" 2>/dev/null | grep -q '^blocks='; then
+  echo "$0: $shell does not count allocations (make soak builds one that does)" >&2
+  exit 2
+fi
+
+tmp=$(mktemp -d)
+trap 'rm -rf "$tmp"' EXIT
+
+# One chunk, and about how many simple commands it runs (loop conditions included).
+per_chunk=1000
+cat > "$tmp/chunk" <<'CHUNK'
+c=$((c + 1)); s=""; n=0
+while (( n < 100 )); do v=$n; s="$s$n"; (( n++ )); [ "$v" -ge 0 ]; done
+i=0; while [ $i -lt 120 ]; do i=$((i + 1)); t="${s:-x}"; done
+for w in alpha beta gamma delta; do case $w in a*) k=1;; g*) k=3;; *) k=2;; esac; echo "$w ${k:-0} $((k * 2)) ${#w}"; done > /dev/null
+for j in 1 2 3 4 5 6 7 8 9 10 11 12 13 14 15 16 17 18 19 20; do f $j 2 3; done > /dev/null
+read -r line rest <<EOF
+first $c line with words
+EOF
+mapfile -t arr <<EOF
+one
+two $c
+three
+EOF
+echo "${arr[@]} ${#arr[@]} ${arr[1]}" > /dev/null
+y=$(echo sub $c); z=`pwd`
+[[ $y == s* && -d / && $c -gt 0 ]] && test -f /etc/passwd
+{ echo a; printf '%s-%d\n' b $c; } > /dev/null
+echo /etc/pass* /usr/*bin > /dev/null
+cd /tmp; cd /; pwd > /dev/null; type ls > /dev/null
+export SOAK_$((c % 20))=v$c; unset SOAK_$(((c + 10) % 20))
+true && false || :
+( v=1; echo $v ) > /dev/null
+echo a b c | cat > /dev/null
+/bin/true
+alloc -t
+CHUNK
+# The functions the chunk calls.
+cat > "$tmp/prelude" <<'PRELUDE'
+c=0
+f() { local a=$1; b=$(($2 + $3 + a)); printf '%s %d\n' "$a" "$b"; return 0; }
+PRELUDE
+
+chunks=$(((commands + per_chunk - 1) / per_chunk))
+every=$(((chunks + checkpoints - 1) / checkpoints))
+{
+  cat "$tmp/prelude"
+  k=0
+  while [ $k -lt "$chunks" ]; do
+    k=$((k + 1))
+    if [ $((k % every)) -eq 0 ] || [ $k -eq "$chunks" ]; then
+      cat "$tmp/chunk"
+    else
+      grep -v '^alloc -t$' "$tmp/chunk"
+    fi
+  done
+} > "$tmp/script"
+
+echo "soak: $((chunks * per_chunk)) commands in $chunks chunks, $shell"
+start=$(date +%s)
+"$shell" < "$tmp/script" > "$tmp/out"
+echo "soak: done in $(($(date +%s) - start))s"
+
+awk -v block_slack="$BLOCK_SLACK" -v rss_slack="$RSS_SLACK_KB" '
+  /^blocks=/ {
+    split($0, f, /[= ]/)
+    n++; blocks[n] = f[2]; bytes[n] = f[4]; rss[n] = f[6]
+  }
+  END {
+    if (n < 5) { print "soak: only " n " checkpoints"; exit 1 }
+    warm = int(n / 5); mid = warm + int((n - warm) / 2)
+    for (i = warm + 1; i <= n; i++) {
+      if (i <= mid) {
+        if (blocks[i] > max_blocks) max_blocks = blocks[i]
+        if (rss[i] > max_rss) max_rss = rss[i]
+      } else {
+        if (blocks[i] > late_blocks) late_blocks = blocks[i]
+        if (rss[i] > late_rss) late_rss = rss[i]
+      }
+    }
+    printf "%10s %10s %10s\n", "blocks", "bytes", "rss KB"
+    for (i = 1; i <= n; i += (n > 10 ? int(n / 10) : 1))
+      printf "%10d %10d %10d\n", blocks[i], bytes[i], rss[i]
+    printf "%10d %10d %10d  (last)\n", blocks[n], bytes[n], rss[n]
+    failed = 0
+    if (late_blocks > max_blocks + block_slack) {
+      printf "soak: FAIL: live blocks grew from %d to %d\n", max_blocks, late_blocks
+      failed = 1
+    }
+    if (late_rss > max_rss + rss_slack) {
+      printf "soak: FAIL: RSS grew from %d KB to %d KB\n", max_rss, late_rss
+      failed = 1
+    }
+    if (!failed)
+      printf "soak: ok, %d live blocks at most, RSS at most %d KB\n", late_blocks, late_rss
+    exit failed
+  }' "$tmp/out"
@@ -0,0 +1,142 @@
+/* Tokenizer microbenchmark with a differential check of the scanners.
+ *
+ * usage: tokbench [-n ITERATIONS] [-f FUZZ_CASES]
+ *
+ * First tokenizes FUZZ_CASES random lines (biased towards quotes,
+ * backslashes and whitespace at every alignment) with each scanner the CPU
+ * supports and fails if any word list differs from the scalar one.  Then it
+ * times tokenize() per scanner over a corpus of short interactive lines and
+ * one of long generated-script lines and prints MB/s. */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "../tokenizer.h"
+
+static const char *scanner_names[] = {"auto", "scalar", "sse2", "avx2"};
+
+static unsigned long long rng_state = 0x9e3779b97f4a7c15ULL;
+
+static unsigned int rng(void) {
+  rng_state ^= rng_state << 13;
+  rng_state ^= rng_state >> 7;
+  rng_state ^= rng_state << 17;
+  return (unsigned int) rng_state;
+}
+
+static void random_line(char *buf, size_t len) {
+  static const char alphabet[] = " \t\n\v\f\r'\"\\abcxyz/._-=$|&<>()`09\x80\xff";
+  /* Openers of substitutions, which tokenize() keeps whole up to their end. */
+  static const char *openers[] = {"$(", "<(", ">(", "\\$(", "$((", "`"};
+  for (size_t i = 0; i < len; i++) {
+    /* Mostly plain runs of varying length so every vector offset is hit. */
+    unsigned int r = rng() % 32;
+    if (r < 24) {
+      buf[i] = 'a' + rng() % 26;
+    } else if (r < 30) {
+      buf[i] = alphabet[rng() % (sizeof(alphabet) - 1)];
+    } else {
+      const char *op = openers[rng() % (sizeof(openers) / sizeof(openers[0]))];
+      for (; *op && i < len; op++)
+        buf[i++] = *op;
+      i--;
+    }
+  }
+  buf[len] = '\0';
+}
+
+/* Returns 1 when both tokenizations produced the same words. */
+static int same_tokens(struct tokens *a, struct tokens *b) {
+  if (tokens_get_length(a) != tokens_get_length(b))
+    return 0;
+  for (size_t i = 0; i < tokens_get_length(a); i++)
+    if (strcmp(tokens_get_token(a, i), tokens_get_token(b, i)) != 0)
+      return 0;
+  return 1;
+}
+
+static int fuzz(int cases) {
+  char line[1024];
+  for (int c = 0; c < cases; c++) {
+    random_line(line, rng() % 200);
+    tokens_set_scanner(TOKENS_SCAN_SCALAR);
+    struct tokens *expected = tokenize(line);
+    for (int s = TOKENS_SCAN_SSE2; s <= TOKENS_SCAN_AVX2; s++) {
+      if (tokens_set_scanner(s) != 0)
+        continue;
+      struct tokens *got = tokenize(line);
+      if (!same_tokens(expected, got)) {
+        fprintf(stderr, "tokbench: %s scanner differs from scalar on case %d: \"%s\"\n",
+            scanner_names[s], c, line);
+        return 1;
+      }
+      tokens_destroy(got);
+    }
+    tokens_destroy(expected);
+  }
+  return 0;
+}
+
+/* Typical interactive lines: many short words. */
+static const char *short_corpus[] = {
+  "cat /var/log/application/server-2018-03-14.log | grep -v healthcheck | sort | uniq -c",
+  "ls -la /usr/local/share/applications && echo \"listing finished successfully\"",
+  "gcc -g -Wall -std=gnu99 -c tokenizer.c -o tokenizer.o",
+  "grep ERROR < /srv/logs/payments/worker.log >> /srv/reports/errors-today.txt",
+  "export JAVA_OPTS='-Xmx4096m -XX:+UseG1GC -Dfile.encoding=UTF-8'",
+  "cd /home/deploy/releases/20180314120000/current/config",
+  "rsync --archive --compress --delete /srv/build/artifacts/ backup:/srv/mirror/",
+  "echo some\\ escaped\\ words \"and a quoted one\" 'plus single quotes'",
+};
+
+/* Generated-script lines: long paths, tokens and quoted payloads. */
+static const char *long_corpus[] = {
+  "curl -H Authorization:Bearer.eyJhbGciOiJSUzI1NiIsInR5cCI6IkpXVCJ9.eyJpc3MiOiJodHRwczovL2F1dGgu"
+  "ZXhhbXBsZS5jb20vIiwic3ViIjoic2VydmljZS1hY2NvdW50LWJhdGNoLXdvcmtlci0wMDEiLCJhdWQiOiJwYXltZW50cy"
+  "1hcGkiLCJleHAiOjE1MjEwMzY4MDB9 https://payments.internal.example.com/api/v2/settlements/2018-03-14",
+  "psql -c \"INSERT INTO audit_log(service,event,payload)VALUES('settlement-worker','batch_completed',"
+  "'{processed:182734,failed:12,duration_ms:918273,source:/srv/incoming/2018/03/14/batch-0007.csv}')\"",
+  "/opt/toolchains/gcc-7.3.0/libexec/gcc/x86_64-pc-linux-gnu/7.3.0/cc1plus -quiet -I/srv/build/include/"
+  "third_party/protobuf-3.5.1/src -I/srv/build/out/gen/services/payments/settlement/proto",
+};
+
+static void run_corpus(const char *label, const char **corpus, size_t ncorpus, long iterations) {
+  size_t bytes = 0;
+  for (size_t i = 0; i < ncorpus; i++)
+    bytes += strlen(corpus[i]);
+
+  for (int s = TOKENS_SCAN_SCALAR; s <= TOKENS_SCAN_AVX2; s++) {
+    if (tokens_set_scanner(s) != 0) {
+      printf("%-6s %-7s unsupported on this CPU\n", label, scanner_names[s]);
+      continue;
+    }
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    for (long it = 0; it < iterations; it++)
+      tokens_destroy(tokenize(corpus[it % ncorpus]));
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double secs = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) / 1e9;
+    double total = (double) bytes * iterations / ncorpus;
+    printf("%-6s %-7s %8.1f MB/s %8.0f ns/line\n", label, scanner_names[s],
+        total / secs / 1e6, secs * 1e9 / iterations);
+  }
+}
+
+int main(int argc, char *argv[]) {
+  long iterations = 200000;
+  int cases = 20000;
+  for (int i = 1; i + 1 < argc; i += 2) {
+    if (strcmp(argv[i], "-n") == 0)
+      iterations = atol(argv[i + 1]);
+    else if (strcmp(argv[i], "-f") == 0)
+      cases = atoi(argv[i + 1]);
+  }
+
+  if (fuzz(cases) != 0)
+    return 1;
+  printf("tokbench: %d fuzz cases agree across scanners\n", cases);
+
+  run_corpus("short", short_corpus, sizeof(short_corpus) / sizeof(short_corpus[0]), iterations);
+  run_corpus("long", long_corpus, sizeof(long_corpus) / sizeof(long_corpus[0]), iterations);
+  return 0;
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "tokenizer.h"
+
+/* if, while, until, for, case, { } groups, ( ) subshells and function definitions are
+ * parsed once into a tree, which is compiled into the instructions below; running a loop
+ * body or calling a function again costs no parsing. */
+enum opcode {
+  OP_RUN,        /* exeTokens() command a: lists, pipelines, assignments, redirections */
+  OP_EXPAND,     /* the words of command a, expanded unless b says it needn't be, for the
+                    next instruction, which is skipped if that fails */
+  OP_BUILTIN,    /* call the function or builtin the words name, or run them */
+  OP_SPAWN,      /* call the function the words name, or run them as a program */
+  OP_JUMP,       /* to a */
+  OP_JUMP_FALSE, /* to a if $? isn't 0 */
+  OP_JUMP_TRUE,  /* to a if $? is 0 */
+  OP_STATUS,     /* $? = a */
+  OP_SAVE,       /* the status of loop a = $? */
+  OP_LOOP_INIT,  /* loop a starts with status 0, a for loop with command b's words */
+  OP_FOR_NEXT,   /* variable b = the next word of loop a, or jump to c if there are none */
+  OP_LOOP_END,   /* $? = the status of loop a */
+  OP_CASE,       /* the subject of case a is string b, expanded */
+  OP_MATCH,      /* jump to c if the subject of case a matches pattern b */
+  OP_REDIR,      /* apply command a's redirections until OP_UNREDIR, or jump to b if they
+                    fail */
+  OP_UNREDIR,
+  OP_DEFINE,     /* define function b with body a */
+  OP_ARITH,      /* (( string a )), expanded first unless b says it needn't be */
+  OP_TEST,       /* [[ command a ]] */
+  OP_SUBSHELL,   /* run body a in a fork of the shell */
+  OP_PIPE,       /* the pipeline that is command a, the c stages of which that aren't
+                    simple commands are bodies b to b + c - 1 (NULL for the simple ones) */
+};
+
+#define BYTECODE_NONE UINT32_MAX
+
+struct insn {
+  uint32_t op;
+  uint32_t a, b, c;
+};
+
+struct glob_pattern;
+
+struct program {
+  struct insn *code;
+  size_t ncode;
+  struct tokens **cmds;            /* commands, words and redirections the code uses */
+  size_t ncmds;
+  char **strings;                  /* variable names, case subjects and patterns */
+  struct glob_pattern **patterns;  /* a pattern with nothing to expand, compiled */
+  size_t nstrings;
+  size_t nslots;                   /* loops and cases */
+  size_t nredirs;
+  struct program **bodies;         /* of the functions it defines, its subshells and the
+                                      compound stages of its pipelines */
+  size_t nbodies;
+  int refs;
+};
+
+/* What ended a command handed to the parser: ';', '\n', 0 at the end of the input, or
+ * BYTECODE_DSEMI for ";;". */
+#define BYTECODE_DSEMI 'D'
+
+/* The next command of the input and what ended it, or NULL at the end. */
+typedef struct tokens *bytecode_next_fn(void *ctx, int *sep);
+
+/* Whether the command starts with if, while, until, for, case, {, ( or name() (maybe
+ * after &&, || or |). */
+bool bytecode_is_compound(struct tokens *tokens);
+
+/* Parses the compound command that starts with first, which it takes over, and the
+ * commands it pulls from next up to its end; NULL after a message on a syntax error. */
+struct program *bytecode_compile(struct tokens *first, int sep, bytecode_next_fn *next, void *ctx);
+
+/* Runs the program and returns $?. */
+int bytecode_run(struct program *prog);
+
+/* Programs are shared by whoever runs them or keeps them as a function body; free
+ * drops a reference. */
+void bytecode_ref(struct program *prog);
+void bytecode_free(struct program *prog);
+
+/* Follows the input line by line, to know whether it is in the middle of a compound
+ * command and should read on. */
+struct bytecode_nesting {
+  int depth;
+  bool case_in;   /* the in of a case is next */
+  bool patterns;  /* case patterns are next */
+  bool body;      /* the { of a function is next */
+};
+
+void bytecode_nesting_line(struct bytecode_nesting *n, const char *line);
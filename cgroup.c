@@ -0,0 +1,293 @@
+#include <errno.h>
+#include <stdbool.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "cgroup.h"
+#include "shell.h"
+#include "vars.h"
+#include "spawn.h"
+
+/* Jobs get numbered groups under the root so concurrent cgexecs don't collide. */
+static unsigned int cgroup_seq;
+
+/* Finds where this shell's own cgroup v2 group lives: the cgroup2 mount plus the
+ * "0::/path" entry of /proc/self/cgroup. Returns 1 if that is the hierarchy's root. */
+static int cgroup_own_group(char *buf, size_t size) {
+  char mount[256] = "", path[512] = "", line[512];
+
+  FILE *f = fopen("/proc/self/mounts", "r");
+  if (f == NULL)
+    return -1;
+  while (fgets(line, sizeof(line), f)) {
+    char dir[256], type[64];
+    if (sscanf(line, "%*s %255s %63s", dir, type) == 2 && strcmp(type, "cgroup2") == 0) {
+      strcpy(mount, dir);
+      break;
+    }
+  }
+  fclose(f);
+
+  f = fopen("/proc/self/cgroup", "r");
+  if (f == NULL)
+    return -1;
+  while (fgets(line, sizeof(line), f)) {
+    if (strncmp(line, "0::", 3) == 0) {
+      line[strcspn(line, "\n")] = '\0';
+      snprintf(path, sizeof(path), "%s", line + 3);
+      break;
+    }
+  }
+  fclose(f);
+
+  if (mount[0] == '\0')
+    return -1;
+  bool top = strcmp(path, "/") == 0;
+  snprintf(buf, size, "%s%s", mount, top ? "" : path);
+  return top;
+}
+
+/* The root jobs go under without --root: the group the shell started in. A group can
+ * only turn controllers on for its children while it has no processes of its own, so
+ * the shell first moves itself out into a leaf beside the jobs, <root>/shell. Found
+ * once, as /proc/self/cgroup names the leaf after that. The hierarchy's root is exempt
+ * from that rule and stays as it is. NULL without cgroup v2. */
+static const char *cgroup_default_root(void) {
+  static char root[512];
+  static bool found;
+  if (found)
+    return root;
+  int top = cgroup_own_group(root, sizeof(root));
+  if (top == -1)
+    return NULL;
+  found = true;
+  if (top)
+    return root;
+
+  char leaf[1024];
+  snprintf(leaf, sizeof(leaf), "%s/shell", root);
+  int fd = -1;
+  if ((mkdir(leaf, 0755) == -1 && errno != EEXIST) ||
+      (fd = open(leaf, O_RDONLY | O_DIRECTORY | O_CLOEXEC)) == -1 ||
+      spawn_join_cgroup(fd) == -1)
+    fprintf(stderr, "cgexec: cannot move the shell into %s: %s\n", leaf, strerror(errno));
+  if (fd != -1)
+    close(fd);
+  return root;
+}
+
+/* Writes value to a control file of the group; a missing file means the controller
+ * isn't delegated to us, which only costs that limit. */
+static int cgroup_write(int dirfd, const char *file, const char *value) {
+  int fd = openat(dirfd, file, O_WRONLY | O_CLOEXEC);
+  ssize_t n = -1;
+  if (fd != -1) {
+    n = write(fd, value, strlen(value));
+    close(fd);
+  }
+  if (n == -1) {
+    fprintf(stderr, "cgexec: %s: %s, limit not applied\n", file, strerror(errno));
+    return -1;
+  }
+  return 0;
+}
+
+/* Turns a controller on for the root's children. */
+static int cgroup_enable(int rootfd, const char *controller) {
+  int fd = openat(rootfd, "cgroup.subtree_control", O_WRONLY | O_CLOEXEC);
+  if (fd == -1)
+    return -1;
+  ssize_t n = write(fd, controller, strlen(controller));
+  int saved = errno;
+  close(fd);
+  errno = saved;
+  return n == -1 ? -1 : 0;
+}
+
+/* Sets one limit on the job's group, with its controller turned on under the root first.
+ * Turning it on may fail and not matter -- the root was delegated with it on but isn't
+ * ours to change -- so that failure is only reported if the group has no file for the
+ * limit, which is when it went unapplied. */
+static void cgroup_limit(int rootfd, int dirfd, const char *controller, const char *file,
+    const char *value) {
+  int enable_errno = 0;
+  if (rootfd == -1 || cgroup_enable(rootfd, controller) == -1)
+    enable_errno = errno;
+  if (enable_errno != 0 && faccessat(dirfd, file, F_OK, 0) == -1) {
+    fprintf(stderr, "cgexec: cannot enable the %s controller: %s%s, %s not applied\n",
+        controller + 1, strerror(enable_errno),
+        enable_errno == EBUSY ? " (the root has processes of its own)" : "", file);
+    return;
+  }
+  cgroup_write(dirfd, file, value);
+}
+
+/* Reads a whole control file into buf; returns -1 if it doesn't exist. */
+static int cgroup_read(int dirfd, const char *file, char *buf, size_t size) {
+  int fd = openat(dirfd, file, O_RDONLY | O_CLOEXEC);
+  if (fd == -1)
+    return -1;
+  ssize_t n = read(fd, buf, size - 1);
+  close(fd);
+  if (n < 0)
+    return -1;
+  buf[n] = '\0';
+  return 0;
+}
+
+/* Parses "max" or a byte count with an optional K/M/G/T suffix into memory.max syntax. */
+static int cgroup_parse_memory(const char *value, char *out, size_t size) {
+  if (strcmp(value, "max") == 0 || strcmp(value, "unlimited") == 0) {
+    snprintf(out, size, "max");
+    return 0;
+  }
+  char *end;
+  errno = 0;
+  unsigned long long n = strtoull(value, &end, 10);
+  if (end == value || value[0] == '-' || errno == ERANGE)
+    return -1;
+  const char *suffixes = "KMGT";
+  const char *p = *end ? strchr(suffixes, *end & ~0x20) : NULL;
+  if (*end && (p == NULL || end[1] != '\0'))
+    return -1;
+  int shift = p ? 10 * (p - suffixes + 1) : 0;
+  if (n > ULLONG_MAX >> shift)
+    return -1; /* would wrap to a small limit */
+  n <<= shift;
+  snprintf(out, size, "%llu", n);
+  return 0;
+}
+
+/* Parses a CPU share like "150%" (1.5 CPUs) into cpu.max syntax over a 100ms period. */
+static int cgroup_parse_cpu(const char *value, char *out, size_t size) {
+  if (strcmp(value, "max") == 0) {
+    snprintf(out, size, "max 100000");
+    return 0;
+  }
+  char *end;
+  double pct = strtod(value, &end);
+  if (end == value || pct <= 0 || (*end && strcmp(end, "%") != 0))
+    return -1;
+  snprintf(out, size, "%llu 100000", (unsigned long long) (pct * 1000));
+  return 0;
+}
+
+static void cgroup_report(int dirfd) {
+  char buf[1024];
+  unsigned long long peak = 0, usage = 0, user = 0, sys = 0;
+  bool have_peak = cgroup_read(dirfd, "memory.peak", buf, sizeof(buf)) == 0;
+  if (have_peak)
+    peak = strtoull(buf, NULL, 10);
+  if (cgroup_read(dirfd, "cpu.stat", buf, sizeof(buf)) == 0) {
+    char *p;
+    if ((p = strstr(buf, "usage_usec ")))
+      usage = strtoull(p + 11, NULL, 10);
+    if ((p = strstr(buf, "user_usec ")))
+      user = strtoull(p + 10, NULL, 10);
+    if ((p = strstr(buf, "system_usec ")))
+      sys = strtoull(p + 12, NULL, 10);
+  }
+  fprintf(stderr, "cgexec: cpu %.3fs (user %.3fs, sys %.3fs)", usage / 1e6, user / 1e6,
+      sys / 1e6);
+  if (have_peak)
+    fprintf(stderr, ", peak memory %.1fM", peak / 1048576.0);
+  fprintf(stderr, "\n");
+}
+
+int cmd_cgexec(struct tokens *tokens) {
+  size_t len = tokens_get_length(tokens);
+  const char *root = vars_get("SHELL_CGROUP_ROOT");
+  char memory[32] = "", cpu[32] = "", io[32] = "";
+  size_t cmdstart = 0;
+
+  for (size_t i = 1; i < len; i++) {
+    char *opt = tokens_get_token(tokens, i);
+    if (strcmp(opt, "--") == 0) {
+      cmdstart = i + 1;
+      break;
+    }
+    char *value = tokens_get_token(tokens, i + 1);
+    if (value == NULL) {
+      fprintf(stderr, "cgexec: %s: value expected\n", opt);
+      return 1;
+    }
+    i++;
+    if (strcmp(opt, "--root") == 0) {
+      root = value;
+    } else if (strcmp(opt, "--memory") == 0) {
+      if (cgroup_parse_memory(value, memory, sizeof(memory)) == -1) {
+        fprintf(stderr, "cgexec: %s: invalid memory size\n", value);
+        return 1;
+      }
+    } else if (strcmp(opt, "--cpu") == 0) {
+      if (cgroup_parse_cpu(value, cpu, sizeof(cpu)) == -1) {
+        fprintf(stderr, "cgexec: %s: invalid cpu share\n", value);
+        return 1;
+      }
+    } else if (strcmp(opt, "--io-weight") == 0) {
+      int weight = atoi(value);
+      if (weight < 1 || weight > 10000) {
+        fprintf(stderr, "cgexec: %s: io weight must be 1-10000\n", value);
+        return 1;
+      }
+      snprintf(io, sizeof(io), "default %d", weight);
+    } else {
+      fprintf(stderr, "cgexec: %s: invalid option\n", opt);
+      return 1;
+    }
+  }
+  if (cmdstart == 0 || cmdstart >= len) {
+    fprintf(stderr, "usage: cgexec [--root DIR] [--memory SIZE] [--cpu PCT] [--io-weight N] -- command...\n");
+    return 1;
+  }
+
+  if (root == NULL)
+    root = cgroup_default_root();
+
+  struct tokens *cmd = tokens_slice(tokens, cmdstart, len);
+  char group[1024] = "";
+  int dirfd = -1;
+  if (root == NULL) {
+    fprintf(stderr, "cgexec: no cgroup v2 hierarchy, running uncontained\n");
+  } else {
+    snprintf(group, sizeof(group), "%s/sh%d.%u", root, (int) getpid(), cgroup_seq++);
+    if (mkdir(group, 0755) == -1 || (dirfd = open(group, O_RDONLY | O_DIRECTORY | O_CLOEXEC)) == -1) {
+      fprintf(stderr, "cgexec: %s: %s, running uncontained\n", group, strerror(errno));
+      group[0] = '\0';
+    }
+  }
+
+  if (dirfd != -1) {
+    /* Controllers must be enabled in the parent for the child's files to exist. */
+    int rootfd = open(root, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (memory[0])
+      cgroup_limit(rootfd, dirfd, "+memory", "memory.max", memory);
+    if (cpu[0])
+      cgroup_limit(rootfd, dirfd, "+cpu", "cpu.max", cpu);
+    if (io[0])
+      cgroup_limit(rootfd, dirfd, "+io", "io.weight", io);
+    if (rootfd != -1)
+      close(rootfd);
+  }
+
+  struct spawn_attrs attrs;
+  spawn_attrs_init(&attrs, spawn_pending);
+  if (dirfd != -1)
+    attrs.cgroup_fd = dirfd;
+  /* A builtin or function runs in a fork of the shell that joins the group, like a program. */
+  int status = spawn_run(cmd, &attrs);
+  tokens_destroy(cmd);
+
+  if (dirfd != -1) {
+    cgroup_report(dirfd);
+    close(dirfd);
+    /* Background jobs still inside keep the group busy; leave it for them. */
+    if (rmdir(group) == -1)
+      fprintf(stderr, "cgexec: %s kept: %s\n", group, strerror(errno));
+  }
+  return status;
+}
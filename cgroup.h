@@ -0,0 +1,7 @@
+#pragma once
+
+#include "tokenizer.h"
+
+/* cgexec [--root DIR] [--memory SIZE] [--cpu PCT] [--io-weight N] -- command...
+ * Runs command in a fresh cgroup v2 child group and reports its usage afterwards. */
+int cmd_cgexec(struct tokens *tokens);
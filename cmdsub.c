@@ -0,0 +1,245 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "cmdsub.h"
+#include "func.h"
+#include "output.h"
+#include "redir.h"
+#include "shell.h"
+#include "tokenizer.h"
+
+int cmdsub_status = -1;
+
+/* The shell's ends of open process substitutions, and their children. */
+static struct process_sub {
+  int fd;
+  pid_t pid;
+  bool output;
+} *subs;
+static size_t nsubs, subs_cap;
+
+/* <(...) children that were still running when their command finished. */
+static pid_t *lingering;
+static size_t nlingering, lingering_cap;
+
+/* A child only keeps the pipe ends that are its own. */
+static void close_process_ends(void) {
+  for (size_t i = 0; i < nsubs; i++)
+    close(subs[i].fd);
+  nsubs = 0;
+}
+
+/* Builtins that only print, so $(name ...) can run them in the shell itself instead of a
+ * subshell: nothing they do could leak out of it. */
+static const char *const printing_builtins[] = {"pwd", "type", "history", "?", "echo", "printf"};
+
+static bool runs_in_process(struct tokens *tokens) {
+  static const char *const ops[] = {"|", "&&", "||", "&"};
+  size_t len = tokens_get_length(tokens);
+  if (len == 0 || redir_any(tokens))
+    return false;
+  for (size_t i = 0; i < len; i++)
+    for (size_t k = 0; k < sizeof(ops) / sizeof(ops[0]); k++)
+      if (tokens_is_op(tokens, i, ops[k]))
+        return false;
+  const char *name = tokens_get_token(tokens, 0);
+  /* A function of the same name runs instead, and could change anything. */
+  if (func_lookup(name) != NULL)
+    return false;
+  for (size_t k = 0; k < sizeof(printing_builtins) / sizeof(printing_builtins[0]); k++)
+    if (strcmp(name, printing_builtins[k]) == 0)
+      return lookup((char *) name) != NULL;
+  return false;
+}
+
+/* One command with no pipe, list or '&': the child can exec it without forking again. */
+static bool is_simple(struct tokens *tokens) {
+  static const char *const ops[] = {"|", "&&", "||", "&"};
+  for (size_t i = 0; i < tokens_get_length(tokens); i++)
+    for (size_t k = 0; k < sizeof(ops) / sizeof(ops[0]); k++)
+      if (tokens_is_op(tokens, i, ops[k]))
+        return false;
+  return true;
+}
+
+/* stdout becomes a memory stream while the builtin runs; no fork, no pipe. */
+static char *capture_builtin(struct tokens *tokens, size_t *out_len, int *status) {
+  char *buf = NULL;
+  size_t size = 0;
+  out_flush();
+  FILE *saved = stdout;
+  FILE *memory = open_memstream(&buf, &size);
+  if (memory == NULL) {
+    *status = 1;
+    *out_len = 0;
+    return strdup("");
+  }
+  stdout = memory;
+  *status = exeTokens(tokens);
+  fclose(memory);
+  stdout = saved;
+  *out_len = size;
+  return buf;
+}
+
+/* Anything else runs in a child writing into a pipe, which is read into a buffer that
+ * doubles whenever it fills up. */
+static char *capture_child(char *line, bool simple, size_t *out_len, int *status) {
+  int pfd[2];
+  *out_len = 0;
+  *status = 1;
+  if (pipe2(pfd, O_CLOEXEC) == -1) {
+    fprintf(stderr, "command substitution: %s\n", strerror(errno));
+    return strdup("");
+  }
+  out_flush();
+  pid_t pid = fork();
+  if (pid < 0) {
+    fprintf(stderr, "command substitution: %s\n", strerror(errno));
+    close(pfd[0]);
+    close(pfd[1]);
+    return strdup("");
+  }
+  if (pid == 0) {
+    close_process_ends();
+    dup2(pfd[1], STDOUT_FILENO);
+    shell_is_interactive = false;
+    shell_exec_in_place = simple;
+    int st = shellExe(line);
+    out_flush();
+    _exit(st & 0xff);
+  }
+  close(pfd[1]);
+
+  size_t cap = 4096, used = 0;
+  char *buf = malloc(cap);
+  for (;;) {
+    if (used == cap) {
+      cap *= 2;
+      buf = realloc(buf, cap);
+    }
+    ssize_t got = read(pfd[0], buf + used, cap - used);
+    if (got < 0 && errno == EINTR)
+      continue;
+    if (got <= 0)
+      break;
+    used += got;
+  }
+  close(pfd[0]);
+
+  int wstatus;
+  while (waitpid(pid, &wstatus, 0) == -1 && errno == EINTR)
+    ;
+  *status = WIFSIGNALED(wstatus) ? 128 + WTERMSIG(wstatus) : WEXITSTATUS(wstatus);
+  *out_len = used;
+  return buf;
+}
+
+char *cmdsub_run(const char *text, size_t len, size_t *out_len) {
+  char *line = strndup(text, len);
+  char *out;
+  int status;
+  struct tokens *tokens = NULL;
+  if (strpbrk(line, ";\n") == NULL)
+    tokens = tokenize(line);
+  if (tokens && runs_in_process(tokens))
+    out = capture_builtin(tokens, out_len, &status);
+  else
+    out = capture_child(line, tokens && is_simple(tokens), out_len, &status);
+  tokens_destroy(tokens);
+  free(line);
+
+  while (*out_len > 0 && out[*out_len - 1] == '\n')
+    (*out_len)--;
+  out = realloc(out, *out_len + 1);
+  out[*out_len] = '\0';
+  cmdsub_status = status;
+  shell_last_status = status;
+  return out;
+}
+
+const char *cmdsub_process(const char *text, size_t len, bool output) {
+  static char path[32];
+  int pfd[2];
+  if (pipe2(pfd, O_CLOEXEC) == -1) {
+    fprintf(stderr, "process substitution: %s\n", strerror(errno));
+    return "/dev/null";
+  }
+  char *line = strndup(text, len);
+  struct tokens *tokens = strpbrk(line, ";\n") == NULL ? tokenize(line) : NULL;
+  bool simple = tokens && is_simple(tokens);
+  tokens_destroy(tokens);
+
+  out_flush();
+  pid_t pid = fork();
+  if (pid == 0) {
+    close_process_ends();
+    dup2(output ? pfd[0] : pfd[1], output ? STDIN_FILENO : STDOUT_FILENO);
+    shell_is_interactive = false;
+    shell_exec_in_place = simple;
+    int st = shellExe(line);
+    out_flush();
+    _exit(st & 0xff);
+  }
+  free(line);
+  close(output ? pfd[0] : pfd[1]);
+  int fd = output ? pfd[1] : pfd[0];
+  if (pid < 0) {
+    fprintf(stderr, "process substitution: %s\n", strerror(errno));
+    close(fd);
+    return "/dev/null";
+  }
+
+  /* Up high, where the command's own redirections (3>file) won't land on it. */
+  int high = fcntl(fd, F_DUPFD_CLOEXEC, 63);
+  if (high >= 0) {
+    close(fd);
+    fd = high;
+  }
+  if (nsubs == subs_cap) {
+    subs_cap = subs_cap ? subs_cap * 2 : 4;
+    subs = realloc(subs, subs_cap * sizeof(*subs));
+  }
+  subs[nsubs++] = (struct process_sub) {fd, pid, output};
+  snprintf(path, sizeof(path), "/dev/fd/%d", fd);
+  return path;
+}
+
+size_t cmdsub_process_mark(void) {
+  return nsubs;
+}
+
+void cmdsub_process_done(size_t mark) {
+  for (size_t i = mark; i < nsubs; i++)
+    close(subs[i].fd);
+  for (size_t i = mark; i < nsubs; i++) {
+    if (subs[i].output) {
+      while (waitpid(subs[i].pid, NULL, 0) == -1 && errno == EINTR)
+        ;
+    } else if (waitpid(subs[i].pid, NULL, WNOHANG) == 0) {
+      if (nlingering == lingering_cap) {
+        lingering_cap = lingering_cap ? lingering_cap * 2 : 4;
+        lingering = realloc(lingering, lingering_cap * sizeof(pid_t));
+      }
+      lingering[nlingering++] = subs[i].pid;
+    }
+  }
+  nsubs = mark < nsubs ? mark : nsubs;
+
+  for (size_t i = 0; i < nlingering; )
+    if (waitpid(lingering[i], NULL, WNOHANG) != 0)
+      lingering[i] = lingering[--nlingering];
+    else
+      i++;
+}
+
+void cmdsub_process_inherit(void) {
+  for (size_t i = 0; i < nsubs; i++)
+    fcntl(subs[i].fd, F_SETFD, 0);
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Status of the last command substitution of the current command, -1 if there was none. */
+extern int cmdsub_status;
+
+/* Runs the commands in text[0..len) and returns their output, malloc()ed and without
+ * trailing newlines; *out_len gets its length. */
+char *cmdsub_run(const char *text, size_t len, size_t *out_len);
+
+/* <(text) or, if output is set, >(text): starts the commands with a pipe from (or to) them
+ * and returns the /dev/fd path of the shell's end, in static storage. That end stays in
+ * the shell, close-on-exec, until cmdsub_process_done(). */
+const char *cmdsub_process(const char *text, size_t len, bool output);
+
+/* Marks where a command's process substitutions start... */
+size_t cmdsub_process_mark(void);
+
+/* ...and, once it has run, closes the ends opened since mark and reaps their children:
+ * >(...) ones are waited for, so their output comes before the next command's; <(...)
+ * ones are reaped when they have finished, now or at a later call. */
+void cmdsub_process_done(size_t mark);
+
+/* In the child of the command they were made for: lets the open ends survive its exec. */
+void cmdsub_process_inherit(void);
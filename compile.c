@@ -0,0 +1,932 @@
+#define _GNU_SOURCE
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bytecode.h"
+#include "arith.h"
+#include "expand.h"
+#include "func.h"
+#include "glob.h"
+#include "redir.h"
+#include "shell.h"
+#include "test.h"
+#include "vars.h"
+
+static const char *const openers[] = {"if", "while", "until", "for", "case"};
+static const char *const closers[] = {"then", "do", "done", "fi", "elif", "else", "esac", "}", ")"};
+
+static bool is_one_of(struct tokens *t, size_t i, const char *const *words, size_t n) {
+  for (size_t k = 0; k < n; k++)
+    if (tokens_is_op(t, i, words[k]))
+      return true;
+  return false;
+}
+
+#define IS_ONE_OF(t, i, words) is_one_of(t, i, words, sizeof(words) / sizeof(words[0]))
+
+static bool is_name(const char *s, size_t n) {
+  char assign[n + 2];
+  size_t name_len;
+  memcpy(assign, s, n);
+  strcpy(assign + n, "=");
+  return vars_is_assignment(assign, &name_len) && name_len == n;
+}
+
+/* How many words the name() or name () at word i takes, 0 if there's none; *brace is set
+ * for name(){ in one word. */
+static size_t function_header(struct tokens *t, size_t i, bool *brace) {
+  const char *raw = tokens_get_raw(t, i);
+  size_t n = strlen(raw);
+  *brace = false;
+  if (raw != tokens_get_token(t, i))
+    return 0;
+  if (n > 3 && strcmp(raw + n - 3, "(){") == 0 && is_name(raw, n - 3)) {
+    *brace = true;
+    return 1;
+  }
+  if (n > 2 && strcmp(raw + n - 2, "()") == 0 && is_name(raw, n - 2))
+    return 1;
+  if (i + 1 < tokens_get_length(t) && tokens_is_op(t, i + 1, "()") && is_name(raw, n))
+    return 2;
+  return 0;
+}
+
+/* Whether raw, a word as written, starts with the ( of a subshell: not (( or (). */
+static bool opens_subshell(const char *raw) {
+  return raw[0] == '(' && raw[1] != '(' && strcmp(raw, "()") != 0;
+}
+
+bool bytecode_is_compound(struct tokens *tokens) {
+  bool brace;
+  for (size_t i = 0; i < tokens_get_length(tokens); i++)
+    if ((i == 0 || tokens_is_op(tokens, i - 1, "&&") || tokens_is_op(tokens, i - 1, "||") ||
+          tokens_is_op(tokens, i - 1, "|")) &&
+        (IS_ONE_OF(tokens, i, openers) || function_header(tokens, i, &brace) > 0 ||
+         tokens_is_op(tokens, i, "{") || opens_subshell(tokens_get_raw(tokens, i))))
+      return true;
+  return false;
+}
+
+/* How many of the unquoted )s raw ends with close no ( of its own: 2 for x)), none for
+ * $(x) or f(). */
+static size_t closing_parens(const char *raw) {
+  size_t n = strlen(raw), depth = 0, trail = 0;
+  for (size_t i = 0; i < n; i++) {
+    char ch = raw[i];
+    if (ch == ')' && depth == 0) {
+      trail++;
+      continue;
+    }
+    trail = 0;
+    if (ch == '\\')
+      i++;
+    else if (ch == '\'' || ch == '"' || ch == '`' || (ch == '(' && i > 0 && strchr("$<>", raw[i - 1])))
+      i = tokens_subst_end(raw, i, n);
+    else if (ch == '(')
+      depth++;
+    else if (ch == ')')
+      depth--;
+  }
+  return trail;
+}
+
+/* (cd /tmp; pwd) is written with its parentheses against the words inside; the parser
+ * gets them as words of their own. Words of (( )) and [[ ]] are left as they are. */
+static struct tokens *split_parens(struct tokens *t) {
+  size_t len = tokens_get_length(t);
+  bool parens = false;
+  for (size_t i = 0; i < len && !parens; i++)
+    parens = strpbrk(tokens_get_raw(t, i), "()") != NULL;
+  if (!parens)
+    return t;
+  struct tokens *out = tokens_create();
+  bool split = false;
+  for (size_t i = 0; i < len; i++) {
+    size_t inner = arith_command_words(t, i) + test_command_words(t, i);
+    for (size_t end = i + inner; i < end; i++)
+      tokens_append(out, tokens_get_token(t, i), tokens_get_raw(t, i));
+    if (i == len)
+      break;
+    const char *raw = tokens_get_raw(t, i), *word = tokens_get_token(t, i);
+    size_t lead = opens_subshell(raw), trail = closing_parens(raw + lead);
+    size_t n = strlen(word) - lead - trail, raw_n = strlen(raw) - lead - trail;
+    split |= lead + trail > 0;
+    if (lead)
+      tokens_append(out, "(", NULL);
+    if (raw_n > 0) {
+      char *w = strndup(word + lead, n), *r = strndup(raw + lead, raw_n);
+      tokens_append(out, w, r);
+      free(w);
+      free(r);
+    }
+    while (trail-- > 0)
+      tokens_append(out, ")", NULL);
+  }
+  if (!split) {
+    tokens_destroy(out);
+    return t;
+  }
+  tokens_destroy(t);
+  return out;
+}
+
+/* Whether raw, a word as written, ends with an unquoted ')'. */
+static bool ends_pattern(const char *raw) {
+  size_t n = strlen(raw);
+  return n > 0 && raw[n - 1] == ')' && (n == 1 || raw[n - 2] != '\\');
+}
+
+void bytecode_nesting_line(struct bytecode_nesting *n, const char *line) {
+  static const char *const lists[] = {"then", "do", "else", "elif", "if", "while", "until", "&&", "||", "|", "("};
+  size_t len = strlen(line);
+  for (size_t start = 0; start <= len; ) {
+    size_t end = tokens_command_end(line, start);
+    char *cmd = strndup(line + start, end - start);
+    struct tokens *t = split_parens(tokenize(cmd));
+    bool command_start = true;
+    for (size_t i = 0; i < tokens_get_length(t); i++) {
+      if (n->patterns) {
+        if (tokens_is_op(t, i, "esac")) {
+          n->depth--;
+          n->patterns = false;
+        } else if (ends_pattern(tokens_get_raw(t, i))) {
+          n->patterns = false;
+        }
+        continue;
+      }
+      if (n->case_in && tokens_is_op(t, i, "in")) {
+        n->case_in = false;
+        n->patterns = true;
+        continue;
+      }
+      bool brace;
+      size_t header = command_start ? function_header(t, i, &brace) : 0;
+      if (header > 0) {
+        n->depth++;
+        n->body = !brace;
+        i += header - 1;
+        continue; /* the body comes next */
+      }
+      if (n->body && tokens_is_op(t, i, "{")) {
+        n->body = false;
+      } else if (command_start && (IS_ONE_OF(t, i, openers) || tokens_is_op(t, i, "{") ||
+            tokens_is_op(t, i, "("))) {
+        n->depth++;
+        n->case_in = tokens_is_op(t, i, "case");
+      } else if ((command_start && (tokens_is_op(t, i, "fi") || tokens_is_op(t, i, "done") ||
+            tokens_is_op(t, i, "esac") || tokens_is_op(t, i, "}"))) || tokens_is_op(t, i, ")")) {
+        n->depth--;
+      }
+      command_start = IS_ONE_OF(t, i, lists) || tokens_is_op(t, i, "{");
+    }
+    tokens_destroy(t);
+    free(cmd);
+    if (line[end] == ';' && line[end + 1] == ';') {
+      n->patterns = true;
+      end++;
+    }
+    start = end + 1;
+  }
+  if (n->depth <= 0)
+    memset(n, 0, sizeof(*n));
+}
+
+enum node_kind {
+  NODE_CMD, NODE_LIST, NODE_ANDOR, NODE_PIPE, NODE_IF, NODE_WHILE, NODE_UNTIL, NODE_FOR,
+  NODE_CASE, NODE_FUNCTION, NODE_GROUP, NODE_SUBSHELL
+};
+
+struct node {
+  enum node_kind kind;
+  struct tokens *words;  /* CMD: the command; FOR: the words after in, NULL without one */
+  struct tokens *redirs; /* written after the closing keyword, or NULL */
+  char *name;            /* FOR: the variable; CASE: the subject as written; FUNCTION: its name */
+  struct node **kids;    /* LIST, ANDOR: the parts; PIPE: the stages; IF: condition, then
+                            and else (maybe NULL); WHILE, UNTIL: condition and body; FOR,
+                            FUNCTION, GROUP, SUBSHELL: body; CASE: the bodies */
+  size_t nkids;
+  bool *or;              /* ANDOR: part k comes after a || rather than a && */
+  char ***patterns;      /* CASE: the patterns of body k as written, NULL-terminated */
+};
+
+static struct node *node_new(enum node_kind kind) {
+  struct node *node = calloc(1, sizeof(struct node));
+  node->kind = kind;
+  return node;
+}
+
+static void add_kid(struct node *node, struct node *kid) {
+  node->kids = realloc(node->kids, (node->nkids + 1) * sizeof(struct node *));
+  node->kids[node->nkids++] = kid;
+}
+
+static void node_free(struct node *node) {
+  if (node == NULL)
+    return;
+  for (size_t k = 0; k < node->nkids; k++) {
+    node_free(node->kids[k]);
+    if (node->patterns) {
+      for (char **p = node->patterns[k]; *p; p++)
+        free(*p);
+      free(node->patterns[k]);
+    }
+  }
+  if (node->words)
+    tokens_destroy(node->words);
+  if (node->redirs)
+    tokens_destroy(node->redirs);
+  free(node->name);
+  free(node->kids);
+  free(node->or);
+  free(node->patterns);
+  free(node);
+}
+
+struct parser {
+  bytecode_next_fn *next;
+  void *ctx;
+  struct tokens *cur; /* the command being parsed, and where in it */
+  size_t pos, len;
+  int sep;            /* what ended cur */
+  bool dsemi;         /* cur ended with ;; and is used up */
+  bool eof;
+  bool failed;
+};
+
+/* Whether there is a word at pos, moving on to the next command if cur is used up; a
+ * command ended by ;; or the end of the input stops it. */
+static bool fill(struct parser *p) {
+  while (p->pos >= p->len && !p->dsemi && !p->eof && !p->failed) {
+    if (p->sep == BYTECODE_DSEMI) {
+      p->dsemi = true;
+      break;
+    }
+    tokens_destroy(p->cur);
+    p->cur = p->next(p->ctx, &p->sep);
+    if (p->cur == NULL) {
+      p->eof = true;
+      p->len = 0;
+      break;
+    }
+    p->cur = split_parens(p->cur);
+    p->pos = 0;
+    p->len = tokens_get_length(p->cur);
+  }
+  return p->pos < p->len && !p->failed;
+}
+
+static bool at(struct parser *p, const char *keyword) {
+  return p->pos < p->len && tokens_is_op(p->cur, p->pos, keyword);
+}
+
+static void syntax_error(struct parser *p, const char *wanted) {
+  if (p->failed)
+    return;
+  p->failed = true;
+  const char *found = p->pos < p->len ? tokens_get_token(p->cur, p->pos) :
+    p->dsemi ? ";;" : "end of input";
+  if (wanted)
+    fprintf(stderr, "syntax error: %s where %s was expected\n", found, wanted);
+  else
+    fprintf(stderr, "syntax error: unexpected %s\n", found);
+}
+
+static void expect(struct parser *p, const char *keyword) {
+  if (fill(p) && at(p, keyword))
+    p->pos++;
+  else
+    syntax_error(p, keyword);
+}
+
+static struct node *parse_andor(struct parser *p);
+
+/* Commands up to a keyword that ends the list, a ;; or the end of the input. */
+static struct node *parse_list(struct parser *p) {
+  struct node *list = node_new(NODE_LIST);
+  while (fill(p) && !IS_ONE_OF(p->cur, p->pos, closers))
+    add_kid(list, parse_andor(p));
+  return list;
+}
+
+static struct node *parse_if(struct parser *p) {
+  struct node *node = node_new(NODE_IF);
+  p->pos++;
+  add_kid(node, parse_list(p));
+  expect(p, "then");
+  add_kid(node, parse_list(p));
+  if (at(p, "elif")) {
+    add_kid(node, parse_if(p)); /* it takes the fi */
+    return node;
+  }
+  if (at(p, "else")) {
+    p->pos++;
+    add_kid(node, parse_list(p));
+  }
+  expect(p, "fi");
+  return node;
+}
+
+static struct node *parse_loop(struct parser *p) {
+  struct node *node = node_new(at(p, "while") ? NODE_WHILE : NODE_UNTIL);
+  p->pos++;
+  add_kid(node, parse_list(p));
+  expect(p, "do");
+  add_kid(node, parse_list(p));
+  expect(p, "done");
+  return node;
+}
+
+static struct node *parse_for(struct parser *p) {
+  struct node *node = node_new(NODE_FOR);
+  p->pos++;
+  size_t name_len;
+  char assign[256];
+  if (p->pos < p->len)
+    snprintf(assign, sizeof(assign), "%s=", tokens_get_raw(p->cur, p->pos));
+  if (p->pos == p->len || !vars_is_assignment(assign, &name_len) ||
+      name_len != strlen(assign) - 1) {
+    syntax_error(p, "a variable name");
+    return node;
+  }
+  node->name = strdup(tokens_get_token(p->cur, p->pos++));
+  if (at(p, "in")) {
+    node->words = tokens_slice(p->cur, p->pos + 1, p->len);
+    p->pos = p->len;
+  }
+  expect(p, "do");
+  add_kid(node, parse_list(p));
+  expect(p, "done");
+  return node;
+}
+
+/* Splits a|b|c, as written, on the unquoted |s. */
+static char **split_patterns(const char *s) {
+  size_t n = 1;
+  char **out = malloc(sizeof(char *) * (strlen(s) + 2));
+  const char *from = s;
+  char quote = 0;
+  for (; *s; s++) {
+    if (*s == '\\' && quote != '\'' && s[1] != '\0') {
+      s++;
+    } else if (quote != 0) {
+      if (*s == quote)
+        quote = 0;
+    } else if (*s == '\'' || *s == '"') {
+      quote = *s;
+    } else if (*s == '|') {
+      out[n - 1] = strndup(from, s - from);
+      from = s + 1;
+      n++;
+    }
+  }
+  out[n - 1] = strdup(from);
+  out[n] = NULL;
+  return out;
+}
+
+static struct node *parse_case(struct parser *p) {
+  struct node *node = node_new(NODE_CASE);
+  p->pos++;
+  if (p->pos == p->len) {
+    syntax_error(p, "a word");
+    return node;
+  }
+  node->name = strdup(tokens_get_raw(p->cur, p->pos++));
+  expect(p, "in");
+  while (!p->failed) {
+    if (!fill(p)) {
+      if (!p->dsemi) {
+        syntax_error(p, "esac");
+        break;
+      }
+      p->dsemi = false; /* an empty ;; */
+      p->sep = ';';
+      continue;
+    }
+    if (at(p, "esac")) {
+      p->pos++;
+      break;
+    }
+
+    /* (a | b) as written, up to the word ending in ')' */
+    char *text = strdup("");
+    bool closed = false;
+    while (p->pos < p->len && !closed) {
+      const char *raw = tokens_get_raw(p->cur, p->pos++);
+      closed = ends_pattern(raw);
+      char *more;
+      if (asprintf(&more, "%s%s", text, raw) < 0)
+        more = NULL;
+      free(text);
+      text = more;
+    }
+    if (!closed) {
+      free(text);
+      syntax_error(p, ")");
+      break;
+    }
+    text[strlen(text) - 1] = '\0';
+    node->patterns = realloc(node->patterns, (node->nkids + 1) * sizeof(char **));
+    node->patterns[node->nkids] = split_patterns(text + (text[0] == '('));
+    free(text);
+    add_kid(node, parse_list(p));
+
+    if (p->dsemi) {
+      p->dsemi = false;
+      p->sep = ';';
+    } else {
+      expect(p, "esac");
+      break;
+    }
+  }
+  return node;
+}
+
+/* name() { list; }, with the header at pos. */
+static struct node *parse_function(struct parser *p, size_t header, bool brace) {
+  struct node *node = node_new(NODE_FUNCTION);
+  const char *word = tokens_get_token(p->cur, p->pos);
+  node->name = strndup(word, strcspn(word, "("));
+  p->pos += header;
+  if (!brace)
+    expect(p, "{");
+  add_kid(node, parse_list(p));
+  expect(p, "}");
+  return node;
+}
+
+/* { list; } and ( list ). */
+static struct node *parse_group(struct parser *p, enum node_kind kind, const char *close) {
+  struct node *node = node_new(kind);
+  p->pos++;
+  add_kid(node, parse_list(p));
+  expect(p, close);
+  return node;
+}
+
+/* Whether the word at pos ends the command there: &&, ||, | or the ) of a subshell. */
+static bool at_command_end(struct parser *p, size_t pos) {
+  return tokens_is_op(p->cur, pos, "&&") || tokens_is_op(p->cur, pos, "||") ||
+    tokens_is_op(p->cur, pos, "|") || tokens_is_op(p->cur, pos, ")");
+}
+
+/* Redirections after a compound command's closing word, up to the end of the command. */
+static void parse_redirs(struct parser *p, struct node *node) {
+  size_t start = p->pos;
+  while (p->pos < p->len && !at_command_end(p, p->pos)) {
+    const char *raw = tokens_get_raw(p->cur, p->pos);
+    size_t op = redir_op_length(raw);
+    if (op == 0) {
+      syntax_error(p, NULL);
+      return;
+    }
+    p->pos += raw[op] == '\0' ? 2 : 1;
+  }
+  if (p->pos > p->len) {
+    p->pos = p->len;
+    syntax_error(p, "a file");
+    return;
+  }
+  if (p->pos > start)
+    node->redirs = tokens_slice(p->cur, start, p->pos);
+}
+
+/* A compound command or a simple one. */
+static struct node *parse_part(struct parser *p) {
+  struct node *node;
+  bool brace;
+  size_t header = function_header(p->cur, p->pos, &brace);
+  if (header > 0) {
+    node = parse_function(p, header, brace);
+  } else if (at(p, "if")) {
+    node = parse_if(p);
+  } else if (at(p, "while") || at(p, "until")) {
+    node = parse_loop(p);
+  } else if (at(p, "for")) {
+    node = parse_for(p);
+  } else if (at(p, "case")) {
+    node = parse_case(p);
+  } else if (at(p, "{")) {
+    node = parse_group(p, NODE_GROUP, "}");
+  } else if (at(p, "(")) {
+    node = parse_group(p, NODE_SUBSHELL, ")");
+  } else {
+    size_t end = p->pos + arith_command_words(p->cur, p->pos) + test_command_words(p->cur, p->pos);
+    while (end < p->len && !at_command_end(p, end))
+      end++;
+    if (end == p->pos) {
+      syntax_error(p, NULL);
+      return node_new(NODE_LIST);
+    }
+    node = node_new(NODE_CMD);
+    node->words = tokens_slice(p->cur, p->pos, end);
+    p->pos = end;
+    return node;
+  }
+  if (!p->failed)
+    parse_redirs(p, node);
+  return node;
+}
+
+static struct node *parse_pipeline(struct parser *p) {
+  struct node *first = parse_part(p), *pipe = NULL;
+  while (!p->failed && at(p, "|")) {
+    if (pipe == NULL) {
+      pipe = node_new(NODE_PIPE);
+      add_kid(pipe, first);
+    }
+    if (++p->pos == p->len) {
+      syntax_error(p, "a command");
+      break;
+    }
+    add_kid(pipe, parse_part(p));
+  }
+  return pipe ? pipe : first;
+}
+
+static struct node *parse_andor(struct parser *p) {
+  struct node *first = parse_pipeline(p), *andor = NULL;
+  while (!p->failed && (at(p, "&&") || at(p, "||"))) {
+    if (andor == NULL) {
+      andor = node_new(NODE_ANDOR);
+      add_kid(andor, first);
+    }
+    andor->or = realloc(andor->or, (andor->nkids + 1) * sizeof(bool));
+    andor->or[andor->nkids] = at(p, "||");
+    if (++p->pos == p->len) {
+      syntax_error(p, "a command");
+      break;
+    }
+    add_kid(andor, parse_pipeline(p));
+  }
+  return andor ? andor : first;
+}
+
+/* Where break and continue go in the innermost loops. */
+struct loop_scope {
+  uint32_t slot;
+  size_t depth;  /* redirections in effect around the body */
+  size_t top;    /* where continue goes */
+  size_t *breaks;
+  size_t nbreaks;
+  struct loop_scope *outer;
+};
+
+struct compiler {
+  struct program *prog;
+  size_t code_cap;
+  struct loop_scope *loop;
+  size_t depth;  /* redirections in effect */
+};
+
+static size_t emit(struct compiler *c, enum opcode op, uint32_t a, uint32_t b, uint32_t arg) {
+  struct program *prog = c->prog;
+  if (prog->ncode == c->code_cap) {
+    c->code_cap = c->code_cap ? c->code_cap * 2 : 32;
+    prog->code = realloc(prog->code, c->code_cap * sizeof(struct insn));
+  }
+  prog->code[prog->ncode] = (struct insn) {op, a, b, arg};
+  return prog->ncode++;
+}
+
+/* Points the jump at the target of instruction at to here. */
+static void patch(struct compiler *c, size_t at) {
+  struct insn *in = &c->prog->code[at];
+  uint32_t here = c->prog->ncode;
+  if (in->op == OP_FOR_NEXT || in->op == OP_MATCH)
+    in->c = here;
+  else if (in->op == OP_REDIR)
+    in->b = here;
+  else
+    in->a = here;
+}
+
+/* Takes the words over. */
+static uint32_t add_cmd(struct compiler *c, struct tokens *words) {
+  struct program *prog = c->prog;
+  prog->cmds = realloc(prog->cmds, (prog->ncmds + 1) * sizeof(struct tokens *));
+  prog->cmds[prog->ncmds] = words;
+  return prog->ncmds++;
+}
+
+static uint32_t add_string(struct compiler *c, const char *s, struct glob_pattern *pattern) {
+  struct program *prog = c->prog;
+  prog->strings = realloc(prog->strings, (prog->nstrings + 1) * sizeof(char *));
+  prog->patterns = realloc(prog->patterns, (prog->nstrings + 1) * sizeof(struct glob_pattern *));
+  prog->strings[prog->nstrings] = strdup(s);
+  prog->patterns[prog->nstrings] = pattern;
+  return prog->nstrings++;
+}
+
+/* Whether expanding the word as written can only take its quotes off. */
+static bool is_literal(const char *raw) {
+  return strpbrk(raw, "$`") == NULL && raw[0] != '~' &&
+    !((raw[0] == '<' || raw[0] == '>') && raw[1] == '(');
+}
+
+/* break [n] and continue [n]: the redirections in the loops they leave are undone, and
+ * the loop's status is 0. */
+static bool compile_jump_out(struct compiler *c, struct tokens *words) {
+  bool is_break = tokens_is_op(words, 0, "break");
+  if (!is_break && !tokens_is_op(words, 0, "continue"))
+    return false;
+  size_t len = tokens_get_length(words);
+  long n = 1;
+  if (len == 2) {
+    char *end;
+    n = strtol(tokens_get_raw(words, 1), &end, 10);
+    if (*end != '\0' || n < 1)
+      return false;
+  }
+  if (len > 2)
+    return false;
+
+  emit(c, OP_STATUS, 0, 0, 0);
+  struct loop_scope *loop = c->loop;
+  if (loop == NULL)
+    return true;
+  while (--n > 0 && loop->outer)
+    loop = loop->outer;
+  for (size_t d = c->depth; d > loop->depth; d--)
+    emit(c, OP_UNREDIR, 0, 0, 0);
+  emit(c, OP_SAVE, loop->slot, 0, 0);
+  if (is_break) {
+    loop->breaks = realloc(loop->breaks, (loop->nbreaks + 1) * sizeof(size_t));
+    loop->breaks[loop->nbreaks++] = emit(c, OP_JUMP, 0, 0, 0);
+  } else {
+    emit(c, OP_JUMP, loop->top, 0, 0);
+  }
+  return true;
+}
+
+/* A simple command gets the fast path: its words expanded, then a builtin called or a
+ * program spawned. Anything with pipes, redirections, assignments or & goes through
+ * exeTokens(). */
+static void compile_cmd(struct compiler *c, struct node *node) {
+  struct tokens *words = node->words;
+  size_t len = tokens_get_length(words);
+  if (len == 0 || compile_jump_out(c, words))
+    return;
+  if (arith_command_words(words, 0) == len) {
+    char *text = arith_command_text(words, 0, len);
+    emit(c, OP_ARITH, add_string(c, text, NULL), is_literal(text), 0);
+    free(text);
+    return;
+  }
+  if (test_command_words(words, 0) == len) {
+    emit(c, OP_TEST, add_cmd(c, words), 0, 0);
+    node->words = NULL;
+    return;
+  }
+  /* (( )) or [[ ]] with redirections after it */
+  bool simple = !vars_is_assignment(tokens_get_raw(words, 0), NULL) &&
+      arith_command_words(words, 0) + test_command_words(words, 0) == 0, literal = true;
+  for (size_t i = 0; i < len && simple; i++) {
+    const char *raw = tokens_get_raw(words, i);
+    simple = !tokens_is_op(words, i, "|") && !tokens_is_op(words, i, "&") && redir_op_length(raw) == 0;
+    literal &= is_literal(raw) && strpbrk(raw, "*?[") == NULL;
+  }
+  uint32_t cmd = add_cmd(c, words);
+  node->words = NULL;
+  if (!simple) {
+    emit(c, OP_RUN, cmd, 0, 0);
+    return;
+  }
+  emit(c, OP_EXPAND, cmd, literal, 0);
+  const char *raw = tokens_get_raw(words, 0);
+  bool builtin = !is_literal(raw) || lookup(tokens_get_token(words, 0)) != NULL;
+  emit(c, builtin ? OP_BUILTIN : OP_SPAWN, 0, 0, 0);
+}
+
+static void compile_node(struct compiler *c, struct node *node);
+
+static void compile_loop(struct compiler *c, struct node *node) {
+  struct loop_scope loop = {c->prog->nslots++, c->depth, 0, NULL, 0, c->loop};
+  size_t test;
+  if (node->kind == NODE_FOR) {
+    uint32_t words = node->words ? add_cmd(c, node->words) : add_cmd(c, tokenize("\"$@\""));
+    node->words = NULL;
+    emit(c, OP_LOOP_INIT, loop.slot, words, 0);
+    loop.top = c->prog->ncode;
+    test = emit(c, OP_FOR_NEXT, loop.slot, add_string(c, node->name, NULL), 0);
+  } else {
+    emit(c, OP_LOOP_INIT, loop.slot, BYTECODE_NONE, 0);
+    loop.top = c->prog->ncode;
+    compile_node(c, node->kids[0]);
+    test = emit(c, node->kind == NODE_WHILE ? OP_JUMP_FALSE : OP_JUMP_TRUE, 0, 0, 0);
+  }
+  c->loop = &loop;
+  compile_node(c, node->kids[node->nkids - 1]);
+  c->loop = loop.outer;
+  emit(c, OP_SAVE, loop.slot, 0, 0);
+  emit(c, OP_JUMP, loop.top, 0, 0);
+  patch(c, test);
+  for (size_t i = 0; i < loop.nbreaks; i++)
+    patch(c, loop.breaks[i]);
+  free(loop.breaks);
+  emit(c, OP_LOOP_END, loop.slot, 0, 0);
+}
+
+static void compile_case(struct compiler *c, struct node *node) {
+  uint32_t slot = c->prog->nslots++;
+  emit(c, OP_CASE, slot, add_string(c, node->name, NULL), 0);
+  size_t *matches = NULL, nmatches = 0;
+  for (size_t k = 0; k < node->nkids; k++) {
+    for (char **p = node->patterns[k]; *p; p++) {
+      struct glob_pattern *compiled = NULL;
+      if (is_literal(*p)) {
+        char *pattern = expand_pattern(*p);
+        compiled = glob_pattern_new(pattern);
+        free(pattern);
+      }
+      matches = realloc(matches, (nmatches + 1) * sizeof(size_t));
+      matches[nmatches++] = emit(c, OP_MATCH, slot, add_string(c, *p, compiled), 0);
+    }
+  }
+  emit(c, OP_STATUS, 0, 0, 0);
+  size_t *ends = malloc((node->nkids + 1) * sizeof(size_t));
+  ends[0] = emit(c, OP_JUMP, 0, 0, 0);
+  size_t m = 0;
+  for (size_t k = 0; k < node->nkids; k++) {
+    for (char **p = node->patterns[k]; *p; p++)
+      patch(c, matches[m++]);
+    if (node->kids[k]->nkids == 0)
+      emit(c, OP_STATUS, 0, 0, 0);
+    compile_node(c, node->kids[k]);
+    ends[k + 1] = emit(c, OP_JUMP, 0, 0, 0);
+  }
+  for (size_t k = 0; k <= node->nkids; k++)
+    patch(c, ends[k]);
+  free(ends);
+  free(matches);
+}
+
+/* Compiles node, if there is one, into a program of its own among the bodies; a break in
+ * it doesn't reach the loops around it. */
+static uint32_t add_body(struct compiler *c, struct node *node) {
+  struct program *prog = c->prog;
+  prog->bodies = realloc(prog->bodies, (prog->nbodies + 1) * sizeof(struct program *));
+  prog->bodies[prog->nbodies] = NULL;
+  if (node != NULL) {
+    struct compiler inner = {calloc(1, sizeof(struct program)), 0, NULL, 0};
+    inner.prog->refs = 1;
+    compile_node(&inner, node);
+    prog->bodies[prog->nbodies] = inner.prog;
+  }
+  return prog->nbodies++;
+}
+
+/* The body becomes a program of its own; redirections written after it apply to every
+ * call. */
+static void compile_function(struct compiler *c, struct node *node) {
+  struct node *body = node->kids[0];
+  body->redirs = node->redirs;
+  node->redirs = NULL;
+  emit(c, OP_DEFINE, add_body(c, body), add_string(c, node->name, NULL), 0);
+}
+
+/* Simple stages go to exeTokens() as one command, as they always have. A compound stage
+ * is compiled into a body that makePipes() runs in the stage's child, and stands in the
+ * command as an empty word; a ( list ) stage is in a child already and doesn't fork
+ * again. */
+static void compile_pipe(struct compiler *c, struct node *node) {
+  bool compound = false;
+  for (size_t k = 0; k < node->nkids; k++)
+    compound |= node->kids[k]->kind != NODE_CMD;
+  struct tokens *words = tokens_create();
+  uint32_t first = c->prog->nbodies;
+  for (size_t k = 0; k < node->nkids; k++) {
+    struct node *stage = node->kids[k];
+    if (k > 0)
+      tokens_append(words, "|", NULL);
+    if (stage->kind == NODE_CMD) {
+      for (size_t i = 0; i < tokens_get_length(stage->words); i++)
+        tokens_append(words, tokens_get_token(stage->words, i), tokens_get_raw(stage->words, i));
+      if (compound)
+        add_body(c, NULL);
+      continue;
+    }
+    tokens_append(words, "", "\"\"");
+    if (stage->kind == NODE_SUBSHELL) {
+      stage->kids[0]->redirs = stage->redirs;
+      stage->redirs = NULL;
+      stage = stage->kids[0];
+    }
+    add_body(c, stage);
+  }
+  if (compound)
+    emit(c, OP_PIPE, add_cmd(c, words), first, node->nkids);
+  else
+    emit(c, OP_RUN, add_cmd(c, words), 0, 0);
+}
+
+static void compile_node(struct compiler *c, struct node *node) {
+  size_t redir = SIZE_MAX;
+  if (node->redirs) {
+    redir = emit(c, OP_REDIR, add_cmd(c, node->redirs), 0, 0);
+    node->redirs = NULL;
+    c->prog->nredirs++;
+    c->depth++;
+  }
+
+  size_t skip, end;
+  switch (node->kind) {
+  case NODE_CMD:
+    compile_cmd(c, node);
+    break;
+  case NODE_LIST:
+    for (size_t k = 0; k < node->nkids; k++)
+      compile_node(c, node->kids[k]);
+    break;
+  case NODE_PIPE:
+    compile_pipe(c, node);
+    break;
+  case NODE_ANDOR:
+    compile_node(c, node->kids[0]);
+    for (size_t k = 1; k < node->nkids; k++) {
+      skip = emit(c, node->or[k] ? OP_JUMP_TRUE : OP_JUMP_FALSE, 0, 0, 0);
+      compile_node(c, node->kids[k]);
+      patch(c, skip);
+    }
+    break;
+  case NODE_IF:
+    /* No branch taken leaves $? 0, not the condition's status. */
+    compile_node(c, node->kids[0]);
+    skip = emit(c, OP_JUMP_FALSE, 0, 0, 0);
+    compile_node(c, node->kids[1]);
+    end = emit(c, OP_JUMP, 0, 0, 0);
+    patch(c, skip);
+    if (node->nkids > 2)
+      compile_node(c, node->kids[2]);
+    else
+      emit(c, OP_STATUS, 0, 0, 0);
+    patch(c, end);
+    break;
+  case NODE_WHILE:
+  case NODE_UNTIL:
+  case NODE_FOR:
+    compile_loop(c, node);
+    break;
+  case NODE_CASE:
+    compile_case(c, node);
+    break;
+  case NODE_FUNCTION:
+    compile_function(c, node);
+    break;
+  case NODE_GROUP:
+    compile_node(c, node->kids[0]);
+    break;
+  case NODE_SUBSHELL:
+    emit(c, OP_SUBSHELL, add_body(c, node->kids[0]), 0, 0);
+    break;
+  }
+
+  if (redir != SIZE_MAX) {
+    emit(c, OP_UNREDIR, 0, 0, 0);
+    c->depth--;
+    patch(c, redir);
+  }
+}
+
+struct program *bytecode_compile(struct tokens *first, int sep, bytecode_next_fn *next, void *ctx) {
+  first = split_parens(first);
+  struct parser p = {next, ctx, first, 0, tokens_get_length(first), sep, false, false, false};
+  struct node *tree = parse_andor(&p);
+  if (!p.failed && p.pos < p.len)
+    syntax_error(&p, NULL);
+  tokens_destroy(p.cur);
+  if (p.failed) {
+    node_free(tree);
+    return NULL;
+  }
+
+  struct compiler c = {calloc(1, sizeof(struct program)), 0, NULL, 0};
+  c.prog->refs = 1;
+  compile_node(&c, tree);
+  node_free(tree);
+  return c.prog;
+}
+
+void bytecode_ref(struct program *prog) {
+  prog->refs++;
+}
+
+void bytecode_free(struct program *prog) {
+  if (prog == NULL || --prog->refs > 0)
+    return;
+  for (size_t i = 0; i < prog->nbodies; i++)
+    bytecode_free(prog->bodies[i]);
+  free(prog->bodies);
+  for (size_t i = 0; i < prog->ncmds; i++)
+    tokens_destroy(prog->cmds[i]);
+  for (size_t i = 0; i < prog->nstrings; i++) {
+    free(prog->strings[i]);
+    glob_pattern_free(prog->patterns[i]);
+  }
+  free(prog->cmds);
+  free(prog->strings);
+  free(prog->patterns);
+  free(prog->code);
+  free(prog);
+}
@@ -0,0 +1,752 @@
+#define _GNU_SOURCE
+#include <ctype.h>
+#include <pwd.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "arith.h"
+#include "cmdsub.h"
+#include "expand.h"
+#include "glob.h"
+#include "redir.h"
+#include "shell.h"
+#include "vars.h"
+
+/* $0 and $1..$N */
+static char *param_zero = "shell";
+static char **params;
+static int nparams;
+static pid_t shell_pid;
+
+void expand_set_params(char *zero, int argc, char **argv) {
+  param_zero = zero;
+  params = argv;
+  nparams = argc;
+}
+
+void expand_get_params(char **zero, int *argc, char ***argv) {
+  *zero = param_zero;
+  *argc = nparams;
+  *argv = params;
+}
+
+/* The fields of one word are built in a single growable buffer, each ended by a '\0' and
+ * remembered by offset, so expanding a word costs no allocation once the buffer is big
+ * enough. The buffers live as long as the expander, which covers a whole command.
+ * Alongside each field goes its glob pattern: the same bytes, with a backslash before
+ * the ones that were quoted. */
+struct field {
+  size_t start;
+  size_t pattern;
+  bool glob;
+};
+
+struct expander {
+  char *buf;
+  size_t len, cap;
+  char *pat;
+  size_t pat_len, pat_cap;
+  struct field *fields;
+  size_t nfields, fields_cap;
+  size_t cur;    /* where the field being built starts */
+  size_t pat_cur;
+  bool have;     /* the field exists even if empty, because it had quotes */
+  bool no_params; /* the double quotes being read held a "$@" with no parameters */
+  bool magic;    /* the field has an unquoted *, ? or [ */
+  bool split;    /* split unquoted expansions on IFS */
+  bool globbing; /* and expand patterns in them */
+  bool regex;    /* the pattern is an extended regex, not a glob */
+  bool failed;
+  bool ifs[256], ifs_space[256];
+  int ifs_first; /* joins "$*", -1 for none */
+  char *quoted;  /* requote() output */
+  size_t quoted_cap;
+};
+
+static void expander_init(struct expander *x) {
+  memset(x, 0, sizeof(*x));
+  const char *ifs = vars_get("IFS");
+  if (ifs == NULL)
+    ifs = " \t\n";
+  for (const unsigned char *c = (const unsigned char *) ifs; *c; c++) {
+    x->ifs[*c] = true;
+    x->ifs_space[*c] = *c == ' ' || *c == '\t' || *c == '\n';
+  }
+  x->ifs_first = ifs[0] ? (unsigned char) ifs[0] : -1;
+}
+
+/* split: split unquoted expansions into fields and glob them */
+static void expander_reset(struct expander *x, bool split) {
+  x->len = x->cur = x->nfields = 0;
+  x->pat_len = x->pat_cur = 0;
+  x->have = x->magic = false;
+  x->split = x->globbing = split;
+}
+
+static void expander_free(struct expander *x) {
+  free(x->buf);
+  free(x->pat);
+  free(x->fields);
+  free(x->quoted);
+}
+
+static void grow(char **buf, size_t *cap, size_t need) {
+  if (need > *cap) {
+    while (need > *cap)
+      *cap = *cap ? *cap * 2 : 256;
+    *buf = realloc(*buf, *cap);
+  }
+}
+
+/* Appends bytes to the field. Unquoted (active) bytes go into the glob pattern as they
+ * are; quoted ones are escaped there so they only match themselves. */
+static void put(struct expander *x, const char *s, size_t n, bool active) {
+  grow(&x->buf, &x->cap, x->len + n + 1);
+  memcpy(x->buf + x->len, s, n);
+  x->len += n;
+  if (!x->globbing)
+    return;
+  grow(&x->pat, &x->pat_cap, x->pat_len + 2 * n + 1);
+  for (size_t i = 0; i < n; i++) {
+    char c = s[i];
+    if (active) {
+      if (c == '*' || c == '?' || c == '[')
+        x->magic = true;
+    } else if (strchr(x->regex ? "\\.[]()*+?{}|^$" : "*?[]\\", c) != NULL) {
+      x->pat[x->pat_len++] = '\\';
+    }
+    x->pat[x->pat_len++] = c;
+  }
+}
+
+static void put_char(struct expander *x, char c, bool active) {
+  put(x, &c, 1, active);
+}
+
+/* Finishes the current field; an empty one only counts if it was quoted. */
+static void field_end(struct expander *x) {
+  if (x->len == x->cur && !x->have)
+    return;
+  grow(&x->buf, &x->cap, x->len + 1);
+  x->buf[x->len++] = '\0';
+  if (x->nfields == x->fields_cap) {
+    x->fields_cap = x->fields_cap ? x->fields_cap * 2 : 8;
+    x->fields = realloc(x->fields, x->fields_cap * sizeof(struct field));
+  }
+  struct field *f = &x->fields[x->nfields++];
+  f->start = x->cur;
+  f->pattern = x->pat_cur;
+  f->glob = false;
+  if (x->globbing) {
+    grow(&x->pat, &x->pat_cap, x->pat_len + 1);
+    x->pat[x->pat_len++] = '\0';
+    f->glob = x->magic && glob_has_magic(x->pat + x->pat_cur);
+  }
+  x->cur = x->len;
+  x->pat_cur = x->pat_len;
+  x->have = x->magic = false;
+}
+
+/* Appends the result of an expansion. Unquoted, IFS whitespace separates fields and
+ * any other IFS character ends one, even an empty one. */
+static void put_value(struct expander *x, const char *v, size_t n, bool quoted) {
+  if (quoted || !x->split) {
+    put(x, v, n, !quoted);
+    return;
+  }
+  size_t run = 0;
+  for (size_t i = 0; i < n; i++) {
+    unsigned char c = v[i];
+    if (!x->ifs[c]) {
+      run++;
+      continue;
+    }
+    put(x, v + i - run, run, true);
+    run = 0;
+    if (!x->ifs_space[c])
+      x->have = true;
+    field_end(x);
+  }
+  put(x, v + n - run, run, true);
+}
+
+static void put_number(struct expander *x, long long n) {
+  char tmp[24];
+  put(x, tmp, snprintf(tmp, sizeof(tmp), "%lld", n), false);
+}
+
+/* "$@" is one field per parameter, "$*" one field joined by IFS[0], and either unquoted
+ * is every parameter split on its own; the same goes for "${array[@]}". */
+static void put_list(struct expander *x, char *const *list, int n, char which, bool quoted) {
+  if (quoted && which == '@') {
+    if (n == 0)
+      x->no_params = true;
+    for (int k = 0; k < n; k++) {
+      if (k > 0) {
+        x->have = true;
+        field_end(x);
+      }
+      put(x, list[k], strlen(list[k]), false);
+    }
+    return;
+  }
+  for (int k = 0; k < n; k++) {
+    if (k > 0) {
+      if (quoted && x->ifs_first >= 0)
+        put_char(x, x->ifs_first, false);
+      else if (!quoted)
+        field_end(x);
+    }
+    put_value(x, list[k], strlen(list[k]), quoted);
+  }
+}
+
+static void put_params(struct expander *x, char which, bool quoted) {
+  put_list(x, params, nparams, which, quoted);
+}
+
+static bool is_name_start(char c) {
+  return isalpha((unsigned char) c) || c == '_';
+}
+
+static bool is_name_char(char c) {
+  return isalnum((unsigned char) c) || c == '_';
+}
+
+/* Looks up $name; false if name is not a parameter at all, else *value is its value or
+ * NULL when unset. $@ and $* come back as "@" when there are parameters. */
+static bool param_lookup(const char *name, size_t len, char tmp[32], const char **value) {
+  *value = NULL;
+  if (len == 0)
+    return false;
+  if (isdigit((unsigned char) name[0])) {
+    long k = 0;
+    for (size_t i = 0; i < len; i++) {
+      if (!isdigit((unsigned char) name[i]) || k > 1000000)
+        return false;
+      k = k * 10 + name[i] - '0';
+    }
+    if (k == 0)
+      *value = param_zero;
+    else if (k <= nparams)
+      *value = params[k - 1];
+    return true;
+  }
+  if (len == 1 && !is_name_start(name[0])) {
+    switch (name[0]) {
+    case '?':
+      snprintf(tmp, 32, "%d", shell_last_status);
+      break;
+    case '$':
+      if (shell_pid == 0)
+        shell_pid = getpid();
+      snprintf(tmp, 32, "%d", (int) shell_pid);
+      break;
+    case '#':
+      snprintf(tmp, 32, "%d", nparams);
+      break;
+    case '@':
+    case '*':
+      *value = nparams ? "@" : NULL;
+      return true;
+    default:
+      return false;
+    }
+    *value = tmp;
+    return true;
+  }
+  char var[256];
+  if (len >= sizeof(var) || !is_name_start(name[0]))
+    return false;
+  for (size_t i = 1; i < len; i++)
+    if (!is_name_char(name[i]))
+      return false;
+  memcpy(var, name, len);
+  var[len] = '\0';
+  *value = vars_get(var);
+  return true;
+}
+
+static void put_param(struct expander *x, const char *name, const char *value, bool quoted) {
+  if (name[0] == '@' || name[0] == '*')
+    put_params(x, name[0], quoted);
+  else if (value)
+    put_value(x, value, strlen(value), quoted);
+}
+
+static void expand_text(struct expander *x, const char *s, size_t n, bool dquote, bool tilde, bool assign);
+
+/* The word of ${name-word} as a plain string, for := and :? */
+static char *expand_to_string(const char *s, size_t n) {
+  struct expander x;
+  expander_init(&x);
+  expander_reset(&x, false);
+  expand_text(&x, s, n, false, true, false);
+  put_char(&x, '\0', false);
+  char *result = strdup(x.buf);
+  expander_free(&x);
+  return result;
+}
+
+/* ${name[@]} and ${#name[@]}, j being just after the ]. */
+static void expand_array(struct expander *x, const char *name, size_t name_len, char which,
+    bool length, bool quoted, const char *body, size_t j, size_t n) {
+  char var[name_len + 1];
+  memcpy(var, name, name_len);
+  var[name_len] = '\0';
+  size_t count = vars_array_length(var);
+  if (j != n) {
+    fprintf(stderr, "${%.*s}: bad substitution\n", (int) n, body);
+    x->failed = true;
+  } else if (length) {
+    put_number(x, count);
+  } else {
+    char **list = malloc((count + 1) * sizeof(char *));
+    for (size_t k = 0; k < count; k++)
+      list[k] = (char *) vars_array_get(var, k);
+    put_list(x, list, count, which, quoted);
+    free(list);
+  }
+}
+
+/* ${name}, ${#name} and ${name[:]-=+?word}, where name may be array[index]; body is what
+ * is between the braces. */
+static void expand_brace(struct expander *x, const char *body, size_t n, bool quoted) {
+  size_t j = 0;
+  bool length = n > 1 && body[0] == '#';
+  if (length)
+    j = 1;
+  size_t name_start = j;
+  if (j < n && is_name_start(body[j])) {
+    while (j < n && is_name_char(body[j]))
+      j++;
+  } else if (j < n && isdigit((unsigned char) body[j])) {
+    while (j < n && isdigit((unsigned char) body[j]))
+      j++;
+  } else if (j < n) {
+    j++;
+  }
+  const char *name = body + name_start;
+  size_t name_len = j - name_start;
+  char tmp[32], element[288];
+  const char *value;
+  if (!param_lookup(name, name_len, tmp, &value))
+    goto bad;
+  if (j < n && body[j] == '[' && is_name_start(name[0])) {
+    const char *close = memchr(body + j, ']', n - j);
+    if (close == NULL)
+      goto bad;
+    const char *sub = body + j + 1;
+    size_t sub_len = close - sub;
+    j = close - body + 1;
+    if (sub_len == 1 && (sub[0] == '@' || sub[0] == '*')) {
+      expand_array(x, name, name_len, sub[0], length, quoted, body, j, n);
+      return;
+    }
+    char *expr = expand_to_string(sub, sub_len);
+    long long index;
+    int rc = arith_eval(expr, &index);
+    free(expr);
+    if (rc == -1) {
+      x->failed = true;
+      return;
+    }
+    if (index < 0)
+      goto bad;
+    name_len = snprintf(element, sizeof(element), "%.*s[%lld]", (int) name_len, name, index);
+    name = element;
+    value = vars_get(element);
+  }
+  if (length && j != n)
+    goto bad;
+
+  if (length) {
+    if (name[0] == '@' || name[0] == '*')
+      put_number(x, nparams);
+    else
+      put_number(x, value ? (long) strlen(value) : 0);
+    return;
+  }
+  if (j == n) {
+    put_param(x, name, value, quoted);
+    return;
+  }
+
+  bool colon = body[j] == ':';
+  if (colon)
+    j++;
+  if (j >= n || strchr("-=+?", body[j]) == NULL)
+    goto bad;
+  char op = body[j++];
+  const char *word = body + j;
+  size_t word_len = n - j;
+  bool set = value != NULL && !(colon && value[0] == '\0');
+
+  switch (op) {
+  case '-':
+    if (set)
+      put_param(x, name, value, quoted);
+    else
+      expand_text(x, word, word_len, quoted, true, false);
+    break;
+  case '+':
+    if (set)
+      expand_text(x, word, word_len, quoted, true, false);
+    break;
+  case '=':
+    if (set) {
+      put_param(x, name, value, quoted);
+    } else if (!is_name_start(name[0])) {
+      fprintf(stderr, "$%.*s: cannot assign in this way\n", (int) name_len, name);
+      x->failed = true;
+    } else {
+      char *var = strndup(name, name_len);
+      char *assigned = expand_to_string(word, word_len);
+      if (vars_set(var, assigned, 0) == -1) {
+        fprintf(stderr, "%s: readonly variable\n", var);
+        x->failed = true;
+      }
+      put_value(x, assigned, strlen(assigned), quoted);
+      free(assigned);
+      free(var);
+    }
+    break;
+  case '?':
+    if (set) {
+      put_param(x, name, value, quoted);
+    } else {
+      char *message = word_len ? expand_to_string(word, word_len) : NULL;
+      fprintf(stderr, "%.*s: %s\n", (int) name_len, name,
+          message ? message : "parameter null or not set");
+      free(message);
+      x->failed = true;
+    }
+    break;
+  }
+  return;
+
+bad:
+  fprintf(stderr, "${%.*s}: bad substitution\n", (int) n, body);
+  x->failed = true;
+}
+
+/* Index of the '}' closing a ${ whose body starts at from, or n. */
+static size_t brace_end(const char *s, size_t from, size_t n, bool quoted) {
+  int depth = 1;
+  for (size_t j = from; j < n; j++) {
+    char c = s[j];
+    if (c == '\\') {
+      j++;
+    } else if (c == '\'' && !quoted) {
+      while (++j < n && s[j] != '\'')
+        ;
+    } else if (c == '"') {
+      while (++j < n && s[j] != '"')
+        if (s[j] == '\\')
+          j++;
+    } else if (c == '{' && j > 0 && s[j - 1] == '$') {
+      depth++;
+    } else if (c == '}' && --depth == 0) {
+      return j;
+    }
+  }
+  return n;
+}
+
+/* Expands the $ at s[i]; returns the index of the last byte it used. */
+static size_t expand_dollar(struct expander *x, const char *s, size_t i, size_t n, bool quoted) {
+  char tmp[32];
+  const char *value;
+  if (i + 1 >= n) {
+    put_char(x, '$', !quoted);
+    return i;
+  }
+  char c = s[i + 1];
+  if (c == '(') {
+    size_t end = tokens_subst_end(s, i + 1, n);
+    if (s[end] != ')') {
+      put_char(x, '$', !quoted);
+      return i;
+    }
+    if (s[i + 2] == '(' && tokens_subst_end(s, i + 2, n) == end - 1) {
+      /* $((expr)): expanded, then evaluated in the shell */
+      char *expr = expand_to_string(s + i + 3, end - i - 4);
+      long long value;
+      if (arith_eval(expr, &value) == -1)
+        x->failed = true;
+      else
+        put_number(x, value);
+      free(expr);
+      return end;
+    }
+    size_t len;
+    char *out = cmdsub_run(s + i + 2, end - i - 2, &len);
+    put_value(x, out, len, quoted);
+    free(out);
+    return end;
+  }
+  if (c == '{') {
+    size_t end = brace_end(s, i + 2, n, quoted);
+    if (end >= n) {
+      put_char(x, '$', !quoted);
+      return i;
+    }
+    expand_brace(x, s + i + 2, end - i - 2, quoted);
+    return end;
+  }
+  if (is_name_start(c)) {
+    size_t j = i + 1;
+    while (j < n && is_name_char(s[j]))
+      j++;
+    param_lookup(s + i + 1, j - i - 1, tmp, &value);
+    if (value)
+      put_value(x, value, strlen(value), quoted);
+    return j - 1;
+  }
+  if (param_lookup(s + i + 1, 1, tmp, &value)) {
+    put_param(x, s + i + 1, value, quoted);
+    return i + 1;
+  }
+  put_char(x, '$', !quoted);
+  return i;
+}
+
+/* ~ and ~user at s[i], up to the next '/' (or ':' in an assignment). */
+static size_t expand_tilde(struct expander *x, const char *s, size_t i, size_t n, bool assign) {
+  size_t j = i + 1;
+  while (j < n && s[j] != '/' && !(assign && s[j] == ':')) {
+    if (strchr("'\"\\$", s[j]) != NULL) {
+      put_char(x, '~', false);
+      return i;
+    }
+    j++;
+  }
+  const char *home = NULL;
+  if (j == i + 1) {
+    home = vars_get("HOME");
+    if (home == NULL) {
+      struct passwd *pw = getpwuid(getuid());
+      home = pw ? pw->pw_dir : NULL;
+    }
+  } else {
+    char *user = strndup(s + i + 1, j - i - 1);
+    struct passwd *pw = getpwnam(user);
+    free(user);
+    home = pw ? pw->pw_dir : NULL;
+  }
+  if (home == NULL) {
+    put_char(x, '~', false);
+    return i;
+  }
+  put(x, home, strlen(home), false);
+  return j - 1;
+}
+
+/* `cmd` at s[i]: inside, \$ \` and \\ stand for the byte itself. */
+static size_t expand_backquote(struct expander *x, const char *s, size_t i, size_t n, bool quoted) {
+  size_t end = tokens_subst_end(s, i, n);
+  if (s[end] != '`' || end == i) {
+    put_char(x, '`', false);
+    return i;
+  }
+  char *cmd = malloc(end - i);
+  size_t len = 0;
+  for (size_t k = i + 1; k < end; k++) {
+    if (s[k] == '\\' && k + 1 < end && strchr("$`\\", s[k + 1]) != NULL)
+      k++;
+    cmd[len++] = s[k];
+  }
+  size_t out_len;
+  char *out = cmdsub_run(cmd, len, &out_len);
+  put_value(x, out, out_len, quoted);
+  free(out);
+  free(cmd);
+  return end;
+}
+
+/* The quoting rules are the tokenizer's (a backslash quotes any byte outside quotes, only
+ * $ ` " \ and newline between double quotes, nothing between single quotes), plus $ and `
+ * expanding outside single quotes and ~ at the start of a word. */
+static void expand_text(struct expander *x, const char *s, size_t n, bool dquote, bool tilde, bool assign) {
+  const int MODE_NORMAL = 0,
+        MODE_SQUOTE = 1,
+        MODE_DQUOTE = 2;
+  int mode = dquote ? MODE_DQUOTE : MODE_NORMAL;
+  size_t opened = x->len; /* where the double quotes being read began */
+
+  for (size_t i = 0; i < n; i++) {
+    char c = s[i];
+    if (c == '\\' && mode == MODE_DQUOTE && i + 1 < n && strchr("$`\"\\\n", s[i + 1]) == NULL) {
+      put_char(x, c, false);
+    } else if (c == '\\' && mode != MODE_SQUOTE) {
+      if (i + 1 < n)
+        put_char(x, s[++i], false);
+    } else if (mode == MODE_SQUOTE) {
+      if (c == '\'')
+        mode = MODE_NORMAL;
+      else
+        put_char(x, c, false);
+    } else if (c == '"' && mode == MODE_NORMAL) {
+      mode = MODE_DQUOTE;
+      opened = x->len;
+      x->no_params = false;
+    } else if (c == '"') {
+      /* Quotes make an empty field, unless all they held was "$@" with nothing in it. */
+      mode = MODE_NORMAL;
+      if (!x->no_params || x->len != opened)
+        x->have = true;
+    } else if (c == '\'' && mode == MODE_NORMAL) {
+      mode = MODE_SQUOTE;
+      x->have = true;
+    } else if (c == '$') {
+      i = expand_dollar(x, s, i, n, mode == MODE_DQUOTE);
+      if (x->failed)
+        return;
+    } else if (c == '`') {
+      i = expand_backquote(x, s, i, n, mode == MODE_DQUOTE);
+    } else if ((c == '<' || c == '>') && i == 0 && tilde && n > 1 && s[1] == '(') {
+      /* <(cmd) and >(cmd) become the path of a pipe from or to cmd */
+      size_t end = tokens_subst_end(s, 1, n);
+      const char *path = cmdsub_process(s + 2, end - 2, c == '>');
+      put_value(x, path, strlen(path), true);
+      i = end;
+    } else if (c == '~' && mode == MODE_NORMAL &&
+        (i == 0 ? tilde : assign && (s[i - 1] == '=' || s[i - 1] == ':'))) {
+      i = expand_tilde(x, s, i, n, assign);
+    } else {
+      put_char(x, c, mode == MODE_NORMAL);
+    }
+  }
+}
+
+static bool needs_expansion(const char *raw, bool assign) {
+  if (assign)
+    return strpbrk(raw, "$`") != NULL || strstr(raw, "=~") != NULL || strstr(raw, ":~") != NULL;
+  return strpbrk(raw, "$`*?[") != NULL || raw[0] == '~' ||
+    ((raw[0] == '<' || raw[0] == '>') && raw[1] == '(');
+}
+
+/* A field written so that tokenizing or expanding it again gives it back unchanged:
+ * special bytes after skip get a backslash. NULL if the field needs none. */
+static const char *requote(struct expander *x, const char *field, size_t skip) {
+  static const char special[] = " \t\n'\"\\$`*?[]~|&;<>(){}#=";
+  size_t n = strlen(field), extra = 0;
+  for (size_t i = skip; i < n; i++)
+    if (strchr(special, field[i]) != NULL)
+      extra++;
+  if (n == 0)
+    return "''";
+  if (extra == 0)
+    return NULL;
+  if (n + extra + 1 > x->quoted_cap) {
+    x->quoted_cap = n + extra + 1;
+    x->quoted = realloc(x->quoted, x->quoted_cap);
+  }
+  char *q = x->quoted;
+  memcpy(q, field, skip);
+  q += skip;
+  for (size_t i = skip; i < n; i++) {
+    if (strchr(special, field[i]) != NULL)
+      *q++ = '\\';
+    *q++ = field[i];
+  }
+  *q = '\0';
+  return x->quoted;
+}
+
+struct glob_add {
+  struct expander *x;
+  struct tokens *words;
+};
+
+static void add_match(const char *path, void *ctx) {
+  struct glob_add *g = ctx;
+  tokens_append(g->words, path, requote(g->x, path, 0));
+}
+
+struct tokens *expand_words(struct tokens *tokens) {
+  size_t len = tokens_get_length(tokens), nassign = 0, name_len;
+  cmdsub_status = -1;
+  while (nassign < len && vars_is_assignment(tokens_get_raw(tokens, nassign), NULL))
+    nassign++;
+
+  /* Most words have nothing to expand; only copy the list if one does. */
+  size_t first = 0;
+  while (first < len && !needs_expansion(tokens_get_raw(tokens, first), first < nassign))
+    first++;
+  if (first == len)
+    return tokens;
+
+  struct expander x;
+  expander_init(&x);
+  struct tokens *words = tokens_slice(tokens, 0, first);
+  for (size_t i = first; i < len && !x.failed; i++) {
+    const char *raw = tokens_get_raw(tokens, i);
+    bool assign = i < nassign;
+    if (!needs_expansion(raw, assign)) {
+      tokens_append(words, tokens_get_token(tokens, i), raw);
+      continue;
+    }
+    /* A here-string's word stays one word, even if it comes out empty. */
+    bool herestring = i > 0 && tokens_is_op(tokens, i - 1, "<<<");
+    expander_reset(&x, !assign && !herestring);
+    expand_text(&x, raw, strlen(raw), false, true, assign);
+    x.have |= herestring;
+    field_end(&x);
+    /* NAME= and a redirection operator (>$LOG, 2>>"$f") stay unquoted. */
+    size_t skip = assign ? 0 : redir_op_length(raw);
+    if (assign && vars_is_assignment(raw, &name_len))
+      skip = name_len + 1;
+    for (size_t f = 0; f < x.nfields && !x.failed; f++) {
+      const char *field = x.buf + x.fields[f].start;
+      if (x.fields[f].glob) {
+        struct glob_add g = {&x, words};
+        if (glob_expand(x.pat + x.fields[f].pattern, add_match, &g) > 0 || glob_nullglob)
+          continue;
+        if (glob_failglob) {
+          fprintf(stderr, "no match: %s\n", field);
+          x.failed = true;
+          continue;
+        }
+      }
+      tokens_append(words, field, requote(&x, field, skip));
+    }
+  }
+
+  glob_cache_clear();
+  bool failed = x.failed;
+  expander_free(&x);
+  if (failed) {
+    tokens_destroy(words);
+    return NULL;
+  }
+  return words;
+}
+
+static char *expand_matcher(const char *s, bool regex) {
+  struct expander x;
+  expander_init(&x);
+  expander_reset(&x, false);
+  x.globbing = true;
+  x.regex = regex;
+  x.have = true;
+  expand_text(&x, s, strlen(s), false, true, false);
+  field_end(&x);
+  char *pattern = strdup(x.nfields > 0 ? x.pat + x.fields[0].pattern : "");
+  expander_free(&x);
+  return pattern;
+}
+
+char *expand_pattern(const char *s) {
+  return expand_matcher(s, false);
+}
+
+char *expand_regex(const char *s) {
+  return expand_matcher(s, true);
+}
+
+char *expand_string(const char *s) {
+  return expand_to_string(s, strlen(s));
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include "tokenizer.h"
+
+/* Set $0 and the positional parameters $1..$N (the strings are not copied). */
+void expand_set_params(char *zero, int argc, char **argv);
+
+/* The ones set now, to put back after a function call. */
+void expand_get_params(char **zero, int *argc, char ***argv);
+
+/* Expand parameters, $(...) and `...`, ~, split unquoted results on IFS and glob them.
+ * Returns tokens itself when no word needed it, a new list otherwise, or NULL (after a
+ * message) if ${x:?} failed. Leading NAME=value words are not split. */
+struct tokens *expand_words(struct tokens *tokens);
+
+/* Expand one word without splitting or globbing it; the result is malloc()ed. */
+char *expand_string(const char *s);
+
+/* Expand one word into a pattern for glob_pattern_new(): quoted bytes come out escaped. */
+char *expand_pattern(const char *s);
+
+/* The same for regcomp() with REG_EXTENDED, for [[ =~ ]]. */
+char *expand_regex(const char *s);
@@ -0,0 +1,105 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "expand.h"
+#include "func.h"
+#include "shell.h"
+#include "vars.h"
+
+#define FUNC_BUCKETS 64
+
+/* Calls nested deeper than this fail instead of running the C stack out. */
+#define FUNC_MAX_DEPTH 1000
+
+struct function {
+  char *name;
+  struct program *body;
+  struct function *next;
+};
+
+static struct function *buckets[FUNC_BUCKETS];
+static int depth;
+
+bool func_returning;
+
+static unsigned int func_hash(const char *name) {
+  unsigned int h = 2166136261u;
+  for (; *name; name++)
+    h = (h ^ (unsigned char) *name) * 16777619u;
+  return h % FUNC_BUCKETS;
+}
+
+void func_define(const char *name, struct program *body) {
+  struct function **slot = &buckets[func_hash(name)];
+  while (*slot && strcmp((*slot)->name, name) != 0)
+    slot = &(*slot)->next;
+  bytecode_ref(body);
+  if (*slot) {
+    /* A call that is running the old body holds its own reference. */
+    bytecode_free((*slot)->body);
+    (*slot)->body = body;
+    return;
+  }
+  struct function *f = malloc(sizeof(struct function));
+  f->name = strdup(name);
+  f->body = body;
+  f->next = NULL;
+  *slot = f;
+}
+
+struct function *func_lookup(const char *name) {
+  struct function *f = buckets[func_hash(name)];
+  while (f && strcmp(f->name, name) != 0)
+    f = f->next;
+  return f;
+}
+
+int func_call(struct function *f, struct tokens *args) {
+  if (depth == FUNC_MAX_DEPTH) {
+    fprintf(stderr, "%s: functions nested too deep\n", f->name);
+    return 1;
+  }
+  size_t argc = tokens_get_length(args) - 1;
+  char *argv[argc + 1];
+  for (size_t i = 0; i < argc; i++)
+    argv[i] = tokens_get_token(args, i + 1);
+  argv[argc] = NULL;
+
+  char *zero, **saved_argv;
+  int saved_argc;
+  expand_get_params(&zero, &saved_argc, &saved_argv);
+  expand_set_params(zero, argc, argv);
+  vars_push_scope();
+  struct program *body = f->body;
+  bytecode_ref(body);
+  depth++;
+
+  int status = bytecode_run(body);
+
+  depth--;
+  bytecode_free(body);
+  func_returning = false;
+  vars_pop_scope();
+  expand_set_params(zero, saved_argc, saved_argv);
+  shell_last_status = status;
+  return status;
+}
+
+int cmd_return(struct tokens *tokens) {
+  if (depth == 0) {
+    fprintf(stderr, "return: not in a function\n");
+    return 1;
+  }
+  int status = shell_last_status;
+  if (tokens_get_length(tokens) > 1) {
+    char *end;
+    status = strtol(tokens_get_token(tokens, 1), &end, 10) & 0xff;
+    if (*end != '\0') {
+      fprintf(stderr, "return: %s: numeric argument required\n", tokens_get_token(tokens, 1));
+      status = 2;
+    }
+  }
+  func_returning = true;
+  return status;
+}
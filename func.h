@@ -0,0 +1,24 @@
+#pragma once
+
+#include <stdbool.h>
+#include "bytecode.h"
+#include "tokenizer.h"
+
+/* Functions defined with name() { list; }, compiled once and kept in a hash table like
+ * the builtins. */
+struct function;
+
+/* Defines or redefines name; the table takes a reference to body. */
+void func_define(const char *name, struct program *body);
+
+/* The function called name, or NULL. */
+struct function *func_lookup(const char *name);
+
+/* Runs f in the shell with args[1..] as $1..$N and a scope of its own for local; returns
+ * its status. */
+int func_call(struct function *f, struct tokens *args);
+
+/* Set by return until the function it ends has unwound. */
+extern bool func_returning;
+
+int cmd_return(struct tokens *tokens);
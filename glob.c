@@ -0,0 +1,911 @@
+#define _GNU_SOURCE
+#include <ctype.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include "glob.h"
+
+bool glob_nullglob;
+bool glob_failglob;
+bool glob_dotglob;
+bool glob_globstar;
+
+/* A pattern component compiled to a list of ops. Matching backtracks only to the last *,
+ * and most names are turned away by the length and literal-suffix checks before that. */
+enum { OP_CHAR, OP_ANY, OP_STAR, OP_CLASS };
+
+struct op {
+  unsigned char kind;
+  unsigned char c;
+  unsigned short cls;
+};
+
+struct pattern {
+  struct op *ops;
+  size_t nops;
+  unsigned char (*classes)[32];
+  size_t nclasses;
+  size_t min_len;   /* every op but * takes one byte */
+  char *suffix;     /* the literal bytes after the last *, compared first */
+  size_t suffix_len;
+  bool anchored;    /* no * at all: the name is exactly min_len long */
+  bool dot;         /* starts with a literal '.' */
+};
+
+static const struct {
+  const char *name;
+  int (*fn)(int);
+} char_classes[] = {
+  {"alpha", isalpha}, {"digit", isdigit}, {"alnum", isalnum}, {"upper", isupper},
+  {"lower", islower}, {"space", isspace}, {"punct", ispunct}, {"xdigit", isxdigit},
+  {"blank", isblank}, {"cntrl", iscntrl}, {"graph", isgraph}, {"print", isprint},
+};
+
+/* Parses the [...] starting at s[i] into bits (if not NULL). Returns the index of the
+ * closing ']', or 0 if there is none and the '[' is an ordinary byte. */
+static size_t parse_class(const char *s, size_t i, size_t n, unsigned char *bits) {
+  unsigned char set[32] = {0};
+  size_t j = i + 1;
+  bool negate = j < n && (s[j] == '!' || s[j] == '^');
+  if (negate)
+    j++;
+  size_t first = j;
+  for (; j < n; j++) {
+    unsigned char c = s[j];
+    if (c == ']' && j > first)
+      break;
+    if (c == '[' && j + 1 < n && s[j + 1] == ':') {
+      const char *end = memchr(s + j + 2, ':', n - j - 2);
+      if (end && end + 1 < s + n && end[1] == ']') {
+        size_t len = end - (s + j + 2);
+        for (size_t k = 0; k < sizeof(char_classes) / sizeof(char_classes[0]); k++) {
+          if (strlen(char_classes[k].name) == len && memcmp(char_classes[k].name, s + j + 2, len) == 0) {
+            for (int b = 1; b < 256; b++)
+              if (char_classes[k].fn(b))
+                set[b >> 3] |= 1 << (b & 7);
+          }
+        }
+        j = end + 1 - s;
+        continue;
+      }
+    }
+    if (c == '\\' && j + 1 < n)
+      c = s[++j];
+    unsigned char hi = c;
+    if (j + 2 < n && s[j + 1] == '-' && s[j + 2] != ']') {
+      j += 2;
+      hi = s[j];
+      if (hi == '\\' && j + 1 < n)
+        hi = s[++j];
+    }
+    for (unsigned int b = c; b <= hi; b++)
+      set[b >> 3] |= 1 << (b & 7);
+  }
+  if (j >= n)
+    return 0;
+  if (bits) {
+    for (int k = 0; k < 32; k++)
+      bits[k] = negate ? ~set[k] : set[k];
+    bits[0] &= ~1; /* never NUL */
+  }
+  return j;
+}
+
+bool glob_has_magic(const char *pattern) {
+  size_t n = strlen(pattern);
+  for (size_t i = 0; i < n; i++) {
+    char c = pattern[i];
+    if (c == '\\')
+      i++;
+    else if (c == '*' || c == '?')
+      return true;
+    else if (c == '[' && parse_class(pattern, i, n, NULL))
+      return true;
+  }
+  return false;
+}
+
+static bool has_magic(const char *s, size_t n) {
+  for (size_t i = 0; i < n; i++) {
+    if (s[i] == '\\')
+      i++;
+    else if (s[i] == '*' || s[i] == '?' || (s[i] == '[' && parse_class(s, i, n, NULL)))
+      return true;
+  }
+  return false;
+}
+
+static void compile(const char *s, size_t n, struct pattern *p) {
+  memset(p, 0, sizeof(*p));
+  p->ops = malloc((n + 1) * sizeof(struct op));
+  p->dot = n > 0 && s[0] == '.';
+  for (size_t i = 0; i < n; i++) {
+    struct op op = {OP_CHAR, (unsigned char) s[i], 0};
+    if (s[i] == '\\' && i + 1 < n) {
+      op.c = s[++i];
+      if (i == 1 && op.c == '.')
+        p->dot = true;
+    } else if (s[i] == '*') {
+      if (p->nops > 0 && p->ops[p->nops - 1].kind == OP_STAR)
+        continue;
+      op.kind = OP_STAR;
+    } else if (s[i] == '?') {
+      op.kind = OP_ANY;
+    } else if (s[i] == '[') {
+      p->classes = realloc(p->classes, (p->nclasses + 1) * 32);
+      size_t end = parse_class(s, i, n, p->classes[p->nclasses]);
+      if (end) {
+        op.kind = OP_CLASS;
+        op.cls = p->nclasses++;
+        i = end;
+      }
+    }
+    p->ops[p->nops++] = op;
+  }
+
+  size_t last_star = p->nops;
+  for (size_t k = 0; k < p->nops; k++) {
+    if (p->ops[k].kind == OP_STAR)
+      last_star = k;
+    else
+      p->min_len++;
+  }
+  p->anchored = last_star == p->nops;
+  if (!p->anchored) {
+    p->suffix = malloc(p->nops - last_star);
+    for (size_t k = last_star + 1; k < p->nops && p->ops[k].kind == OP_CHAR; k++)
+      p->suffix[p->suffix_len++] = p->ops[k].c;
+    if (last_star + 1 + p->suffix_len != p->nops)
+      p->suffix_len = 0; /* something other than plain bytes after the last * */
+  }
+}
+
+static void pattern_free(struct pattern *p) {
+  free(p->ops);
+  free(p->classes);
+  free(p->suffix);
+}
+
+static bool match(const struct pattern *p, const char *name, size_t n) {
+  if (n < p->min_len || (p->anchored && n != p->min_len))
+    return false;
+  if (p->suffix_len && memcmp(name + n - p->suffix_len, p->suffix, p->suffix_len) != 0)
+    return false;
+  if (name[0] == '.' && !p->dot && !glob_dotglob)
+    return false;
+
+  size_t k = 0, i = 0, star = SIZE_MAX, star_i = 0;
+  while (i < n) {
+    if (k < p->nops) {
+      const struct op *op = &p->ops[k];
+      unsigned char c = name[i];
+      if (op->kind == OP_STAR) {
+        star = k++;
+        star_i = i;
+        continue;
+      }
+      if (op->kind == OP_ANY || (op->kind == OP_CHAR && op->c == c) ||
+          (op->kind == OP_CLASS && (p->classes[op->cls][c >> 3] & (1 << (c & 7))))) {
+        k++;
+        i++;
+        continue;
+      }
+    }
+    if (star == SIZE_MAX)
+      return false;
+    k = star + 1;
+    i = ++star_i;
+  }
+  while (k < p->nops && p->ops[k].kind == OP_STAR)
+    k++;
+  return k == p->nops;
+}
+
+struct glob_pattern {
+  struct pattern p;
+};
+
+struct glob_pattern *glob_pattern_new(const char *pattern) {
+  struct glob_pattern *g = malloc(sizeof(*g));
+  compile(pattern, strlen(pattern), &g->p);
+  g->p.dot = true; /* a leading '.' is nothing special outside file names */
+  return g;
+}
+
+bool glob_pattern_match(const struct glob_pattern *g, const char *s) {
+  return match(&g->p, s, strlen(s));
+}
+
+void glob_pattern_free(struct glob_pattern *g) {
+  if (g == NULL)
+    return;
+  pattern_free(&g->p);
+  free(g);
+}
+
+/* One directory as read by getdents64: records of a length byte, the d_type byte, the
+ * name and a '\0', back to back. Kept by path in a dircache until that is cleared. */
+struct dirlist {
+  char *path;
+  char *data;
+  size_t len, cap;
+  struct dirlist *next;
+};
+
+#define DIR_BUCKETS 64
+
+/* The shell's cache lives for one command; every ** worker has one of its own. */
+struct dircache {
+  struct dirlist *buckets[DIR_BUCKETS];
+  char *dents;
+};
+
+static struct dircache shell_cache;
+
+struct linux_dirent64 {
+  uint64_t d_ino;
+  int64_t d_off;
+  unsigned short d_reclen;
+  unsigned char d_type;
+  char d_name[];
+};
+
+/* Big enough that a directory of a few thousand entries is one system call. */
+#define DENTS_SIZE (256 * 1024)
+
+static bool is_dot_or_dotdot(const char *name) {
+  return name[0] == '.' && (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'));
+}
+
+/* One getdents64 batch from fd into cache->dents; its size, or 0 at the end. */
+static long dents_read(struct dircache *cache, int fd) {
+  if (cache->dents == NULL)
+    cache->dents = malloc(DENTS_SIZE);
+  long got = syscall(SYS_getdents64, fd, cache->dents, DENTS_SIZE);
+  return got < 0 ? 0 : got;
+}
+
+static unsigned int dir_hash(const char *path) {
+  unsigned int h = 2166136261u;
+  for (; *path; path++)
+    h = (h ^ (unsigned char) *path) * 16777619u;
+  return h % DIR_BUCKETS;
+}
+
+static struct dirlist *dir_insert(struct dircache *cache, const char *path) {
+  unsigned int h = dir_hash(path);
+  struct dirlist *d = calloc(1, sizeof(*d));
+  d->path = strdup(path);
+  d->next = cache->buckets[h];
+  cache->buckets[h] = d;
+  return d;
+}
+
+static void dirlist_add(struct dirlist *d, const char *name, size_t len, unsigned char type) {
+  if (d->len + len + 3 > d->cap) {
+    d->cap = (d->len + len + 3) * 2;
+    d->data = realloc(d->data, d->cap);
+  }
+  char *rec = d->data + d->len;
+  rec[0] = (char) len;
+  rec[1] = (char) type;
+  memcpy(rec + 2, name, len + 1);
+  d->len += len + 3;
+}
+
+static struct dirlist *dir_list(struct dircache *cache, const char *path) {
+  for (struct dirlist *d = cache->buckets[dir_hash(path)]; d; d = d->next)
+    if (strcmp(d->path, path) == 0)
+      return d;
+
+  struct dirlist *d = dir_insert(cache, path);
+  int fd = open(path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (fd < 0)
+    return d;
+  long got;
+  while ((got = dents_read(cache, fd)) > 0) {
+    for (long off = 0; off < got;) {
+      struct linux_dirent64 *e = (struct linux_dirent64 *) (cache->dents + off);
+      off += e->d_reclen;
+      if (!is_dot_or_dotdot(e->d_name))
+        dirlist_add(d, e->d_name, strlen(e->d_name), e->d_type);
+    }
+  }
+  close(fd);
+  return d;
+}
+
+static void dircache_clear(struct dircache *cache) {
+  for (int i = 0; i < DIR_BUCKETS; i++) {
+    struct dirlist *d = cache->buckets[i];
+    while (d) {
+      struct dirlist *next = d->next;
+      free(d->path);
+      free(d->data);
+      free(d);
+      d = next;
+    }
+    cache->buckets[i] = NULL;
+  }
+}
+
+void glob_cache_clear(void) {
+  dircache_clear(&shell_cache);
+}
+
+/* The walk over a pattern's components, and the paths it has found so far, which live
+ * back to back in one arena until they are sorted and handed out. */
+struct component {
+  const char *text;
+  size_t len;
+  bool magic;
+  struct pattern pat;
+};
+
+struct walk {
+  struct component *comps;
+  size_t ncomps;
+  bool trailing_slash;
+  bool in_worker;  /* a ** met here is walked on this thread */
+  struct dircache *cache;
+  char *path;
+  size_t path_len, path_cap;
+  char *found;
+  size_t found_len, found_cap;
+  size_t *offsets;
+  size_t nfound, offsets_cap;
+};
+
+static void path_put(struct walk *w, const char *s, size_t n) {
+  if (w->path_len + n + 1 > w->path_cap) {
+    w->path_cap = (w->path_len + n + 1) * 2;
+    w->path = realloc(w->path, w->path_cap);
+  }
+  memcpy(w->path + w->path_len, s, n);
+  w->path_len += n;
+  w->path[w->path_len] = '\0';
+}
+
+static void path_truncate(struct walk *w, size_t len) {
+  w->path_len = len;
+  if (w->path)
+    w->path[len] = '\0';
+}
+
+/* Adds dir followed by name, and a '/' if slash. */
+static void found_push(struct walk *w, const char *dir, size_t dir_len, const char *name, size_t len, bool slash) {
+  size_t need = dir_len + len + slash + 1;
+  if (w->found_len + need > w->found_cap) {
+    w->found_cap = (w->found_len + need) * 2;
+    w->found = realloc(w->found, w->found_cap);
+  }
+  if (w->nfound == w->offsets_cap) {
+    w->offsets_cap = w->offsets_cap ? w->offsets_cap * 2 : 16;
+    w->offsets = realloc(w->offsets, w->offsets_cap * sizeof(size_t));
+  }
+  w->offsets[w->nfound++] = w->found_len;
+  char *p = w->found + w->found_len;
+  memcpy(p, dir, dir_len);
+  memcpy(p + dir_len, name, len);
+  if (slash)
+    p[dir_len + len] = '/';
+  p[need - 1] = '\0';
+  w->found_len += need;
+}
+
+static void found_add(struct walk *w) {
+  found_push(w, w->path, w->path_len, "", 0, false);
+}
+
+static bool is_dir(const char *path) {
+  struct stat st;
+  return stat(path, &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+static bool is_globstar(const struct component *c) {
+  return glob_globstar && c->len == 2 && c->text[0] == '*' && c->text[1] == '*';
+}
+
+static void walk_globstar(struct walk *w, size_t i);
+static void walk_parallel(struct walk *w, size_t i);
+
+static void walk(struct walk *w, size_t i) {
+  struct component *c = &w->comps[i];
+  bool last = i + 1 == w->ncomps;
+  size_t saved = w->path_len;
+
+  if (is_globstar(c)) {
+    if (w->in_worker)
+      walk_globstar(w, i);
+    else
+      walk_parallel(w, i);
+    return;
+  }
+
+  if (!c->magic) {
+    for (size_t k = 0; k < c->len; k++) {
+      if (c->text[k] == '\\' && k + 1 < c->len)
+        k++;
+      path_put(w, c->text + k, 1);
+    }
+    if (!last) {
+      path_put(w, "/", 1);
+      walk(w, i + 1);
+    } else if (w->trailing_slash ? is_dir(w->path) : faccessat(AT_FDCWD, w->path, F_OK, AT_SYMLINK_NOFOLLOW) == 0) {
+      if (w->trailing_slash)
+        path_put(w, "/", 1);
+      found_add(w);
+    }
+    path_truncate(w, saved);
+    return;
+  }
+
+  struct dirlist *d = dir_list(w->cache, w->path_len ? w->path : ".");
+  for (size_t off = 0; off < d->len;) {
+    const char *rec = d->data + off;
+    size_t len = (unsigned char) rec[0];
+    unsigned char type = rec[1];
+    const char *name = rec + 2;
+    off += len + 3;
+    if (!match(&c->pat, name, len))
+      continue;
+    bool need_dir = !last || w->trailing_slash;
+    if (need_dir && type != DT_DIR && type != DT_LNK && type != DT_UNKNOWN)
+      continue;
+    path_put(w, name, len);
+    if (need_dir && type != DT_DIR && !is_dir(w->path)) {
+      path_truncate(w, saved);
+      continue;
+    }
+    if (!last) {
+      path_put(w, "/", 1);
+      walk(w, i + 1);
+    } else {
+      if (w->trailing_slash)
+        path_put(w, "/", 1);
+      found_add(w);
+    }
+    path_truncate(w, saved);
+  }
+}
+
+/* ** on one thread: the rest of the pattern here and in every directory below, without
+ * following symlinks or, unless dotglob, going into hidden directories. A ** at the end
+ * matches everything below (only directories if followed by a '/'). */
+static void globstar_below(struct walk *w, size_t i) {
+  bool last = i + 1 == w->ncomps;
+  size_t saved = w->path_len;
+  if (!last)
+    walk(w, i + 1);
+
+  struct dirlist *d = dir_list(w->cache, w->path_len ? w->path : ".");
+  for (size_t off = 0; off < d->len;) {
+    const char *rec = d->data + off;
+    size_t len = (unsigned char) rec[0];
+    unsigned char type = rec[1];
+    const char *name = rec + 2;
+    off += len + 3;
+    if (name[0] == '.' && !glob_dotglob)
+      continue;
+    path_put(w, name, len);
+    struct stat st;
+    bool dir = type == DT_DIR ||
+      (type == DT_UNKNOWN && lstat(w->path, &st) == 0 && S_ISDIR(st.st_mode));
+    if (last && (dir || !w->trailing_slash || (type == DT_LNK && is_dir(w->path))))
+      found_push(w, w->path, w->path_len, "", 0, w->trailing_slash);
+    if (dir) {
+      path_put(w, "/", 1);
+      globstar_below(w, i);
+    }
+    path_truncate(w, saved);
+  }
+}
+
+static void walk_globstar(struct walk *w, size_t i) {
+  /* A trailing ** includes the directory it starts from. */
+  if (i + 1 == w->ncomps && w->path_len > 0)
+    found_add(w);
+  globstar_below(w, i);
+}
+
+static int compare_found(const void *a, const void *b, void *arena) {
+  return strcmp((char *) arena + *(const size_t *) a, (char *) arena + *(const size_t *) b);
+}
+
+/* ** over a whole tree on a pool of threads, one per CPU the shell may run on. Each
+ * directory is a task. A worker takes its own newest task (so it goes depth first and
+ * keeps few fds open) and, when it has none, steals the oldest task of another worker.
+ * Subdirectories are opened with openat() relative to their parent, whose fd stays open
+ * until every child has been. What follows the ** is matched by the worker against the
+ * entries it just read; each worker sorts its own results and they are merged at the end. */
+#define GLOB_MAX_WORKERS 32
+
+struct dirref {
+  int fd;
+  int refs;
+};
+
+struct task {
+  struct dirref *parent; /* NULL for the directory the walk starts in */
+  char *path;            /* "" or ending in '/', which the name to open comes right before */
+  size_t path_len, name_len;
+};
+
+struct deque {
+  pthread_mutex_t lock;
+  struct task *tasks;
+  size_t head, tail, cap;
+};
+
+struct pool;
+
+struct worker {
+  struct pool *pool;
+  int id;
+  pthread_t thread;
+  struct deque queue;
+  struct walk walk; /* results, and the walk of the rest when it is more than one component */
+  struct dircache cache;
+};
+
+struct pool {
+  struct worker *workers;
+  int nworkers;
+  long pending; /* tasks queued or running */
+  struct component *rest;
+  size_t nrest;
+  bool trailing_slash;
+  char *literal; /* the rest unquoted, when it is one component with no magic */
+  size_t literal_len;
+};
+
+static void deque_push(struct deque *q, struct task t) {
+  pthread_mutex_lock(&q->lock);
+  if (q->tail == q->cap) {
+    if (q->head > 0) {
+      memmove(q->tasks, q->tasks + q->head, (q->tail - q->head) * sizeof(struct task));
+      q->tail -= q->head;
+      q->head = 0;
+    } else {
+      q->cap = q->cap ? q->cap * 2 : 64;
+      q->tasks = realloc(q->tasks, q->cap * sizeof(struct task));
+    }
+  }
+  q->tasks[q->tail++] = t;
+  pthread_mutex_unlock(&q->lock);
+}
+
+/* The owner pops the newest task, a thief takes the oldest. */
+static bool deque_take(struct deque *q, struct task *t, bool steal) {
+  bool got = false;
+  pthread_mutex_lock(&q->lock);
+  if (q->tail > q->head) {
+    *t = steal ? q->tasks[q->head++] : q->tasks[--q->tail];
+    got = true;
+  }
+  if (q->head == q->tail)
+    q->head = q->tail = 0;
+  pthread_mutex_unlock(&q->lock);
+  return got;
+}
+
+static void dirref_release(struct dirref *ref) {
+  if (__atomic_sub_fetch(&ref->refs, 1, __ATOMIC_ACQ_REL) == 0) {
+    close(ref->fd);
+    free(ref);
+  }
+}
+
+/* The rest is at most one component: match it against one entry of t's directory. */
+static void worker_match(struct worker *me, const struct task *t, int fd, const char *name, size_t len, unsigned char type) {
+  struct pool *pool = me->pool;
+  struct stat st;
+  /* With a trailing '/' a symlink to a directory counts, as the last name only. */
+  if (pool->trailing_slash && type != DT_DIR &&
+      !(type == DT_LNK && fstatat(fd, name, &st, 0) == 0 && S_ISDIR(st.st_mode)))
+    return;
+  if (pool->nrest == 0) {
+    if (name[0] == '.' && !glob_dotglob)
+      return;
+  } else if (pool->literal) {
+    if (len != pool->literal_len || memcmp(name, pool->literal, len) != 0)
+      return;
+  } else if (!match(&pool->rest[0].pat, name, len)) {
+    return;
+  }
+  found_push(&me->walk, t->path, t->path_len, name, len, pool->trailing_slash);
+}
+
+static void worker_visit(struct worker *me, struct task *t) {
+  struct pool *pool = me->pool;
+  int fd;
+  if (t->parent) {
+    char name[256];
+    memcpy(name, t->path + t->path_len - 1 - t->name_len, t->name_len);
+    name[t->name_len] = '\0';
+    fd = openat(t->parent->fd, name, O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    dirref_release(t->parent);
+  } else {
+    fd = open(t->path_len ? t->path : ".", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  }
+  if (fd < 0) {
+    free(t->path);
+    return;
+  }
+  struct dirref *self = malloc(sizeof(*self));
+  self->fd = fd;
+  self->refs = 1;
+
+  /* A longer rest is walked the ordinary way, starting from this listing. */
+  struct dirlist *listing = NULL;
+  if (pool->nrest > 1)
+    listing = dir_insert(&me->cache, t->path_len ? t->path : ".");
+
+  long got;
+  while ((got = dents_read(&me->cache, fd)) > 0) {
+    for (long off = 0; off < got;) {
+      struct linux_dirent64 *e = (struct linux_dirent64 *) (me->cache.dents + off);
+      off += e->d_reclen;
+      const char *name = e->d_name;
+      if (is_dot_or_dotdot(name))
+        continue;
+      size_t len = strlen(name);
+      unsigned char type = e->d_type;
+      struct stat st;
+      if (type == DT_UNKNOWN && fstatat(fd, name, &st, AT_SYMLINK_NOFOLLOW) == 0)
+        type = S_ISDIR(st.st_mode) ? DT_DIR : DT_REG;
+      bool dir = type == DT_DIR;
+
+      if (listing)
+        dirlist_add(listing, name, len, type);
+      else
+        worker_match(me, t, fd, name, len, type);
+
+      if (dir && (name[0] != '.' || glob_dotglob)) {
+        struct task child = {self, malloc(t->path_len + len + 2), t->path_len + len + 1, len};
+        memcpy(child.path, t->path, t->path_len);
+        memcpy(child.path + t->path_len, name, len);
+        memcpy(child.path + t->path_len + len, "/", 2);
+        __atomic_add_fetch(&self->refs, 1, __ATOMIC_ACQ_REL);
+        __atomic_add_fetch(&pool->pending, 1, __ATOMIC_ACQ_REL);
+        deque_push(&me->queue, child);
+      }
+    }
+  }
+
+  if (listing) {
+    path_truncate(&me->walk, 0);
+    path_put(&me->walk, t->path, t->path_len);
+    walk(&me->walk, 0);
+    dircache_clear(&me->cache);
+  }
+  dirref_release(self);
+  free(t->path);
+}
+
+static void *worker_run(void *arg) {
+  struct worker *me = arg;
+  struct pool *pool = me->pool;
+  struct task t;
+  for (;;) {
+    bool got = deque_take(&me->queue, &t, false);
+    for (int k = 1; !got && k < pool->nworkers; k++)
+      got = deque_take(&pool->workers[(me->id + k) % pool->nworkers].queue, &t, true);
+    if (got) {
+      worker_visit(me, &t);
+      __atomic_sub_fetch(&pool->pending, 1, __ATOMIC_ACQ_REL);
+    } else if (__atomic_load_n(&pool->pending, __ATOMIC_ACQUIRE) == 0) {
+      break;
+    } else {
+      sched_yield();
+    }
+  }
+  qsort_r(me->walk.offsets, me->walk.nfound, sizeof(size_t), compare_found, me->walk.found);
+  return NULL;
+}
+
+static void walk_parallel(struct walk *w, size_t i) {
+  struct pool pool;
+  memset(&pool, 0, sizeof(pool));
+  pool.rest = w->comps + i + 1;
+  pool.nrest = w->ncomps - i - 1;
+  pool.trailing_slash = w->trailing_slash;
+  if (pool.nrest == 1 && !pool.rest[0].magic) {
+    const struct component *c = &pool.rest[0];
+    pool.literal = malloc(c->len + 1);
+    for (size_t k = 0; k < c->len; k++) {
+      if (c->text[k] == '\\' && k + 1 < c->len)
+        k++;
+      pool.literal[pool.literal_len++] = c->text[k];
+    }
+  }
+
+  cpu_set_t cpus;
+  int n = sched_getaffinity(0, sizeof(cpus), &cpus) == 0 ? CPU_COUNT(&cpus) : 1;
+  if (n < 1)
+    n = 1;
+  if (n > GLOB_MAX_WORKERS)
+    n = GLOB_MAX_WORKERS;
+  pool.nworkers = n;
+  pool.workers = calloc(n, sizeof(struct worker));
+  for (int k = 0; k < n; k++) {
+    struct worker *wk = &pool.workers[k];
+    wk->pool = &pool;
+    wk->id = k;
+    pthread_mutex_init(&wk->queue.lock, NULL);
+    wk->walk.comps = pool.rest;
+    wk->walk.ncomps = pool.nrest;
+    wk->walk.trailing_slash = pool.trailing_slash;
+    wk->walk.in_worker = true;
+    wk->walk.cache = &wk->cache;
+  }
+
+  if (pool.nrest == 0 && w->path_len > 0)
+    found_add(w);
+  struct task root = {NULL, strndup(w->path ? w->path : "", w->path_len), w->path_len, 0};
+  pool.pending = 1;
+  deque_push(&pool.workers[0].queue, root);
+  bool started[GLOB_MAX_WORKERS] = {false};
+  for (int k = 1; k < n; k++)
+    started[k] = pthread_create(&pool.workers[k].thread, NULL, worker_run, &pool.workers[k]) == 0;
+  worker_run(&pool.workers[0]);
+  for (int k = 1; k < n; k++)
+    if (started[k])
+      pthread_join(pool.workers[k].thread, NULL);
+
+  /* Merge the sorted lists. There are only as many as CPUs, so a linear pick will do. */
+  size_t next[GLOB_MAX_WORKERS] = {0};
+  for (;;) {
+    int best = -1;
+    const char *best_path = NULL;
+    for (int k = 0; k < n; k++) {
+      struct walk *r = &pool.workers[k].walk;
+      if (next[k] == r->nfound)
+        continue;
+      const char *p = r->found + r->offsets[next[k]];
+      if (best < 0 || strcmp(p, best_path) < 0) {
+        best = k;
+        best_path = p;
+      }
+    }
+    if (best < 0)
+      break;
+    found_push(w, best_path, strlen(best_path), "", 0, false);
+    next[best]++;
+  }
+
+  for (int k = 0; k < n; k++) {
+    struct worker *wk = &pool.workers[k];
+    free(wk->walk.path);
+    free(wk->walk.found);
+    free(wk->walk.offsets);
+    dircache_clear(&wk->cache);
+    free(wk->cache.dents);
+    free(wk->queue.tasks);
+    pthread_mutex_destroy(&wk->queue.lock);
+  }
+  free(pool.workers);
+  free(pool.literal);
+}
+
+static bool found_sorted(struct walk *w) {
+  for (size_t k = 1; k < w->nfound; k++)
+    if (compare_found(&w->offsets[k - 1], &w->offsets[k], w->found) > 0)
+      return false;
+  return true;
+}
+
+size_t glob_expand(const char *pattern, void (*add)(const char *path, void *ctx), void *ctx) {
+  struct walk w;
+  memset(&w, 0, sizeof(w));
+  size_t n = strlen(pattern);
+  w.comps = malloc((n / 2 + 2) * sizeof(struct component));
+
+  size_t start = 0;
+  if (pattern[0] == '/') {
+    path_put(&w, "/", 1);
+    while (pattern[start] == '/')
+      start++;
+  }
+  for (size_t i = start; i <= n; i++) {
+    if (i < n && pattern[i] == '\\') {
+      i++;
+      continue;
+    }
+    if (i < n && pattern[i] != '/')
+      continue;
+    if (i > start) {
+      struct component *c = &w.comps[w.ncomps++];
+      c->text = pattern + start;
+      c->len = i - start;
+      c->magic = has_magic(c->text, c->len);
+      if (w.ncomps > 1 && is_globstar(c) && is_globstar(c - 1))
+        w.ncomps--; /* consecutive ** are one */
+      else if (c->magic)
+        compile(c->text, c->len, &c->pat);
+    } else if (i == n && i > 0) {
+      w.trailing_slash = true;
+    }
+    start = i + 1;
+  }
+
+  w.cache = &shell_cache;
+  if (w.ncomps > 0)
+    walk(&w, 0);
+  /* A lone ** hands back a merged list that is sorted already. */
+  if (!found_sorted(&w))
+    qsort_r(w.offsets, w.nfound, sizeof(size_t), compare_found, w.found);
+  for (size_t k = 0; k < w.nfound; k++)
+    add(w.found + w.offsets[k], ctx);
+
+  for (size_t k = 0; k < w.ncomps; k++)
+    if (w.comps[k].magic)
+      pattern_free(&w.comps[k].pat);
+  free(w.comps);
+  free(w.path);
+  free(w.found);
+  free(w.offsets);
+  return w.nfound;
+}
+
+static const struct {
+  const char *name;
+  bool *value;
+} shopt_options[] = {
+  {"dotglob", &glob_dotglob},
+  {"failglob", &glob_failglob},
+  {"globstar", &glob_globstar},
+  {"nullglob", &glob_nullglob},
+};
+
+#define NOPTIONS (sizeof(shopt_options) / sizeof(shopt_options[0]))
+
+/* shopt [-s|-u] [name...]: set, unset or show shell options. Showing one name returns
+ * whether it is on. */
+int cmd_shopt(struct tokens *tokens) {
+  size_t len = tokens_get_length(tokens), i = 1;
+  int set = -1;
+  for (; i < len; i++) {
+    char *arg = tokens_get_token(tokens, i);
+    if (strcmp(arg, "-s") == 0) {
+      set = 1;
+    } else if (strcmp(arg, "-u") == 0) {
+      set = 0;
+    } else {
+      break;
+    }
+  }
+
+  int status = 0;
+  if (i == len) {
+    for (size_t k = 0; k < NOPTIONS; k++)
+      if (set < 0 || *shopt_options[k].value == set)
+        printf("%-15s %s\n", shopt_options[k].name, *shopt_options[k].value ? "on" : "off");
+    return 0;
+  }
+  for (; i < len; i++) {
+    char *name = tokens_get_token(tokens, i);
+    size_t k = 0;
+    while (k < NOPTIONS && strcmp(shopt_options[k].name, name) != 0)
+      k++;
+    if (k == NOPTIONS) {
+      fprintf(stderr, "shopt: %s: invalid shell option name\n", name);
+      status = 1;
+    } else if (set >= 0) {
+      *shopt_options[k].value = set;
+    } else {
+      printf("%-15s %s\n", name, *shopt_options[k].value ? "on" : "off");
+      if (!*shopt_options[k].value)
+        status = 1;
+    }
+  }
+  return status;
+}
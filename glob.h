@@ -0,0 +1,31 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "tokenizer.h"
+
+/* shopt options */
+extern bool glob_nullglob; /* a pattern with no match expands to nothing */
+extern bool glob_failglob; /* a pattern with no match is an error */
+extern bool glob_dotglob;  /* * and ? match a leading '.' */
+extern bool glob_globstar; /* ** matches any number of directories, walked in parallel */
+
+/* Whether pattern has an unescaped *, ? or [...] in it. */
+bool glob_has_magic(const char *pattern);
+
+/* Calls add with every path matching pattern ('\' quotes the next byte), sorted.
+ * Returns how many there were. */
+size_t glob_expand(const char *pattern, void (*add)(const char *path, void *ctx), void *ctx);
+
+/* Forget the directory listings read so far. glob_expand() reads each directory once
+ * and keeps it until this is called, which expand_words() does once per command. */
+void glob_cache_clear(void);
+
+/* A pattern compiled once to match strings against, as case does ('\' quotes the next
+ * byte; a leading '.' needs no explicit match). */
+struct glob_pattern;
+struct glob_pattern *glob_pattern_new(const char *pattern);
+bool glob_pattern_match(const struct glob_pattern *pattern, const char *s);
+void glob_pattern_free(struct glob_pattern *pattern);
+
+int cmd_shopt(struct tokens *tokens);
@@ -0,0 +1,259 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "arith.h"
+#include "heredoc.h"
+#include "test.h"
+
+enum op { OP_NONE, OP_HEREDOC, OP_HERESTRING };
+
+/* One <<, <<- or <<< and its operand. */
+struct redir {
+  enum op op;
+  const char *word, *raw; /* the operand, and as it was written */
+  bool strip;
+  size_t fd_len;  /* digits of the fd in 3<<WORD */
+  size_t words; /* 1 when the operand is glued to the operator, 2 when it's the next word */
+};
+
+/* Whether word i of t is one of the operators, maybe after an fd number; an unquoted
+ * "<<" glued to a word counts, since '<' doesn't end a word. */
+static bool parse_op(struct tokens *t, size_t i, struct redir *r) {
+  const char *raw = tokens_get_raw(t, i), *word = tokens_get_token(t, i);
+  size_t fd_len = strspn(raw, "0123456789");
+  if (fd_len > 4 || strncmp(raw + fd_len, "<<", 2) != 0)
+    return false;
+  size_t skip = fd_len + 2;
+  r->fd_len = fd_len;
+  r->op = OP_HEREDOC;
+  r->strip = false;
+  if (raw[skip] == '<') {
+    r->op = OP_HERESTRING;
+    skip++;
+  } else if (raw[skip] == '-') {
+    r->strip = true;
+    skip++;
+  }
+  if (raw[skip] != '\0') {
+    r->word = word + skip;
+    r->raw = raw + skip;
+    r->words = 1;
+    return true;
+  }
+  if (i + 1 >= tokens_get_length(t))
+    return false;
+  r->word = tokens_get_token(t, i + 1);
+  r->raw = tokens_get_raw(t, i + 1);
+  r->words = 2;
+  return true;
+}
+
+/* Lines of text from *pos up to the one that is delim, or to the end. */
+static char *read_body(const char *text, size_t *pos, const char *delim, bool strip) {
+  size_t len = strlen(text), at = *pos < len ? *pos : len, n = 0;
+  size_t delim_len = strlen(delim);
+  char *body = malloc(len - at + 2);
+  while (at < len) {
+    const char *nl = memchr(text + at, '\n', len - at);
+    size_t end = nl ? (size_t) (nl - text) : len, from = at;
+    at = nl ? end + 1 : len;
+    if (strip)
+      while (from < end && text[from] == '\t')
+        from++;
+    if (end - from == delim_len && memcmp(text + from, delim, delim_len) == 0)
+      break;
+    memcpy(body + n, text + from, end - from);
+    n += end - from;
+    body[n++] = '\n';
+  }
+  body[n] = '\0';
+  *pos = at;
+  return body;
+}
+
+/* The body as a double-quoted word. Expanded, $ and ` work in it and a backslash only
+ * quotes $ ` \ and newline; literal, everything is quoted. */
+static char *quote_body(const char *body, bool expand) {
+  size_t n = strlen(body);
+  char *q = malloc(2 * n + 3), *o = q;
+  *o++ = '"';
+  for (size_t i = 0; i < n; i++) {
+    char c = body[i];
+    if (expand && (c == '`' || (c == '$' && (body[i + 1] == '(' || body[i + 1] == '{')))) {
+      /* Substitutions are copied as they are; their insides have quoting of their own. */
+      size_t end;
+      if (c == '`') {
+        end = tokens_subst_end(body, i, n);
+      } else if (body[i + 1] == '(') {
+        end = tokens_subst_end(body, i + 1, n);
+      } else {
+        int depth = 1;
+        for (end = i + 2; end < n; end++) {
+          if (body[end] == '{')
+            depth++;
+          else if (body[end] == '}' && --depth == 0)
+            break;
+        }
+        if (end == n)
+          end = n - 1;
+      }
+      memcpy(o, body + i, end - i + 1);
+      o += end - i + 1;
+      i = end;
+    } else if (expand && c == '$') {
+      *o++ = c;
+    } else if (expand && c == '\\' && body[i + 1] == '\n') {
+      i++;
+    } else if (expand && c == '\\' && body[i + 1] != '\0' && strchr("$`\\", body[i + 1])) {
+      *o++ = c;
+      *o++ = body[++i];
+    } else {
+      if (strchr("\\\"$`", c) != NULL)
+        *o++ = '\\';
+      *o++ = c;
+    }
+  }
+  *o++ = '"';
+  *o = '\0';
+  return q;
+}
+
+struct tokens *heredoc_attach(struct tokens *tokens, const char *text, size_t *pos) {
+  size_t len = tokens_get_length(tokens), i = arith_command_words(tokens, 0) + test_command_words(tokens, 0);
+  struct redir r;
+  while (i < len && !parse_op(tokens, i, &r))
+    i++;
+  if (i == len)
+    return tokens;
+
+  struct tokens *out = tokens_slice(tokens, 0, i);
+  for (; i < len; i++) {
+    if (!parse_op(tokens, i, &r)) {
+      tokens_append(out, tokens_get_token(tokens, i), tokens_get_raw(tokens, i));
+      continue;
+    }
+    char op[8];
+    snprintf(op, sizeof(op), "%.*s%s", (int) r.fd_len, tokens_get_raw(tokens, i),
+        r.op == OP_HERESTRING ? "<<<" : "<<");
+    if (r.op == OP_HERESTRING) {
+      tokens_append(out, op, NULL);
+      tokens_append(out, r.word, r.raw);
+    } else {
+      /* A quoted delimiter (any quote at all) turns expansion off. */
+      char *body = read_body(text, pos, r.word, r.strip);
+      char *quoted = quote_body(body, r.raw == r.word);
+      tokens_append(out, op, NULL);
+      tokens_append(out, body, quoted);
+      free(quoted);
+      free(body);
+    }
+    i += r.words - 1;
+  }
+  return out;
+}
+
+bool heredoc_reader_start(struct heredoc_reader *r, const char *line) {
+  memset(r, 0, sizeof(*r));
+  r->line_start = true;
+  if (strstr(line, "<<") == NULL)
+    return false;
+
+  /* Every command up to the end of the line can open some; the bodies come after it. */
+  size_t len = strlen(line), cap = 0;
+  for (size_t start = 0; start < len; ) {
+    size_t end = tokens_command_end(line, start);
+    char *cmd = strndup(line + start, end - start);
+    struct tokens *t = tokenize(cmd);
+    struct redir op;
+    for (size_t i = arith_command_words(t, 0) + test_command_words(t, 0); i < tokens_get_length(t); i++) {
+      if (!parse_op(t, i, &op))
+        continue;
+      if (op.op == OP_HEREDOC) {
+        if (r->n == cap) {
+          cap = cap ? cap * 2 : 4;
+          r->delims = realloc(r->delims, cap * sizeof(char *));
+          r->strip = realloc(r->strip, cap * sizeof(bool));
+        }
+        r->delims[r->n] = strdup(op.word);
+        r->strip[r->n++] = op.strip;
+      }
+      i += op.words - 1;
+    }
+    tokens_destroy(t);
+    free(cmd);
+    if (line[end] != ';')
+      break;
+    start = end + 1;
+  }
+  return r->n > 0;
+}
+
+bool heredoc_reader_line(struct heredoc_reader *r, const char *line) {
+  size_t n = strlen(line);
+  bool whole = n > 0 && line[n - 1] == '\n';
+  if (r->line_start && whole && r->next < r->n) {
+    const char *s = line;
+    size_t len = n - 1;
+    if (r->strip[r->next])
+      for (; len > 0 && *s == '\t'; s++)
+        len--;
+    if (len == strlen(r->delims[r->next]) && memcmp(s, r->delims[r->next], len) == 0)
+      r->next++;
+  }
+  r->line_start = whole;
+  return r->next < r->n;
+}
+
+void heredoc_reader_free(struct heredoc_reader *r) {
+  for (size_t i = 0; i < r->n; i++)
+    free(r->delims[i]);
+  free(r->delims);
+  free(r->strip);
+}
+
+static int write_all(int fd, const char *s, size_t n) {
+  while (n > 0) {
+    ssize_t put = write(fd, s, n);
+    if (put < 0 && errno == EINTR)
+      continue;
+    if (put < 0)
+      return -1;
+    s += put;
+    n -= put;
+  }
+  return 0;
+}
+
+int heredoc_open(const char *body, bool newline) {
+  size_t n = strlen(body);
+  int pfd[2];
+  if (pipe2(pfd, O_CLOEXEC) == 0) {
+    int cap = fcntl(pfd[1], F_GETPIPE_SZ);
+    if (cap > 0 && n + newline <= (size_t) cap) {
+      write_all(pfd[1], body, n);
+      if (newline)
+        write_all(pfd[1], "\n", 1);
+      close(pfd[1]);
+      return pfd[0];
+    }
+    close(pfd[0]);
+    close(pfd[1]);
+  }
+
+  /* Too big for the pipe: writing it there would block until the reader caught up. */
+  int fd = memfd_create("heredoc", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+  if (fd == -1 || write_all(fd, body, n) == -1 || (newline && write_all(fd, "\n", 1) == -1)) {
+    fprintf(stderr, "heredoc: %s\n", strerror(errno));
+    if (fd != -1)
+      close(fd);
+    return -1;
+  }
+  fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL);
+  lseek(fd, 0, SEEK_SET);
+  return fd;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "tokenizer.h"
+
+/* Replaces each <<WORD and <<-WORD (or << WORD) in tokens with a << followed by the
+ * here-document's body, read from text at *pos, which is moved past it; a glued
+ * <<<word becomes <<< and word. The body is quoted so that expand_words() does to it
+ * what sh does to a here-document: nothing if WORD was quoted, $ and ` otherwise.
+ * Returns tokens itself when there is nothing to replace, a new list otherwise. */
+struct tokens *heredoc_attach(struct tokens *tokens, const char *text, size_t *pos);
+
+/* Follows the input lines after one that opens here-documents, to know when their
+ * bodies have all been read. */
+struct heredoc_reader {
+  char **delims;
+  bool *strip; /* <<-: leading tabs don't count */
+  size_t n, next;
+  bool line_start; /* the last line fed was a whole one */
+};
+
+/* Starts following the bodies of the here-documents line opens; false if it opens none. */
+bool heredoc_reader_start(struct heredoc_reader *r, const char *line);
+
+/* Feeds the next piece of input (fgets() may cut long lines); false once the last body
+ * has ended. */
+bool heredoc_reader_line(struct heredoc_reader *r, const char *line);
+
+void heredoc_reader_free(struct heredoc_reader *r);
+
+/* An fd to read body from (and a newline after it if newline is set): a pipe when it
+ * fits in one, so nothing blocks, or a sealed memfd otherwise. -1 after a message. */
+int heredoc_open(const char *body, bool newline);
@@ -0,0 +1,279 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "history.h"
+#include "vars.h"
+
+/* The file is one record per line:
+ *
+ *   start-time \t status \t duration-us \t cwd \t command \n
+ *
+ * with backslash, tab and newline escaped in cwd and command. It is read through a
+ * read-only mapping and an index of record start offsets. Both are extended only by the
+ * bytes other writers appended since the last look, so a lookup never rescans the file. */
+static struct {
+  int fd;
+  char *map;
+  size_t mapped;   /* bytes mapped */
+  size_t indexed;  /* bytes covered by offsets[] (always at a record boundary) */
+  size_t *offsets;
+  size_t count, cap;
+} hist = { .fd = -1 };
+
+/* Searches scan the mapping backwards in windows of this size. */
+#define HISTORY_WINDOW (1 << 20)
+
+void history_init(void) {
+  char path[4096];
+  const char *file = vars_get("HISTFILE");
+  if (file == NULL) {
+    const char *home = vars_get("HOME");
+    snprintf(path, sizeof(path), "%s/.shell_history", home ? home : ".");
+    file = path;
+  }
+  hist.fd = open(file, O_RDWR | O_APPEND | O_CREAT | O_CLOEXEC, 0600);
+  /* Out of the way of fds users pick for exec 3>file. */
+  if (hist.fd >= 0 && hist.fd < 10) {
+    int high = fcntl(hist.fd, F_DUPFD_CLOEXEC, 10);
+    if (high >= 0) {
+      close(hist.fd);
+      hist.fd = high;
+    }
+  }
+}
+
+/* Escapes src into dst (at least 2 * strlen + 1 bytes). */
+static char *history_escape(char *dst, const char *src) {
+  for (; *src; src++) {
+    if (*src == '\\' || *src == '\t' || *src == '\n') {
+      *dst++ = '\\';
+      *dst++ = *src == '\t' ? 't' : *src == '\n' ? 'n' : '\\';
+    } else {
+      *dst++ = *src;
+    }
+  }
+  *dst = '\0';
+  return dst;
+}
+
+void history_add(const char *line, time_t started, const char *cwd, int status,
+    long long duration_us) {
+  if (hist.fd == -1)
+    return;
+  size_t len = strlen(line) * 2 + strlen(cwd) * 2 + 96;
+  char *record = malloc(len);
+  char *p = record + sprintf(record, "%lld\t%d\t%lld\t", (long long) started, status, duration_us);
+  p = history_escape(p, cwd);
+  *p++ = '\t';
+  p = history_escape(p, line);
+  *p++ = '\n';
+  if (write(hist.fd, record, p - record) == -1)
+    fprintf(stderr, "history: %s\n", strerror(errno));
+  free(record);
+}
+
+/* Brings the mapping and index up to date with the file's current size. */
+static void history_refresh(void) {
+  struct stat st;
+  if (hist.fd == -1 || fstat(hist.fd, &st) == -1 || (size_t) st.st_size == hist.mapped)
+    return;
+
+  size_t size = st.st_size;
+  if (hist.map)
+    munmap(hist.map, hist.mapped);
+  hist.map = mmap(NULL, size, PROT_READ, MAP_SHARED, hist.fd, 0);
+  if (hist.map == MAP_FAILED) {
+    hist.map = NULL;
+    hist.mapped = hist.indexed = hist.count = 0;
+    return;
+  }
+  /* A file that shrank was truncated or rewritten under us: what was indexed is gone. */
+  if (size < hist.mapped)
+    hist.indexed = hist.count = 0;
+  hist.mapped = size;
+
+  /* Index only the complete records that appeared since last time. */
+  const char *p = hist.map + hist.indexed, *end = hist.map + size;
+  const char *nl;
+  while ((nl = memchr(p, '\n', end - p)) != NULL) {
+    if (hist.count == hist.cap) {
+      hist.cap = hist.cap ? hist.cap * 2 : 1024;
+      hist.offsets = realloc(hist.offsets, hist.cap * sizeof(size_t));
+    }
+    hist.offsets[hist.count++] = p - hist.map;
+    p = nl + 1;
+  }
+  hist.indexed = p - hist.map;
+}
+
+size_t history_count(void) {
+  history_refresh();
+  return hist.count;
+}
+
+/* Finds the record containing byte offset off. */
+static size_t history_record_at(size_t off) {
+  size_t lo = 0, hi = hist.count;
+  while (hi - lo > 1) {
+    size_t mid = (lo + hi) / 2;
+    if (hist.offsets[mid] <= off)
+      lo = mid;
+    else
+      hi = mid;
+  }
+  return lo;
+}
+
+static const char *history_record_end(size_t n) {
+  return n + 1 < hist.count ? hist.map + hist.offsets[n + 1] - 1 : hist.map + hist.indexed - 1;
+}
+
+/* Returns where field (0-4) of record n starts; *end gets set to where it ends. */
+static const char *history_field(size_t n, int field, const char **end) {
+  const char *p = hist.map + hist.offsets[n], *rec_end = history_record_end(n);
+  for (int i = 0; i < field && p < rec_end; i++) {
+    const char *tab = memchr(p, '\t', rec_end - p);
+    p = tab ? tab + 1 : rec_end;
+  }
+  const char *tab = field < 4 ? memchr(p, '\t', rec_end - p) : NULL;
+  *end = tab ? tab : rec_end;
+  return p;
+}
+
+static int history_unescape(const char *src, const char *end, char *buf, size_t size) {
+  size_t n = 0;
+  for (; src < end && n + 1 < size; src++) {
+    if (*src == '\\' && src + 1 < end) {
+      src++;
+      buf[n++] = *src == 't' ? '\t' : *src == 'n' ? '\n' : *src;
+    } else {
+      buf[n++] = *src;
+    }
+  }
+  buf[n] = '\0';
+  return n;
+}
+
+int history_command(size_t n, char *buf, size_t size) {
+  history_refresh();
+  if (n >= hist.count)
+    return -1;
+  const char *end, *cmd = history_field(n, 4, &end);
+  return history_unescape(cmd, end, buf, size);
+}
+
+static void history_print(size_t n, bool verbose) {
+  char cmd[4096];
+  const char *end, *field;
+  if (verbose) {
+    char when[32], cwd[4096];
+    time_t started = strtoll(hist.map + hist.offsets[n], NULL, 10);
+    strftime(when, sizeof(when), "%Y-%m-%d %H:%M:%S", localtime(&started));
+    field = history_field(n, 1, &end);
+    int status = atoi(field);
+    field = history_field(n, 2, &end);
+    long long us = strtoll(field, NULL, 10);
+    field = history_field(n, 3, &end);
+    history_unescape(field, end, cwd, sizeof(cwd));
+    field = history_field(n, 4, &end);
+    history_unescape(field, end, cmd, sizeof(cmd));
+    printf("%6zu  %s  %3d %9.3fs  %s  %s\n", n + 1, when, status, us / 1e6, cwd, cmd);
+  } else {
+    field = history_field(n, 4, &end);
+    history_unescape(field, end, cmd, sizeof(cmd));
+    printf("%6zu  %s\n", n + 1, cmd);
+  }
+}
+
+/* Prints up to limit records whose command contains text, newest first. Matches are found
+ * with memmem() over mapping windows walked from the end, then mapped to their record
+ * through the offset index, so the cost is one pass over the bytes actually searched. */
+static int history_search(const char *text, size_t limit, bool verbose) {
+  char pattern[strlen(text) * 2 + 1];
+  size_t plen = history_escape(pattern, text) - pattern;
+  if (plen == 0 || hist.count == 0)
+    return 1;
+
+  size_t found = 0;
+  size_t last_record = hist.count; /* newest record already printed */
+  size_t hi = hist.indexed;
+  while (hi > 0 && found < limit) {
+    size_t lo = hi > HISTORY_WINDOW ? hi - HISTORY_WINDOW : 0;
+    /* Let matches straddle the window's lower edge; the next window excludes them. */
+    size_t win_end = hi + plen - 1 < hist.indexed ? hi + plen - 1 : hist.indexed;
+    size_t hits[256];
+    size_t nhits = 0;
+    bool overflow = false;
+    const char *p = hist.map + lo, *end = hist.map + win_end;
+    const char *m;
+    /* Collect matches in this window, then report them newest first. */
+    while ((m = memmem(p, end - p, pattern, plen)) != NULL) {
+      if (nhits == sizeof(hits) / sizeof(hits[0])) {
+        /* Too many to hold: keep only the newest ones by sliding forward. */
+        memmove(hits, hits + 1, (nhits - 1) * sizeof(size_t));
+        nhits--;
+        overflow = true;
+      }
+      hits[nhits++] = m - hist.map;
+      p = m + 1;
+    }
+    for (size_t i = nhits; i > 0 && found < limit; i--) {
+      size_t rec = history_record_at(hits[i - 1]);
+      if (rec >= last_record)
+        continue;
+      const char *cmd_end, *cmd = history_field(rec, 4, &cmd_end);
+      if (hist.map + hits[i - 1] < cmd || hist.map + hits[i - 1] + plen > cmd_end)
+        continue;
+      history_print(rec, verbose);
+      last_record = rec;
+      found++;
+    }
+    /* Dropped hits lie below the oldest one kept; resume the search from there. */
+    hi = overflow ? hits[0] : lo;
+  }
+  return found > 0 ? 0 : 1;
+}
+
+int cmd_history(struct tokens *tokens) {
+  size_t len = tokens_get_length(tokens);
+  bool verbose = false;
+  char *search = NULL;
+  size_t limit = 0;
+  /* Only an interactive shell opens the file up front; a script does here. */
+  if (hist.fd == -1)
+    history_init();
+
+  for (size_t i = 1; i < len; i++) {
+    char *arg = tokens_get_token(tokens, i);
+    if (strcmp(arg, "-v") == 0) {
+      verbose = true;
+    } else if (strcmp(arg, "-s") == 0 && i + 1 < len) {
+      search = tokens_get_token(tokens, ++i);
+    } else if (arg[0] >= '0' && arg[0] <= '9') {
+      limit = strtoul(arg, NULL, 10);
+    } else {
+      fprintf(stderr, "usage: history [-v] [-s TEXT] [N]\n");
+      return 1;
+    }
+  }
+
+  if (hist.fd == -1) {
+    fprintf(stderr, "history: no history file\n");
+    return 1;
+  }
+  history_refresh();
+  if (search)
+    return history_search(search, limit ? limit : 20, verbose);
+
+  size_t start = limit && limit < hist.count ? hist.count - limit : 0;
+  for (size_t n = start; n < hist.count; n++)
+    history_print(n, verbose);
+  return 0;
+}
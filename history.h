@@ -0,0 +1,24 @@
+#pragma once
+
+#include <stddef.h>
+#include <time.h>
+#include "tokenizer.h"
+
+/* Opens the shared history file ($HISTFILE, default ~/.shell_history). The interactive
+ * loop does this; otherwise the history builtin does on first use. */
+void history_init(void);
+
+/* Appends one command with the time it started, the directory it ran in, its exit status
+ * and how long it took. Each record goes out in a single O_APPEND write, so concurrent
+ * shells never interleave inside a record. */
+void history_add(const char *line, time_t started, const char *cwd, int status,
+    long long duration_us);
+
+/* Number of records in the file, including ones appended by other shells. */
+size_t history_count(void);
+
+/* Copies the command of record n (0 is the oldest) into buf; returns its length or -1. */
+int history_command(size_t n, char *buf, size_t size);
+
+/* history [-v] [N] -- last N records; history -s TEXT [N] -- newest N containing TEXT */
+int cmd_history(struct tokens *tokens);
@@ -0,0 +1,296 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "input.h"
+#include "output.h"
+#include "vars.h"
+
+/* How much read asks for at a time: a line's worth on files, where the rest is handed
+ * back, and all a pipe has on pipes. */
+#define LINE_BLOCK 4096
+#define BULK_BLOCK 65536
+
+/* Bytes read from an fd and not used yet. */
+struct inbuf {
+  char *data;
+  size_t start, end, cap;
+  dev_t dev;      /* what the fd was when they were read */
+  ino_t ino;
+  bool seekable;
+};
+
+static struct inbuf *bufs;
+static int nbufs;
+
+/* The buffer for fd, emptied if fd doesn't refer to what filled it any more; NULL if
+ * fd isn't open. */
+static struct inbuf *inbuf_get(int fd) {
+  struct stat st;
+  if (fd < 0 || fstat(fd, &st) == -1)
+    return NULL;
+  if (fd >= nbufs) {
+    bufs = realloc(bufs, (fd + 1) * sizeof(struct inbuf));
+    memset(bufs + nbufs, 0, (fd + 1 - nbufs) * sizeof(struct inbuf));
+    nbufs = fd + 1;
+  }
+  struct inbuf *b = &bufs[fd];
+  b->seekable = S_ISREG(st.st_mode) && lseek(fd, 0, SEEK_CUR) != -1;
+  if (b->dev != st.st_dev || b->ino != st.st_ino || b->seekable) {
+    b->start = b->end = 0;
+    b->dev = st.st_dev;
+    b->ino = st.st_ino;
+  }
+  return b;
+}
+
+/* Reads up to want more bytes after the ones kept; 0 at the end, -1 on an error. */
+static ssize_t inbuf_fill(struct inbuf *b, int fd, size_t want) {
+  if (b->start > 0) {
+    memmove(b->data, b->data + b->start, b->end - b->start);
+    b->end -= b->start;
+    b->start = 0;
+  }
+  if (b->end + want + 1 > b->cap) {
+    b->cap = b->end + want + 1; /* a spare byte, for mapfile to end a line in place */
+    b->data = realloc(b->data, b->cap);
+  }
+  ssize_t got;
+  while ((got = read(fd, b->data + b->end, want)) == -1 && errno == EINTR)
+    ;
+  if (got > 0)
+    b->end += got;
+  return got;
+}
+
+/* A file is moved back to just after what was used; nothing is kept for it. */
+static void inbuf_release(struct inbuf *b, int fd) {
+  if (!b->seekable)
+    return;
+  if (b->end > b->start)
+    lseek(fd, -(off_t) (b->end - b->start), SEEK_CUR);
+  b->start = b->end = 0;
+}
+
+/* Finds the next delim at or after b->start + *scanned, reading more as needed; its
+ * offset from b->start, or -1 at the end of input. A newline after an odd number of
+ * backslashes doesn't count when continued is set. */
+static ssize_t find_delim(struct inbuf *b, int fd, char delim, bool continued, size_t block,
+    size_t *scanned) {
+  for (;;) {
+    char *from = b->data + b->start + *scanned;
+    char *hit = b->end > b->start + *scanned ? memchr(from, delim, b->end - b->start - *scanned) : NULL;
+    if (hit != NULL) {
+      size_t at = hit - (b->data + b->start);
+      size_t slashes = 0;
+      while (continued && slashes < at && hit[-1 - (ssize_t) slashes] == '\\')
+        slashes++;
+      *scanned = at + 1;
+      if (slashes % 2 == 0)
+        return at;
+      continue;
+    }
+    *scanned = b->end - b->start;
+    if (inbuf_fill(b, fd, block) <= 0)
+      return -1;
+  }
+}
+
+static bool parse_fd(const char *s, int *fd) {
+  char *end;
+  long n = strtol(s, &end, 10);
+  if (*s == '\0' || *end != '\0' || n < 0 || n > 1 << 20)
+    return false;
+  *fd = n;
+  return true;
+}
+
+/* Splits line on IFS into the names, the last one taking what is left, as sh does.
+ * Bytes with literal set were quoted by a backslash and never split on. */
+static int assign_fields(char *line, bool *literal, size_t n, char **names, size_t nnames) {
+  const char *ifs = vars_get("IFS");
+  if (ifs == NULL)
+    ifs = " \t\n";
+  bool is_ifs[256] = {false}, is_space[256] = {false};
+  for (const unsigned char *c = (const unsigned char *) ifs; *c; c++) {
+    is_ifs[*c] = true;
+    is_space[*c] = *c == ' ' || *c == '\t' || *c == '\n';
+  }
+#define IFS(i) (!literal[i] && is_ifs[(unsigned char) line[i]])
+#define SPACE(i) (!literal[i] && is_space[(unsigned char) line[i]])
+
+  int status = 0;
+  size_t pos = 0;
+  while (pos < n && SPACE(pos))
+    pos++;
+  for (size_t k = 0; k < nnames; k++) {
+    size_t start = pos, end;
+    if (k + 1 < nnames) {
+      while (pos < n && !IFS(pos))
+        pos++;
+      end = pos;
+      while (pos < n && SPACE(pos))
+        pos++;
+      if (pos < n && IFS(pos))
+        pos++;
+      while (pos < n && SPACE(pos))
+        pos++;
+    } else {
+      end = n;
+      while (end > start && SPACE(end - 1))
+        end--;
+    }
+    char saved = line[end];
+    line[end] = '\0';
+    if (vars_set(names[k], line + start, 0) == -1) {
+      fprintf(stderr, "read: %s: readonly variable\n", names[k]);
+      status = 1;
+    }
+    line[end] = saved;
+  }
+#undef IFS
+#undef SPACE
+  return status;
+}
+
+int cmd_read(struct tokens *tokens) {
+  size_t len = tokens_get_length(tokens), i = 1;
+  bool raw = false;
+  char delim = '\n';
+  int fd = 0;
+  for (; i < len && tokens_get_token(tokens, i)[0] == '-'; i++) {
+    char *opt = tokens_get_token(tokens, i);
+    if (strcmp(opt, "--") == 0) {
+      i++;
+      break;
+    } else if (strcmp(opt, "-r") == 0) {
+      raw = true;
+    } else if (strcmp(opt, "-d") == 0 && i + 1 < len) {
+      delim = tokens_get_token(tokens, ++i)[0];
+    } else if (strcmp(opt, "-u") == 0 && i + 1 < len && parse_fd(tokens_get_token(tokens, i + 1), &fd)) {
+      i++;
+    } else {
+      fprintf(stderr, "usage: read [-r] [-d delim] [-u fd] [name...]\n");
+      return 2;
+    }
+  }
+  for (size_t k = i; k < len; k++) {
+    size_t name_len;
+    char assign[strlen(tokens_get_token(tokens, k)) + 2];
+    sprintf(assign, "%s=", tokens_get_token(tokens, k));
+    if (!vars_is_assignment(assign, &name_len) || name_len + 1 != strlen(assign)) {
+      fprintf(stderr, "read: %s: not a valid identifier\n", tokens_get_token(tokens, k));
+      return 2;
+    }
+  }
+
+  out_flush(); /* a prompt printed before read shows before it waits */
+  struct inbuf *b = inbuf_get(fd);
+  if (b == NULL) {
+    fprintf(stderr, "read: %d: %s\n", fd, strerror(errno));
+    return 1;
+  }
+  size_t scanned = 0;
+  ssize_t at = find_delim(b, fd, delim, !raw && delim == '\n',
+      b->seekable ? LINE_BLOCK : BULK_BLOCK, &scanned);
+  size_t n = at >= 0 ? (size_t) at : b->end - b->start;
+  const char *in = b->data + b->start;
+
+  /* Without -r a backslash quotes the byte after it, and goes with a newline. */
+  char *line = malloc(n + 1);
+  bool *literal = calloc(n + 1, sizeof(bool));
+  size_t out = 0;
+  for (size_t k = 0; k < n; k++) {
+    if (!raw && in[k] == '\\') {
+      if (++k == n)
+        break;
+      if (in[k] == '\n')
+        continue;
+      literal[out] = true;
+    }
+    line[out++] = in[k];
+  }
+  line[out] = '\0';
+  b->start += at >= 0 ? n + 1 : n;
+  inbuf_release(b, fd);
+
+  int status = 0;
+  if (len > i) {
+    char *names[len - i];
+    for (size_t k = i; k < len; k++)
+      names[k - i] = tokens_get_token(tokens, k);
+    status = assign_fields(line, literal, out, names, len - i);
+  } else if (vars_set("REPLY", line, 0) == -1) {
+    fprintf(stderr, "read: REPLY: readonly variable\n");
+    status = 1;
+  }
+  free(line);
+  free(literal);
+  if (status != 0)
+    return status;
+  return at >= 0 ? 0 : 1;
+}
+
+int cmd_mapfile(struct tokens *tokens) {
+  size_t len = tokens_get_length(tokens), i = 1;
+  bool strip = false;
+  char delim = '\n';
+  int fd = 0;
+  long count = 0, skip = 0;
+  for (; i < len && tokens_get_token(tokens, i)[0] == '-'; i++) {
+    char *opt = tokens_get_token(tokens, i), *end = NULL;
+    if (strcmp(opt, "-t") == 0) {
+      strip = true;
+    } else if (strcmp(opt, "-d") == 0 && i + 1 < len) {
+      delim = tokens_get_token(tokens, ++i)[0];
+    } else if (strcmp(opt, "-u") == 0 && i + 1 < len && parse_fd(tokens_get_token(tokens, i + 1), &fd)) {
+      i++;
+    } else if (strcmp(opt, "-n") == 0 && i + 1 < len &&
+        (count = strtol(tokens_get_token(tokens, ++i), &end, 10)) >= 0 && *end == '\0') {
+    } else if (strcmp(opt, "-s") == 0 && i + 1 < len &&
+        (skip = strtol(tokens_get_token(tokens, ++i), &end, 10)) >= 0 && *end == '\0') {
+    } else {
+      fprintf(stderr, "usage: mapfile [-t] [-d delim] [-n count] [-s count] [-u fd] [name]\n");
+      return 2;
+    }
+  }
+  const char *name = i < len ? tokens_get_token(tokens, i) : "MAPFILE";
+
+  struct inbuf *b = inbuf_get(fd);
+  if (b == NULL) {
+    fprintf(stderr, "mapfile: %d: %s\n", fd, strerror(errno));
+    return 1;
+  }
+  size_t index = 0;
+  int status = 0;
+  while (count == 0 || index < (size_t) count) {
+    size_t scanned = 0;
+    ssize_t at = find_delim(b, fd, delim, false, BULK_BLOCK, &scanned);
+    size_t n = at >= 0 ? (size_t) at : b->end - b->start;
+    if (at < 0 && n == 0)
+      break;
+    char *line = b->data + b->start;
+    size_t keep = at >= 0 && !strip ? n + 1 : n;
+    char saved = line[keep];
+    line[keep] = '\0';
+    if (skip > 0)
+      skip--;
+    else if (vars_array_set(name, index++, line) == -1)
+      status = 1;
+    line[keep] = saved;
+    b->start += at >= 0 ? n + 1 : n;
+    if (at < 0 || status != 0)
+      break;
+  }
+  inbuf_release(b, fd);
+  if (status != 0) {
+    fprintf(stderr, "mapfile: %s: readonly variable\n", name);
+    return 1;
+  }
+  vars_array_truncate(name, index);
+  return 0;
+}
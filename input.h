@@ -0,0 +1,17 @@
+#pragma once
+
+#include "tokenizer.h"
+
+/* read and mapfile take input in blocks instead of a byte per read(2).
+ *
+ * On a regular file the fd is moved back with lseek() to just after what was used, so
+ * whoever reads the file next starts where read stopped.
+ *
+ * On a pipe or terminal that can't be done: what was read ahead stays in a buffer the
+ * shell keeps per fd, and the next read or mapfile on that fd takes from it first.
+ * The handoff rule: bytes read ahead belong to read and mapfile only. A command run
+ * between two reads of a pipe (while read l; do cat; done) sees the pipe after them.
+ * The buffer is dropped once the fd refers to something else (a new redirection). */
+
+int cmd_read(struct tokens *tokens);
+int cmd_mapfile(struct tokens *tokens);
@@ -0,0 +1,522 @@
+#define _GNU_SOURCE
+#include <dirent.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "history.h"
+#include "lineedit.h"
+#include "shell.h"
+#include "vars.h"
+
+static int le_fd = -1;
+static struct termios le_cooked;
+
+/* A sorted array of names, used for both the command index and directory listings. */
+struct name {
+  char *name;
+  bool dir;
+};
+
+struct name_list {
+  struct name *names;
+  size_t count, cap;
+};
+
+static void names_add(struct name_list *list, const char *name, bool dir) {
+  if (list->count == list->cap) {
+    list->cap = list->cap ? list->cap * 2 : 256;
+    list->names = realloc(list->names, list->cap * sizeof(struct name));
+  }
+  list->names[list->count].name = strdup(name);
+  list->names[list->count++].dir = dir;
+}
+
+static void names_clear(struct name_list *list) {
+  for (size_t i = 0; i < list->count; i++)
+    free(list->names[i].name);
+  list->count = 0;
+}
+
+static int name_cmp(const void *a, const void *b) {
+  return strcmp(((const struct name *) a)->name, ((const struct name *) b)->name);
+}
+
+static int name_ptr_cmp(const void *a, const void *b) {
+  return name_cmp(*(const struct name **) a, *(const struct name **) b);
+}
+
+/* Sorts the list and drops duplicates (the same program in two PATH directories). */
+static void names_sort(struct name_list *list) {
+  qsort(list->names, list->count, sizeof(struct name), name_cmp);
+  size_t out = 0;
+  for (size_t i = 0; i < list->count; i++) {
+    if (out > 0 && strcmp(list->names[out - 1].name, list->names[i].name) == 0) {
+      free(list->names[i].name);
+      continue;
+    }
+    list->names[out++] = list->names[i];
+  }
+  list->count = out;
+}
+
+/* Index of the first name >= prefix. */
+static size_t names_lower_bound(const struct name_list *list, const char *prefix) {
+  size_t lo = 0, hi = list->count;
+  while (lo < hi) {
+    size_t mid = (lo + hi) / 2;
+    if (strcmp(list->names[mid].name, prefix) < 0)
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo;
+}
+
+/* Adds every entry of dir to list; directories only if with_dirs. */
+static void names_read_dir(struct name_list *list, const char *dir, bool with_dirs) {
+  DIR *d = opendir(dir);
+  if (d == NULL)
+    return;
+  struct dirent *ent;
+  while ((ent = readdir(d)) != NULL) {
+    if (strcmp(ent->d_name, ".") == 0 || strcmp(ent->d_name, "..") == 0)
+      continue;
+    bool is_dir = ent->d_type == DT_DIR;
+    if (ent->d_type == DT_UNKNOWN || ent->d_type == DT_LNK) {
+      struct stat st;
+      is_dir = fstatat(dirfd(d), ent->d_name, &st, 0) == 0 && S_ISDIR(st.st_mode);
+    }
+    if (is_dir && !with_dirs)
+      continue;
+    names_add(list, ent->d_name, is_dir);
+  }
+  closedir(d);
+}
+
+/* Every program on $PATH, rebuilt only when $PATH or one of its directories changes, so a
+ * Tab press costs a stat() per PATH entry plus a binary search. */
+static struct {
+  char *path;
+  struct timespec *mtimes;
+  size_t ndirs;
+  struct name_list list;
+} cmd_index;
+
+static void cmd_index_refresh(void) {
+  const char *path = vars_get("PATH");
+  if (path == NULL)
+    path = "";
+
+  size_t ndirs = 1;
+  for (const char *p = path; *p; p++)
+    ndirs += *p == ':';
+  struct timespec mtimes[ndirs];
+  char copy[strlen(path) + 1];
+  strcpy(copy, path);
+  size_t i = 0;
+  for (char *save, *dir = strtok_r(copy, ":", &save); dir; dir = strtok_r(NULL, ":", &save)) {
+    struct stat st;
+    mtimes[i++] = stat(dir, &st) == 0 ? st.st_mtim : (struct timespec) {0, 0};
+  }
+  ndirs = i;
+
+  if (cmd_index.path && strcmp(cmd_index.path, path) == 0 && cmd_index.ndirs == ndirs &&
+      memcmp(cmd_index.mtimes, mtimes, ndirs * sizeof(struct timespec)) == 0)
+    return;
+
+  free(cmd_index.path);
+  cmd_index.path = strdup(path);
+  cmd_index.mtimes = realloc(cmd_index.mtimes, (ndirs ? ndirs : 1) * sizeof(struct timespec));
+  memcpy(cmd_index.mtimes, mtimes, ndirs * sizeof(struct timespec));
+  cmd_index.ndirs = ndirs;
+
+  names_clear(&cmd_index.list);
+  strcpy(copy, path);
+  for (char *save, *dir = strtok_r(copy, ":", &save); dir; dir = strtok_r(NULL, ":", &save))
+    names_read_dir(&cmd_index.list, dir, false);
+  names_sort(&cmd_index.list);
+}
+
+/* Recently completed-in directories, reread only when their mtime changes. */
+#define DIR_CACHE_SIZE 8
+
+static struct {
+  char *dir;
+  struct timespec mtime;
+  unsigned long used;
+  struct name_list list;
+} dir_cache[DIR_CACHE_SIZE];
+
+static unsigned long dir_cache_clock;
+
+static const struct name_list *dir_cache_get(const char *dir) {
+  struct stat st;
+  if (stat(dir, &st) == -1)
+    return NULL;
+
+  int slot = 0;
+  for (int i = 0; i < DIR_CACHE_SIZE; i++) {
+    if (dir_cache[i].dir && strcmp(dir_cache[i].dir, dir) == 0) {
+      slot = i;
+      break;
+    }
+    if (dir_cache[i].used < dir_cache[slot].used)
+      slot = i;
+  }
+  dir_cache[slot].used = ++dir_cache_clock;
+  if (dir_cache[slot].dir && strcmp(dir_cache[slot].dir, dir) == 0 &&
+      dir_cache[slot].mtime.tv_sec == st.st_mtim.tv_sec &&
+      dir_cache[slot].mtime.tv_nsec == st.st_mtim.tv_nsec)
+    return &dir_cache[slot].list;
+
+  free(dir_cache[slot].dir);
+  dir_cache[slot].dir = strdup(dir);
+  dir_cache[slot].mtime = st.st_mtim;
+  names_clear(&dir_cache[slot].list);
+  names_read_dir(&dir_cache[slot].list, dir, true);
+  names_sort(&dir_cache[slot].list);
+  return &dir_cache[slot].list;
+}
+
+static void builtin_name_add(const char *name, void *ctx) {
+  names_add(ctx, name, false);
+}
+
+/* The line being edited. */
+static struct {
+  char *buf;
+  size_t size, len, pos;
+  const char *prompt;
+  bool listed; /* the last key was a Tab that couldn't extend the word */
+} le;
+
+static void le_write(const char *s, size_t n) {
+  while (n > 0) {
+    ssize_t w = write(le_fd, s, n);
+    if (w <= 0)
+      return;
+    s += w;
+    n -= w;
+  }
+}
+
+static int le_columns(void) {
+  struct winsize ws;
+  if (ioctl(le_fd, TIOCGWINSZ, &ws) == -1 || ws.ws_col == 0)
+    return 80;
+  return ws.ws_col;
+}
+
+/* Redraws prompt and line in one write, scrolling sideways when the line is too wide. */
+static void le_refresh(void) {
+  const char *prompt = le.prompt;
+  size_t plen = strlen(prompt);
+  size_t cols = le_columns();
+  /* A prompt that leaves no room for the line isn't drawn. */
+  if (plen + 1 >= cols) {
+    prompt = "";
+    plen = 0;
+  }
+  size_t start = plen + le.pos >= cols ? plen + le.pos - cols + 1 : 0, len = le.len;
+  if (plen + len - start > cols - 1)
+    len = start + cols - 1 - plen;
+
+  char out[plen + len - start + 32];
+  int n = sprintf(out, "\r%s", prompt);
+  memcpy(out + n, le.buf + start, len - start);
+  n += len - start;
+  n += sprintf(out + n, "\x1b[0K\r");
+  if (plen + le.pos - start > 0)
+    n += sprintf(out + n, "\x1b[%zuC", plen + le.pos - start);
+  le_write(out, n);
+}
+
+static void le_insert(const char *s, size_t n) {
+  if (le.len + n + 2 > le.size)
+    n = le.size - le.len - 2;
+  memmove(le.buf + le.pos + n, le.buf + le.pos, le.len - le.pos);
+  memcpy(le.buf + le.pos, s, n);
+  le.pos += n;
+  le.len += n;
+}
+
+static void le_delete(size_t from, size_t to) {
+  memmove(le.buf + from, le.buf + to, le.len - to);
+  le.len -= to - from;
+  le.pos = from;
+}
+
+static void le_set(const char *s) {
+  le.len = le.pos = 0;
+  le_insert(s, strlen(s));
+}
+
+/* Prints the candidates under the line in columns. */
+static void le_list(const struct name **cands, size_t n) {
+  size_t width = 0;
+  for (size_t i = 0; i < n; i++)
+    if (strlen(cands[i]->name) + cands[i]->dir > width)
+      width = strlen(cands[i]->name) + cands[i]->dir;
+  width += 2;
+  size_t per_row = le_columns() / width;
+  if (per_row == 0)
+    per_row = 1;
+
+  le_write("\r\n", 2);
+  for (size_t i = 0; i < n && i < 200; i++) {
+    char cell[width + 8];
+    int len = sprintf(cell, "%s%s", cands[i]->name, cands[i]->dir ? "/" : "");
+    bool eol = (i + 1) % per_row == 0 || i + 1 == n;
+    if (!eol)
+      len += sprintf(cell + len, "%*s", (int) (width - len), "");
+    le_write(cell, len);
+    if (eol)
+      le_write("\r\n", 2);
+  }
+  if (n > 200)
+    le_write("...\r\n", 5);
+}
+
+/* Appends every name in list that starts with prefix to cands. */
+static void le_collect(const struct name_list *list, const char *prefix,
+    const struct name ***cands, size_t *n, size_t *cap) {
+  size_t plen = strlen(prefix);
+  for (size_t i = names_lower_bound(list, prefix); i < list->count; i++) {
+    if (strncmp(list->names[i].name, prefix, plen) != 0)
+      break;
+    if (*n == *cap) {
+      *cap = *cap ? *cap * 2 : 64;
+      *cands = realloc(*cands, *cap * sizeof(struct name *));
+    }
+    (*cands)[(*n)++] = &list->names[i];
+  }
+}
+
+/* Completes the word before the cursor: a command name in command position, else a path. */
+static void le_complete(void) {
+  size_t start = le.pos;
+  while (start > 0 && le.buf[start - 1] != ' ')
+    start--;
+  size_t before = start;
+  while (before > 0 && le.buf[before - 1] == ' ')
+    before--;
+  bool command = before == 0 || strchr("|;&(", le.buf[before - 1]) != NULL;
+
+  char word[le.pos - start + 1];
+  memcpy(word, le.buf + start, le.pos - start);
+  word[le.pos - start] = '\0';
+
+  const struct name **cands = NULL;
+  size_t n = 0, cap = 0;
+  const char *prefix = word;
+  struct name_list builtins = {0};
+
+  if (command && strchr(word, '/') == NULL) {
+    cmd_index_refresh();
+    builtins_each(builtin_name_add, &builtins);
+    names_sort(&builtins);
+    le_collect(&builtins, word, &cands, &n, &cap);
+    le_collect(&cmd_index.list, word, &cands, &n, &cap);
+    /* A builtin shadowing a program (pwd) is one candidate, not two. */
+    qsort(cands, n, sizeof(struct name *), name_ptr_cmp);
+    size_t out = 0;
+    for (size_t i = 0; i < n; i++)
+      if (out == 0 || strcmp(cands[out - 1]->name, cands[i]->name) != 0)
+        cands[out++] = cands[i];
+    n = out;
+  } else {
+    char *slash = strrchr(word, '/');
+    char dir[4096];
+    if (slash == NULL) {
+      strcpy(dir, ".");
+    } else {
+      const char *home = vars_get("HOME");
+      if (word[0] == '~' && word[1] == '/' && home)
+        snprintf(dir, sizeof(dir), "%s%.*s", home, (int) (slash - word - 1), word + 1);
+      else
+        snprintf(dir, sizeof(dir), "%.*s", (int) (slash - word + 1), word);
+      prefix = slash + 1;
+    }
+    const struct name_list *list = dir_cache_get(dir);
+    /* Hidden files only when asked for with a leading dot. */
+    if (list)
+      le_collect(list, prefix, &cands, &n, &cap);
+    if (prefix[0] != '.') {
+      size_t out = 0;
+      for (size_t i = 0; i < n; i++)
+        if (cands[i]->name[0] != '.')
+          cands[out++] = cands[i];
+      n = out;
+    }
+  }
+
+  if (n > 0) {
+    /* Extend the word by what all candidates share. */
+    size_t plen = strlen(prefix), common = strlen(cands[0]->name);
+    for (size_t i = 1; i < n; i++) {
+      size_t j = plen;
+      while (j < common && cands[i]->name[j] == cands[0]->name[j])
+        j++;
+      common = j;
+    }
+    if (common > plen || n == 1) {
+      for (size_t i = plen; i < common; i++) {
+        char c = cands[0]->name[i];
+        if (strchr(" \t'\"\\|&;<>()$", c))
+          le_insert("\\", 1);
+        le_insert(&c, 1);
+      }
+      if (n == 1)
+        le_insert(cands[0]->dir ? "/" : " ", 1);
+      le.listed = false;
+    } else if (le.listed) {
+      le_list(cands, n);
+      le.listed = false;
+    } else {
+      le.listed = true;
+    }
+  }
+  free(cands);
+  names_clear(&builtins);
+  free(builtins.names);
+}
+
+void lineedit_init(int fd, const struct termios *cooked) {
+  le_fd = fd;
+  le_cooked = *cooked;
+}
+
+char *lineedit_read(const char *prompt, char *buf, size_t size) {
+  struct termios raw = le_cooked;
+  raw.c_iflag &= ~(BRKINT | ICRNL | INPCK | ISTRIP | IXON);
+  raw.c_lflag &= ~(ECHO | ICANON | IEXTEN | ISIG);
+  raw.c_cc[VMIN] = 1;
+  raw.c_cc[VTIME] = 0;
+  tcsetattr(le_fd, TCSADRAIN, &raw);
+
+  le.buf = buf;
+  le.size = size;
+  le.len = le.pos = 0;
+  le.prompt = prompt;
+  le.listed = false;
+
+  /* Browsing history keeps the line being typed in saved, restored past the newest. */
+  size_t hist_total = history_count(), hist_pos = hist_total;
+  char saved[size];
+  saved[0] = '\0';
+
+  bool eof = false;
+  le_refresh();
+  for (;;) {
+    unsigned char c;
+    if (read(le_fd, &c, 1) != 1) {
+      eof = true;
+      break;
+    }
+    if (c != '\t')
+      le.listed = false;
+
+    if (c == '\r' || c == '\n') {
+      break;
+    } else if (c == 4) { /* ^D */
+      if (le.len == 0) {
+        eof = true;
+        break;
+      }
+      if (le.pos < le.len)
+        le_delete(le.pos, le.pos + 1);
+    } else if (c == 3) { /* ^C abandons the line */
+      le_write("^C\r\n", 4);
+      le.len = le.pos = 0;
+    } else if (c == 127 || c == 8) {
+      if (le.pos > 0)
+        le_delete(le.pos - 1, le.pos);
+    } else if (c == '\t') {
+      le_complete();
+    } else if (c == 1) { /* ^A */
+      le.pos = 0;
+    } else if (c == 5) { /* ^E */
+      le.pos = le.len;
+    } else if (c == 2) { /* ^B */
+      if (le.pos > 0)
+        le.pos--;
+    } else if (c == 6) { /* ^F */
+      if (le.pos < le.len)
+        le.pos++;
+    } else if (c == 11) { /* ^K */
+      le.len = le.pos;
+    } else if (c == 21) { /* ^U */
+      le_delete(0, le.pos);
+    } else if (c == 23) { /* ^W */
+      size_t from = le.pos;
+      while (from > 0 && le.buf[from - 1] == ' ')
+        from--;
+      while (from > 0 && le.buf[from - 1] != ' ')
+        from--;
+      le_delete(from, le.pos);
+    } else if (c == 12) { /* ^L */
+      le_write("\x1b[H\x1b[2J", 7);
+    } else if (c == 27) {
+      unsigned char seq[3];
+      if (read(le_fd, &seq[0], 1) != 1 || read(le_fd, &seq[1], 1) != 1)
+        continue;
+      if (seq[0] != '[' && seq[0] != 'O')
+        continue;
+      if (seq[1] >= '0' && seq[1] <= '9') {
+        if (read(le_fd, &seq[2], 1) != 1)
+          continue;
+        if (seq[1] == '3' && seq[2] == '~' && le.pos < le.len)
+          le_delete(le.pos, le.pos + 1);
+        else if ((seq[1] == '1' || seq[1] == '7') && seq[2] == '~')
+          le.pos = 0;
+        else if ((seq[1] == '4' || seq[1] == '8') && seq[2] == '~')
+          le.pos = le.len;
+        le_refresh();
+        continue;
+      }
+      if (seq[1] == 'A' || seq[1] == 'B') {
+        size_t next = hist_pos;
+        if (seq[1] == 'A' && hist_pos > 0)
+          next--;
+        else if (seq[1] == 'B' && hist_pos < hist_total)
+          next++;
+        if (next != hist_pos) {
+          if (hist_pos == hist_total) {
+            memcpy(saved, le.buf, le.len);
+            saved[le.len] = '\0';
+          }
+          hist_pos = next;
+          char entry[size];
+          if (hist_pos == hist_total)
+            le_set(saved);
+          else if (history_command(hist_pos, entry, size - 2) >= 0)
+            le_set(entry);
+        }
+      } else if (seq[1] == 'C' && le.pos < le.len) {
+        le.pos++;
+      } else if (seq[1] == 'D' && le.pos > 0) {
+        le.pos--;
+      } else if (seq[1] == 'H') {
+        le.pos = 0;
+      } else if (seq[1] == 'F') {
+        le.pos = le.len;
+      }
+    } else if (c >= 32) {
+      char ch = c;
+      le_insert(&ch, 1);
+    }
+    le_refresh();
+  }
+
+  le_write("\r\n", 2);
+  tcsetattr(le_fd, TCSADRAIN, &le_cooked);
+  if (eof && le.len == 0)
+    return NULL;
+  buf[le.len] = '\n';
+  buf[le.len + 1] = '\0';
+  return buf;
+}
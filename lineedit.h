@@ -0,0 +1,13 @@
+#pragma once
+
+#include <stddef.h>
+#include <termios.h>
+
+/* Sets up the editor on terminal fd; cooked are the modes saved by init_shell(), which
+ * are back in place whenever lineedit_read() isn't running. */
+void lineedit_init(int fd, const struct termios *cooked);
+
+/* Reads one line with editing, history recall (up/down) and tab completion of commands
+ * and file names. The line ends up in buf with a trailing newline, like fgets(). Returns
+ * NULL at end of input (^D on an empty line). */
+char *lineedit_read(const char *prompt, char *buf, size_t size);
@@ -0,0 +1,352 @@
+#define _GNU_SOURCE
+#include <ctype.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include "output.h"
+
+#define OUT_CHUNK 65536
+#define OUT_CHUNKS 16 /* a megabyte, then it goes out */
+
+static char *chunks[OUT_CHUNKS];
+static size_t used[OUT_CHUNKS];
+static size_t nchunks; /* the ones with something in them; the last may have room left */
+static FILE *out_stream;
+
+/* Hands the chunks to fd 1, in as many writev() calls as a pipe needs, and empties them.
+ * If fd 1 is gone (EPIPE, closed) the output is dropped, as a write() would drop it. */
+static void out_drain(void) {
+  struct iovec iov[OUT_CHUNKS], *p = iov;
+  size_t n = nchunks;
+  for (size_t i = 0; i < n; i++)
+    iov[i] = (struct iovec) {chunks[i], used[i]};
+  while (n > 0) {
+    ssize_t done = writev(STDOUT_FILENO, p, n);
+    if (done == -1 && errno == EINTR)
+      continue;
+    if (done <= 0)
+      break;
+    for (; n > 0 && (size_t) done >= p->iov_len; p++, n--)
+      done -= p->iov_len;
+    if (n > 0) {
+      p->iov_base = (char *) p->iov_base + done;
+      p->iov_len -= done;
+    }
+  }
+  for (size_t i = 0; i < nchunks; i++)
+    used[i] = 0;
+  nchunks = 0;
+}
+
+static ssize_t out_write(__attribute__((unused)) void *cookie, const char *buf, size_t size) {
+  for (size_t left = size; left > 0; ) {
+    if (nchunks == 0 || used[nchunks - 1] == OUT_CHUNK) {
+      if (nchunks == OUT_CHUNKS)
+        out_drain();
+      if (chunks[nchunks] == NULL)
+        chunks[nchunks] = malloc(OUT_CHUNK);
+      nchunks++;
+    }
+    size_t i = nchunks - 1, n = OUT_CHUNK - used[i];
+    if (n > left)
+      n = left;
+    memcpy(chunks[i] + used[i], buf, n);
+    used[i] += n;
+    buf += n;
+    left -= n;
+  }
+  return size;
+}
+
+/* stderr is written as soon as it is, but after what stdout has pending, so the two
+ * interleave on a terminal as they were printed. */
+static ssize_t err_write(__attribute__((unused)) void *cookie, const char *buf, size_t size) {
+  out_flush();
+  size_t done = 0;
+  while (done < size) {
+    ssize_t n = write(STDERR_FILENO, buf + done, size - done);
+    if (n == -1 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      break;
+    done += n;
+  }
+  return size;
+}
+
+void out_init(void) {
+  cookie_io_functions_t io = {.write = out_write}, err_io = {.write = err_write};
+  out_stream = fopencookie(NULL, "w", io);
+  FILE *err = fopencookie(NULL, "w", err_io);
+  if (out_stream == NULL || err == NULL)
+    return;
+  setvbuf(err, NULL, _IONBF, 0);
+  stdout = out_stream;
+  stderr = err;
+  atexit(out_flush);
+}
+
+void out_flush(void) {
+  if (out_stream != NULL)
+    fflush(out_stream);
+  if (stdout != out_stream)
+    fflush(stdout);
+  if (nchunks > 0)
+    out_drain();
+}
+
+/* The backslash escapes of printf's format, of echo -e (octal needs a leading 0, \c
+ * stops the output) and of printf %b (octal with or without the 0, \c too). */
+enum dialect { ESC_FORMAT, ESC_ECHO, ESC_B };
+
+/* Writes the escape whose backslash is just before s to f and returns how many bytes of
+ * s it used; \c sets *stop. An unknown escape stays as it is. */
+static size_t put_escape(FILE *f, const char *s, enum dialect dialect, bool *stop) {
+  bool echo = dialect != ESC_FORMAT;
+  static const char from[] = "\\abefnrtv", to[] = "\\\a\b\033\f\n\r\t\v";
+  const char *known = *s ? strchr(from, *s) : NULL;
+  if (known != NULL) {
+    putc(to[known - from], f);
+    return 1;
+  }
+  if (*s == 'c' && echo) {
+    *stop = true;
+    return 1;
+  }
+  if ((*s == '"' || *s == '\'') && !echo) {
+    putc(*s, f);
+    return 1;
+  }
+  size_t n = 0, max = 3, skip = 0;
+  int value = 0, base = 8;
+  if (*s == 'x') {
+    base = 16;
+    max = 2;
+    skip = 1;
+  } else if (echo && *s == '0') {
+    skip = 1;
+  } else if (dialect == ESC_ECHO || *s < '0' || *s > '7') {
+    putc('\\', f);
+    return 0;
+  }
+  for (; n < max && isxdigit((unsigned char) s[skip + n]); n++) {
+    char c = s[skip + n];
+    if (base == 8 && (c < '0' || c > '7'))
+      break;
+    value = value * base + (isdigit((unsigned char) c) ? c - '0' : tolower(c) - 'a' + 10);
+  }
+  if (base == 16 && n == 0) {
+    putc('\\', f);
+    return 0;
+  }
+  putc(value & 0xff, f);
+  return skip + n;
+}
+
+/* Writes s with its escapes; false if a \c ended it. */
+static bool put_escaped(FILE *f, const char *s, enum dialect dialect) {
+  bool stop = false;
+  while (!stop) {
+    const char *slash = strchr(s, '\\');
+    if (slash == NULL) {
+      fputs(s, f);
+      break;
+    }
+    fwrite(s, 1, slash - s, f);
+    s = slash + 1;
+    s += put_escape(f, s, dialect, &stop);
+  }
+  return !stop;
+}
+
+int cmd_echo(struct tokens *tokens) {
+  size_t len = tokens_get_length(tokens), i = 1;
+  bool newline = true, escapes = false;
+  for (; i < len; i++) {
+    const char *opt = tokens_get_token(tokens, i);
+    if (opt[0] != '-' || opt[1] == '\0' || strspn(opt + 1, "neE") != strlen(opt + 1))
+      break;
+    for (opt++; *opt; opt++) {
+      if (*opt == 'n')
+        newline = false;
+      else
+        escapes = *opt == 'e';
+    }
+  }
+  for (size_t k = i; k < len; k++) {
+    if (k > i)
+      putc(' ', stdout);
+    const char *arg = tokens_get_token(tokens, k);
+    if (!escapes)
+      fputs(arg, stdout);
+    else if (!put_escaped(stdout, arg, ESC_ECHO))
+      return 0;
+  }
+  if (newline)
+    putc('\n', stdout);
+  return 0;
+}
+
+/* What printf's conversions are fed from its arguments, one after another; an argument
+ * that is missing counts as "" or 0. */
+struct printf_args {
+  struct tokens *tokens;
+  size_t next, len;
+  int status;
+};
+
+static const char *next_arg(struct printf_args *a) {
+  return a->next < a->len ? tokens_get_token(a->tokens, a->next++) : NULL;
+}
+
+/* 'c and "c stand for c's code, as in POSIX; anything else is a number in C syntax. */
+static bool char_code(const char *s, long long *value) {
+  if (s == NULL || (s[0] != '\'' && s[0] != '"'))
+    return false;
+  *value = (unsigned char) s[1];
+  return true;
+}
+
+static void bad_number(struct printf_args *a, const char *s, const char *end) {
+  if (end == s || *end != '\0' || errno == ERANGE) {
+    fprintf(stderr, "printf: %s: invalid number\n", s);
+    a->status = 1;
+  }
+}
+
+static long long integer_arg(struct printf_args *a) {
+  const char *s = next_arg(a);
+  long long value = 0;
+  if (s == NULL || char_code(s, &value))
+    return value;
+  char *end;
+  errno = 0;
+  value = strtoll(s, &end, 0);
+  bad_number(a, s, end);
+  return value;
+}
+
+static long double float_arg(struct printf_args *a) {
+  const char *s = next_arg(a);
+  long long code;
+  if (s == NULL)
+    return 0;
+  if (char_code(s, &code))
+    return code;
+  char *end;
+  errno = 0;
+  long double value = strtold(s, &end);
+  bad_number(a, s, end);
+  return value;
+}
+
+/* One pass over the format. Conversions are handed to fprintf() one at a time, with
+ * their flags, width and precision as written and the argument converted to suit. */
+static bool printf_once(const char *f, struct printf_args *a) {
+  bool stop = false;
+  while (*f && !stop) {
+    size_t plain = strcspn(f, "\\%");
+    fwrite(f, 1, plain, stdout);
+    f += plain;
+    if (*f == '\\') {
+      f++;
+      f += put_escape(stdout, f, ESC_FORMAT, &stop);
+      continue;
+    }
+    if (*f == '\0')
+      break;
+    if (f[1] == '%') {
+      putc('%', stdout);
+      f += 2;
+      continue;
+    }
+
+    char spec[32];
+    size_t n = 0;
+    int stars[2], nstars = 0;
+    spec[n++] = *f++;
+    while (*f && strchr("-+ #0", *f) && n < 8)
+      spec[n++] = *f++;
+    for (int part = 0; part < 2; part++) {
+      if (part == 1) {
+        if (*f != '.')
+          break;
+        spec[n++] = *f++;
+      }
+      if (*f == '*') {
+        stars[nstars++] = (int) integer_arg(a);
+        spec[n++] = *f++;
+      }
+      for (size_t digits = 0; isdigit((unsigned char) *f) && digits < 8; digits++)
+        spec[n++] = *f++;
+    }
+    char conv = *f;
+    if (conv == '\0' || strchr("diouxXcsbeEfFgGaA", conv) == NULL) {
+      fprintf(stderr, "printf: %%%c: invalid format character\n", conv);
+      a->status = 1;
+      return false;
+    }
+    f++;
+
+#define PRINT(value) (nstars == 0 ? fprintf(stdout, spec, value) \
+    : nstars == 1 ? fprintf(stdout, spec, stars[0], value) \
+    : fprintf(stdout, spec, stars[0], stars[1], value))
+
+    if (strchr("di", conv)) {
+      strcpy(spec + n, "lld");
+      PRINT(integer_arg(a));
+    } else if (strchr("ouxX", conv)) {
+      sprintf(spec + n, "ll%c", conv);
+      PRINT((unsigned long long) integer_arg(a));
+    } else if (strchr("eEfFgGaA", conv)) {
+      sprintf(spec + n, "L%c", conv);
+      PRINT(float_arg(a));
+    } else if (conv == 'c') {
+      const char *s = next_arg(a);
+      strcpy(spec + n, s && *s ? "c" : "s");
+      if (s && *s)
+        PRINT(*s);
+      else
+        PRINT("");
+    } else if (conv == 's') {
+      const char *s = next_arg(a);
+      strcpy(spec + n, "s");
+      PRINT(s ? s : "");
+    } else {
+      /* %b: the argument with echo's escapes, then padded like %s */
+      const char *s = next_arg(a);
+      char *text = NULL;
+      size_t size;
+      FILE *m = open_memstream(&text, &size);
+      stop = m == NULL || !put_escaped(m, s ? s : "", ESC_B);
+      if (m != NULL)
+        fclose(m);
+      strcpy(spec + n, "s");
+      PRINT(text ? text : "");
+      free(text);
+    }
+#undef PRINT
+  }
+  return !stop;
+}
+
+int cmd_printf(struct tokens *tokens) {
+  size_t len = tokens_get_length(tokens);
+  if (len < 2) {
+    fprintf(stderr, "usage: printf format [argument...]\n");
+    return 2;
+  }
+  struct printf_args a = {tokens, 2, len, 0};
+  const char *format = tokens_get_token(tokens, 1);
+  /* The format is used again while arguments are left, if it used any at all. */
+  for (;;) {
+    size_t before = a.next;
+    if (!printf_once(format, &a) || a.next == before || a.next >= len)
+      break;
+  }
+  return a.status;
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include "tokenizer.h"
+
+/* Builtins print to stdout as before, but the shell's stdout is a stream whose bytes
+ * collect in chunks the shell owns, and out_flush() hands them to fd 1 in one writev().
+ * That happens after every command read from the input, before anything forks, execs or
+ * moves fd 1, before read waits for input, at exit, and whenever a megabyte has piled
+ * up. A loop of echos costs a write per megabyte, and no child inherits unwritten
+ * output to write it a second time. $(...) still swaps stdout for a memory stream. */
+void out_init(void);
+void out_flush(void);
+
+int cmd_echo(struct tokens *tokens);
+int cmd_printf(struct tokens *tokens);
@@ -0,0 +1,221 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "heredoc.h"
+#include "redir.h"
+#include "output.h"
+
+const struct redir_plan *redir_pending;
+
+#define TRUNC (O_WRONLY | O_CREAT | O_TRUNC)
+#define APPEND (O_WRONLY | O_CREAT | O_APPEND)
+
+/* Longest first, so >> isn't taken for >. fd -1 is &>: both 1 and 2. */
+static const struct {
+  const char *op;
+  int fd;
+  int kind;
+  int flags;
+} ops[] = {
+  {"<<<", 0, REDIR_HERESTRING, 0},
+  {"<<", 0, REDIR_HEREDOC, 0},
+  {"<>", 0, REDIR_OPEN, O_RDWR | O_CREAT},
+  {"<&", 0, REDIR_DUP, 0},
+  {"<", 0, REDIR_OPEN, O_RDONLY},
+  {"&>>", -1, REDIR_OPEN, APPEND},
+  {"&>", -1, REDIR_OPEN, TRUNC},
+  {">>", 1, REDIR_OPEN, APPEND},
+  {">&", 1, REDIR_DUP, 0},
+  {">|", 1, REDIR_OPEN, TRUNC},
+  {">", 1, REDIR_OPEN, TRUNC},
+};
+
+/* The operator at the start of raw: its index in ops, the fd written before it (or -1)
+ * and the length of both. */
+static size_t match_op(const char *raw, int *op, int *fd) {
+  size_t digits = strspn(raw, "0123456789");
+  *fd = -1;
+  if (digits > 0) {
+    if (digits > 4)
+      return 0;
+    *fd = atoi(raw);
+  }
+  for (size_t k = 0; k < sizeof(ops) / sizeof(ops[0]); k++) {
+    size_t len = strlen(ops[k].op);
+    if (strncmp(raw + digits, ops[k].op, len) == 0) {
+      if (digits > 0 && ops[k].fd == -1)
+        return 0; /* 2&> is not a thing */
+      if (digits == 0 && len == 1 && raw[1] == '(')
+        return 0; /* <(cmd) is a process substitution */
+      *op = k;
+      return digits + len;
+    }
+  }
+  return 0;
+}
+
+size_t redir_op_length(const char *raw) {
+  int op, fd;
+  return match_op(raw, &op, &fd);
+}
+
+bool redir_any(struct tokens *tokens) {
+  for (size_t i = 0; i < tokens_get_length(tokens); i++)
+    if (redir_op_length(tokens_get_raw(tokens, i)) > 0)
+      return true;
+  return false;
+}
+
+static void add_step(struct redir_plan *plan, size_t *cap, struct redir_step step) {
+  if (plan->nsteps == *cap) {
+    *cap = *cap ? *cap * 2 : 4;
+    plan->steps = realloc(plan->steps, *cap * sizeof(struct redir_step));
+  }
+  plan->steps[plan->nsteps++] = step;
+}
+
+int redir_plan(struct tokens *tokens, struct redir_plan *plan) {
+  size_t len = tokens_get_length(tokens), cap = 0;
+  plan->steps = NULL;
+  plan->nsteps = 0;
+  plan->args = tokens_create();
+
+  for (size_t i = 0; i < len; i++) {
+    const char *raw = tokens_get_raw(tokens, i), *word = tokens_get_token(tokens, i);
+    int op, fd;
+    size_t op_len = match_op(raw, &op, &fd);
+    if (op_len == 0) {
+      tokens_append(plan->args, word, raw);
+      continue;
+    }
+
+    /* The operator is unquoted, so it is the same in the word and as written. */
+    const char *target = word + op_len;
+    if (raw[op_len] == '\0') {
+      if (i + 1 == len) {
+        fprintf(stderr, "%s: missing word after it\n", word);
+        redir_plan_free(plan);
+        return -1;
+      }
+      target = tokens_get_token(tokens, ++i);
+    }
+
+    struct redir_step step = {ops[op].kind, fd >= 0 ? fd : ops[op].fd, -1, ops[op].flags, target};
+    if (step.kind == REDIR_DUP) {
+      char *end;
+      long from = strtol(target, &end, 10);
+      if (strcmp(target, "-") == 0) {
+        step.kind = REDIR_CLOSE;
+      } else if (*target != '\0' && *end == '\0') {
+        step.from = from;
+      } else if (fd < 0 && ops[op].op[0] == '>') {
+        /* >&file is &>file */
+        step = (struct redir_step) {REDIR_OPEN, -1, -1, TRUNC, target};
+      } else {
+        fprintf(stderr, "%s: ambiguous redirect\n", target);
+        redir_plan_free(plan);
+        return -1;
+      }
+    }
+    if (step.fd == -1) {
+      /* &>file: the file on 1, then 2 a copy of it */
+      step.fd = 1;
+      add_step(plan, &cap, step);
+      step = (struct redir_step) {REDIR_DUP, 2, 1, 0, NULL};
+    }
+    add_step(plan, &cap, step);
+  }
+  return 0;
+}
+
+void redir_plan_free(struct redir_plan *plan) {
+  free(plan->steps);
+  tokens_destroy(plan->args);
+  plan->steps = NULL;
+  plan->args = NULL;
+}
+
+/* One step: a dup2() for n>&m, and for a file an open() plus a dup2() and close() only
+ * when the kernel didn't already hand out the fd it goes on. */
+static int apply_step(const struct redir_step *s) {
+  int fd;
+  switch (s->kind) {
+  case REDIR_CLOSE:
+    close(s->fd);
+    return 0;
+  case REDIR_DUP:
+    if ((s->from == s->fd ? fcntl(s->fd, F_GETFD) : dup2(s->from, s->fd)) == -1) {
+      fprintf(stderr, "%d: %s\n", s->from, strerror(errno));
+      return -1;
+    }
+    return 0;
+  case REDIR_OPEN:
+    fd = open(s->word, s->flags, 0666);
+    if (fd == -1) {
+      fprintf(stderr, "%s: %s\n", s->word, strerror(errno));
+      return -1;
+    }
+    break;
+  default:
+    fd = heredoc_open(s->word, s->kind == REDIR_HERESTRING);
+    if (fd == -1)
+      return -1;
+    break;
+  }
+  if (fd != s->fd) {
+    dup2(fd, s->fd);
+    close(fd);
+  } else {
+    fcntl(fd, F_SETFD, 0); /* heredoc fds are close-on-exec */
+  }
+  return 0;
+}
+
+int redir_apply(const struct redir_plan *plan) {
+  for (size_t i = 0; i < plan->nsteps; i++)
+    if (apply_step(&plan->steps[i]) == -1)
+      return -1;
+  return 0;
+}
+
+int redir_apply_saved(const struct redir_plan *plan, struct redir_saved *saved) {
+  saved->fds = malloc(plan->nsteps * sizeof(*saved->fds));
+  saved->n = 0;
+  out_flush();
+  fflush(stderr);
+  for (size_t i = 0; i < plan->nsteps; i++) {
+    const struct redir_step *s = &plan->steps[i];
+    bool known = false;
+    for (size_t k = 0; k < saved->n; k++) {
+      known |= saved->fds[k].fd == s->fd;
+      /* Don't let the command overwrite a copy we keep. */
+      if (saved->fds[k].copy == s->fd)
+        saved->fds[k].copy = fcntl(s->fd, F_DUPFD_CLOEXEC, 10);
+    }
+    if (!known) {
+      saved->fds[saved->n].fd = s->fd;
+      saved->fds[saved->n++].copy = fcntl(s->fd, F_DUPFD_CLOEXEC, 10);
+    }
+    if (apply_step(s) == -1)
+      return -1;
+  }
+  return 0;
+}
+
+void redir_restore(struct redir_saved *saved) {
+  out_flush();
+  fflush(stderr);
+  for (size_t i = saved->n; i-- > 0; ) {
+    if (saved->fds[i].copy >= 0) {
+      dup2(saved->fds[i].copy, saved->fds[i].fd);
+      close(saved->fds[i].copy);
+    } else {
+      close(saved->fds[i].fd);
+    }
+  }
+  free(saved->fds);
+}
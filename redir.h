@@ -0,0 +1,54 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "tokenizer.h"
+
+/* One redirection, planned before anything is opened. */
+struct redir_step {
+  enum { REDIR_OPEN, REDIR_DUP, REDIR_CLOSE, REDIR_HEREDOC, REDIR_HERESTRING } kind;
+  int fd;           /* what it changes */
+  int from;         /* REDIR_DUP: fd becomes a copy of this one */
+  int flags;        /* REDIR_OPEN */
+  const char *word; /* path or body; points into the planned tokens */
+};
+
+/* A command's redirections in the order they are applied, and the words left over. */
+struct redir_plan {
+  struct redir_step *steps;
+  size_t nsteps;
+  struct tokens *args; /* the command without its redirections */
+};
+
+/* Length of the unquoted [n]op at the start of a word as written (2>&1, >>file, &>),
+ * or 0 if it doesn't start with a redirection. */
+size_t redir_op_length(const char *raw);
+
+/* Whether tokens has a redirection in it. */
+bool redir_any(struct tokens *tokens);
+
+/* Plans the redirections in tokens, which must outlive plan. Returns -1 after a message
+ * if one is missing its word. */
+int redir_plan(struct tokens *tokens, struct redir_plan *plan);
+void redir_plan_free(struct redir_plan *plan);
+
+/* Redirections for the external command the shell is about to start, or NULL; progrExe()
+ * applies them in the child. */
+extern const struct redir_plan *redir_pending;
+
+/* Applies plan to the calling process, for good: a child about to exec, or exec without
+ * a command. The fds it sets up are inherited by later commands. -1 after a message. */
+int redir_apply(const struct redir_plan *plan);
+
+/* The fds redir_apply_saved() changed, kept above 10 with close-on-exec. */
+struct redir_saved {
+  struct {
+    int fd, copy; /* copy is -1 if fd wasn't open */
+  } *fds;
+  size_t n;
+};
+
+/* Applies plan in the shell around a builtin; redir_restore() puts the fds back, whether
+ * or not this succeeded. */
+int redir_apply_saved(const struct redir_plan *plan, struct redir_saved *saved);
+void redir_restore(struct redir_saved *saved);
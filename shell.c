@@ -1,1511 +1,1768 @@
-#include <ctype.h>
-#include <errno.h>
-#include <stdbool.h>
-#include <stdio.h>
-#include <stdlib.h>
-#include <string.h>
-#include <sys/types.h>
-#include <signal.h>
-#include <sys/wait.h>
-#include <termios.h>
-#include <unistd.h>
-#include <dirent.h>
-#include <sys/time.h>
-#include <sys/resource.h>
-#include <sys/stat.h>
-#include <fcntl.h>
-#include <stdio.h>
-#include "tokenizer.h"
-
-
-/* Convenience macro to silence compiler warnings about unused function parameters. */
-#define unused __attribute__((unused))
-
-/* Whether the shell is connected to an actual terminal or not. */
-bool shell_is_interactive;
-
-/* File descriptor for the shell input */
-int shell_terminal;
-
-/* Terminal mode settings for the shell */
-struct termios shell_tmodes;
-
-/* Process group id for the shell */
-pid_t shell_pgid;
-
-int cmd_exit(struct tokens *tokens);
-int cmd_help(struct tokens *tokens);
-int cmd_pwd(struct tokens * tokens);
-int cmd_cd(struct tokens *tokens);
-int cmd_ulimit(struct tokens * tokens);
-int cmd_nice(struct tokens * tokens);
-int cmd_type(struct tokens * tokens);
-int cmd_kill(struct tokens * tokens);
-/* Built-in command functions take token array (see parse.h) and return int */
-typedef int cmd_fun_t(struct tokens *tokens);
-
-/* Built-in command struct and lookup table */
-typedef struct fun_desc {
-  cmd_fun_t *fun;
-  char *cmd;
-  char *doc;
-} fun_desc_t;
-
-fun_desc_t cmd_table[] = {
-  {cmd_help, "?", "show this help menu"},
-  {cmd_exit, "exit", "exit the command shell"},
-  {cmd_pwd,"pwd","prints working directory"},
-  {cmd_cd,"cd","change directory"},
-  {cmd_ulimit,"ulimit","prints or changes current limit"},
-  {cmd_nice,"nice","prints or changes niceness"},
-  {cmd_type,"type","prints whether command is buili-in function or other program"},
-  {cmd_kill, "kill", "send a signal to a process"}
-};
-/* Looks up the built-in command, if it exists. */
-int lookup(char cmd[]) {
-  for (unsigned int i = 0; i < sizeof(cmd_table) / sizeof(fun_desc_t); i++)
-    if (cmd && (strcmp(cmd_table[i].cmd, cmd) == 0))
-      return i;
-  return -1;
-}
-
-int getlimit(unused struct tokens * tokens) {
-	int status = -1;
-	struct rlimit  * t = malloc(sizeof(struct rlimit)); 
-	if(tokens_get_length(tokens)  == 1) {
-		status = getrlimit(RLIMIT_FSIZE,t);
-		if(t->rlim_cur == RLIM_INFINITY) {
-			printf("%s\n","unlimited");
-		} else {
-			printf("%lu \n",t->rlim_cur);
-		}
-		return status;
-	}
-	char * lastpart = tokens_get_token(tokens,(size_t)1); 
-	if(strcmp(lastpart,"-a")== 0 || strcmp(lastpart,"-Sa")== 0 || strcmp(lastpart,"-Ha")== 0) {
-		if(strcmp(lastpart,"-Ha")== 0) {
-			status = getrlimit(RLIMIT_CORE,t);
-			if(t->rlim_max == RLIM_INFINITY) {
-				printf("core file size		(blocks, -c) %s\n","unlimited");
-			} else{
-				printf("core file size		(blocks, -c) %lu\n",t->rlim_max);
-			} 
-			status = getrlimit(RLIMIT_DATA,t);
-			if(t->rlim_max == RLIM_INFINITY) {
-				printf("data seg size		(kbytes, -d) %s\n","unlimited");
-			} else{
-				printf("data seg size		(kbytes, -d) %lu\n",t->rlim_max/1024);
-			}
-			status = getrlimit(RLIMIT_FSIZE,t);
-			if(t->rlim_max == RLIM_INFINITY) {
-				printf("file size		(blocks, -f) %s\n","unlimited");
-			} else{
-				printf("file size		(blocks, -f) %lu\n",t->rlim_max);
-			}
-			status = getrlimit(RLIMIT_SIGPENDING,t);
-			if(t->rlim_max == RLIM_INFINITY) {
-				printf("pending signals			(-i) %s\n","unlimited");
-			} else{
-				printf("pending signals			(-i) %lu\n",t->rlim_max);
-			}
-			status = getrlimit(RLIMIT_MEMLOCK,t);
-			if(t->rlim_max == RLIM_INFINITY) {
-				printf("max locked memory	(kbytes, -l) %s\n","unlimited");
-			} else{
-				printf("max locked memory	(kbytes, -l) %lu\n",t->rlim_max/1024);
-			}
-			status = getrlimit(RLIMIT_NOFILE,t);
-			if(t->rlim_max == RLIM_INFINITY) {
-				printf("open files			(-n) %s\n","unlimited");
-			} else{
-				printf("open files			(-n) %lu\n",t->rlim_max);
-			}
-			status = getrlimit(RLIMIT_MSGQUEUE,t);
-			if(t->rlim_max == RLIM_INFINITY) {
-				printf("POSIX message queues	 (bytes, -q) %s\n","unlimited");
-			} else{
-				printf("POSIX message queues	 (bytes, -q) %lu\n",t->rlim_max);
-			}
-			status = getrlimit(RLIMIT_RTPRIO,t);
-			if(t->rlim_max == RLIM_INFINITY) {
-				printf("real-time priority		(-r) %s\n","unlimited");
-			} else{
-				printf("real-time priority		(-r) %lu\n",t->rlim_max);
-			}
-			status = getrlimit(RLIMIT_STACK,t);
-			if(t->rlim_max == RLIM_INFINITY) {
-				printf("stack size		 (kbytes,-s) %s\n","unlimited");
-			} else{
-				printf("stack size		 (kbytes,-s) %lu\n",t->rlim_max/1024);
-			}
-			status = getrlimit(RLIMIT_CPU,t);
-			if(t->rlim_max == RLIM_INFINITY) {
-				printf("spu time		(seconds,-t) %s\n","unlimited");
-			} else{
-				printf("cpu time		(seconds,-t) %lu\n",t->rlim_max);
-			}
-			status = getrlimit(RLIMIT_NPROC,t);
-			if(t->rlim_max == RLIM_INFINITY) {
-				printf("max user processes		(-u) %s\n","unlimited");
-			} else{
-				printf("max user processes		(-u) %lu\n",t->rlim_max);
-			}
-			status = getrlimit(RLIMIT_AS,t);
-			if(t->rlim_max == RLIM_INFINITY) {
-				printf("virtual memory		 (kbytes,-v) %s\n","unlimited");
-			} else{
-				printf("virtual memory		 (kbytes,-v) %lu\n",t->rlim_max/1024);
-			}
-			status = getrlimit(RLIMIT_LOCKS,t);
-			if(t->rlim_max == RLIM_INFINITY) {
-				printf("file locks			(-x) %s\n","unlimited");
-			} else{
-				printf("file locks			(-x) %lu\n",t->rlim_max);
-			}
-			return status;
-
-		}
-			status = getrlimit(RLIMIT_CORE,t);
-			if(t->rlim_cur == RLIM_INFINITY) {
-				printf("core file size		(blocks, -c) %s\n","unlimited");
-			} else{
-				printf("core file size		(blocks, -c) %lu\n",t->rlim_cur);
-			} 
-			status = getrlimit(RLIMIT_DATA,t);
-			if(t->rlim_cur == RLIM_INFINITY) {
-				printf("data seg size		(kbytes, -d) %s\n","unlimited");
-			} else{
-				printf("data seg size		(kbytes, -d) %lu\n",t->rlim_cur/1024);
-			}
-			status = getrlimit(RLIMIT_FSIZE,t);
-			if(t->rlim_cur == RLIM_INFINITY) {
-				printf("file size		(blocks, -f) %s\n","unlimited");
-			} else{
-				printf("file size		(blocks, -f) %lu\n",t->rlim_cur);
-			}
-			status = getrlimit(RLIMIT_SIGPENDING,t);
-			if(t->rlim_cur == RLIM_INFINITY) {
-				printf("pending signals			(-i) %s\n","unlimited");
-			} else{
-				printf("pending signals			(-i) %lu\n",t->rlim_cur);
-			}
-			status = getrlimit(RLIMIT_MEMLOCK,t);
-			if(t->rlim_cur == RLIM_INFINITY) {
-				printf("max locked memory	(kbytes, -l) %s\n","unlimited");
-			} else{
-				printf("max locked memory	(kbytes, -l) %lu\n",t->rlim_cur/1024);
-			}
-			status = getrlimit(RLIMIT_NOFILE,t);
-			if(t->rlim_cur == RLIM_INFINITY) {
-				printf("open files			(-n) %s\n","unlimited");
-			} else{
-				printf("open files			(-n) %lu\n",t->rlim_cur);
-			}
-			status = getrlimit(RLIMIT_MSGQUEUE,t);
-			if(t->rlim_cur == RLIM_INFINITY) {
-				printf("POSIX message queues	 (bytes, -q) %s\n","unlimited");
-			} else{
-				printf("POSIX message queues	 (bytes, -q) %lu\n",t->rlim_cur);
-			}
-			status = getrlimit(RLIMIT_RTPRIO,t);
-			if(t->rlim_cur == RLIM_INFINITY) {
-				printf("real-time priority		(-r) %s\n","unlimited");
-			} else{
-				printf("real-time priority		(-r) %lu\n",t->rlim_cur);
-			}
-			status = getrlimit(RLIMIT_STACK,t);
-			if(t->rlim_cur == RLIM_INFINITY) {
-				printf("stack size		 (kbytes,-s) %s\n","unlimited");
-			} else{
-				printf("stack size		 (kbytes,-s) %lu\n",t->rlim_cur/1024);
-			}
-			status = getrlimit(RLIMIT_CPU,t);
-			if(t->rlim_cur == RLIM_INFINITY) {
-				printf("spu time		(seconds,-t) %s\n","unlimited");
-			} else{
-				printf("cpu time		(seconds,-t) %lu\n",t->rlim_cur);
-			}
-			status = getrlimit(RLIMIT_NPROC,t);
-			if(t->rlim_cur == RLIM_INFINITY) {
-				printf("max user processes		(-u) %s\n","unlimited");
-			} else{
-				printf("max user processes		(-u) %lu\n",t->rlim_cur);
-			}
-			status = getrlimit(RLIMIT_AS,t);
-			if(t->rlim_cur == RLIM_INFINITY) {
-				printf("virtual memory		 (kbytes,-v) %s\n","unlimited");
-			} else{
-				printf("virtual memory		 (kbytes,-v) %lu\n",t->rlim_cur/1024);
-			}
-			status = getrlimit(RLIMIT_LOCKS,t);
-			if(t->rlim_cur == RLIM_INFINITY) {
-				printf("file locks			(-x) %s\n","unlimited");
-			} else{
-				printf("file locks			(-x) %lu\n",t->rlim_cur);
-			}
-			return status;
-			
-	}
-	if(strcmp(lastpart,"-f")== 0 || strcmp(lastpart,"-Sf")== 0 || strcmp(lastpart,"-Hf")== 0){
-		status = getrlimit(RLIMIT_FSIZE,t);
-		if(strcmp(lastpart,"-Hf")== 0) {
-			if(t->rlim_max == RLIM_INFINITY) {
-				printf("%s\n","unlimited");
-			} else {
-				printf("%lu\n",t->rlim_max);
-			}
-			return status;
-		}
-		if(t->rlim_cur == RLIM_INFINITY) {
-			printf("%s\n","unlimited");
-		} else {
-			printf("%lu\n",t->rlim_cur);
-		}
-		return status;
-	} else if(strcmp(lastpart,"-c")== 0 || strcmp(lastpart,"-Sc")== 0 || strcmp(lastpart,"-Hc")== 0) {
-		status = getrlimit(RLIMIT_CORE,t);
-		if(strcmp(lastpart,"-Hc")== 0) {
-			if(t->rlim_max == RLIM_INFINITY) {
-				printf("%s\n","unlimited");
-			} else {
-				printf("%lu\n",t->rlim_max);
-			}
-			return status;
-		}
-		if(t->rlim_cur == RLIM_INFINITY) {
-			printf("%s\n","unlimited");
-		} else {
-			printf("%lu\n",t->rlim_cur);
-		}
-		return status;
-	} else if(strcmp(lastpart,"-t")== 0 || strcmp(lastpart,"-St")== 0 || strcmp(lastpart,"-Ht")== 0) {
-		status = getrlimit(RLIMIT_CPU,t);
-		if(strcmp(lastpart,"-Ht")== 0) {
-			if(t->rlim_max == RLIM_INFINITY) {
-				printf("%s\n","unlimited");
-			} else {
-				printf("%lu\n",t->rlim_max);
-			}
-			return status;
-		}
-		if(t->rlim_cur == RLIM_INFINITY) {
-			printf("%s\n","unlimited");
-		} else {
-			printf("%lu\n",t->rlim_cur);
-		}
-		return status;
-	} else if(strcmp(lastpart,"-v")== 0 || strcmp(lastpart,"-Sv")== 0 || strcmp(lastpart,"-Hv")== 0) {
-		status = getrlimit(RLIMIT_AS,t);
-		if(strcmp(lastpart,"-Hv")== 0) {
-			if(t->rlim_max == RLIM_INFINITY) {
-				printf("%s\n","unlimited");
-			} else {
-				printf("%lu\n",t->rlim_max/1024);
-			}
-			return status;
-		}
-		if(t->rlim_cur == RLIM_INFINITY) {
-			printf("%s\n","unlimited");
-		} else {
-			printf("%lu\n",t->rlim_cur/1024);
-		}
-		return status;
-	} else if(strcmp(lastpart,"-d")== 0 || strcmp(lastpart,"-Sd")== 0 || strcmp(lastpart,"-Hd")== 0) {
-		status = getrlimit(RLIMIT_DATA,t);
-		if(strcmp(lastpart,"-Hd")== 0) {
-			if(t->rlim_max == RLIM_INFINITY) {
-				printf("%s\n","unlimited");
-			} else {
-				printf("%lu\n",t->rlim_max/1024);
-			}
-			return status;
-		}
-		if(t->rlim_cur == RLIM_INFINITY) {
-			printf("%s\n","unlimited");
-		} else {
-			printf("%lu\n",t->rlim_cur/1024);
-		}
-		return status;
-	} else if(strcmp(lastpart,"-x")== 0 || strcmp(lastpart,"-Sx")== 0 || strcmp(lastpart,"-Hx")== 0) {
-		status = getrlimit(RLIMIT_LOCKS,t);
-		if(strcmp(lastpart,"-Hx")== 0) {
-			if(t->rlim_max == RLIM_INFINITY) {
-				printf("%s\n","unlimited");
-			} else {
-				printf("%lu\n",t->rlim_max);
-			}
-			return status;
-		}
-		if(t->rlim_cur == RLIM_INFINITY) {
-			printf("%s\n","unlimited");
-		} else {
-			printf("%lu\n",t->rlim_cur);
-		}
-		return status;
-	} else if(strcmp(lastpart,"-l")== 0 || strcmp(lastpart,"-Sl")== 0 || strcmp(lastpart,"-Hl")== 0) {
-		status = getrlimit(RLIMIT_MEMLOCK,t);
-		if(strcmp(lastpart,"-Hl")== 0) {
-			if(t->rlim_max == RLIM_INFINITY) {
-				printf("%s\n","unlimited");
-			} else {
-				printf("%lu\n",t->rlim_max/1024);
-			}
-			return status;
-		}
-		if(t->rlim_cur == RLIM_INFINITY) {
-			printf("%s\n","unlimited");
-		} else {
-			printf("%lu\n",t->rlim_cur/1024);
-		}
-		return status;
-	}
-	else if(strcmp(lastpart,"-q")== 0 || strcmp(lastpart,"-Sq")== 0 || strcmp(lastpart,"-Hq")== 0) {
-		status = getrlimit(RLIMIT_MSGQUEUE,t);
-		if(strcmp(lastpart,"-Hq")== 0) {
-			if(t->rlim_max == RLIM_INFINITY) {
-				printf("%s\n","unlimited");
-			} else {
-				printf("%lu\n",t->rlim_max);
-			}
-			return status;
-		}
-		if(t->rlim_cur == RLIM_INFINITY) {
-			printf("%s\n","unlimited");
-		} else {
-			printf("%lu\n",t->rlim_cur);
-		}
-		return status;
-	} else if(strcmp(lastpart,"-n")== 0 || strcmp(lastpart,"-Sn")== 0 || strcmp(lastpart,"-Hn")== 0) {
-		status = getrlimit(RLIMIT_NOFILE,t);
-		if(strcmp(lastpart,"-Hn")== 0) {
-			if(t->rlim_max == RLIM_INFINITY) {
-				printf("%s\n","unlimited");
-			} else {
-				printf("%lu\n",t->rlim_max);
-			}
-			return status;
-		}
-		if(t->rlim_cur == RLIM_INFINITY) {
-			printf("%s\n","unlimited");
-		} else {
-			printf("%lu\n",t->rlim_cur);
-		}
-		return status;
-	}else if(strcmp(lastpart,"-r")== 0 || strcmp(lastpart,"-Sr")== 0 || strcmp(lastpart,"-Hr")== 0) {
-		status = getrlimit(RLIMIT_RTPRIO,t);
-		if(strcmp(lastpart,"-Hr")== 0) {
-			if(t->rlim_max == RLIM_INFINITY) {
-				printf("%s\n","unlimited");
-			} else {
-				printf("%lu\n",t->rlim_max);
-			}
-			return status;
-		}
-		if(t->rlim_cur == RLIM_INFINITY) {
-			printf("%s\n","unlimited");
-		} else {
-			printf("%lu\n",t->rlim_cur);
-		}
-		return status;
-	}	else if(strcmp(lastpart,"-i")== 0 || strcmp(lastpart,"-Si")== 0 || strcmp(lastpart,"-Hi")== 0) {
-		status = getrlimit(RLIMIT_SIGPENDING,t);
-		if(strcmp(lastpart,"-Hi")== 0) {
-			if(t->rlim_max == RLIM_INFINITY) {
-				printf("%s\n","unlimited");
-			} else {
-				printf("%lu\n",t->rlim_max);
-			}
-			return status;
-		}
-		if(t->rlim_cur == RLIM_INFINITY) {
-			printf("%s\n","unlimited");
-		} else {
-			printf("%lu\n",t->rlim_cur);
-		}
-		return status;
-	}	else if(strcmp(lastpart,"-s")== 0 || strcmp(lastpart,"-Ss")== 0 || strcmp(lastpart,"-Hs")== 0) {
-			status = getrlimit(RLIMIT_STACK,t);
-			if(strcmp(lastpart,"-Hs")== 0) {
-				if(t->rlim_max == RLIM_INFINITY) {
-					printf("%s\n","unlimited");
-				} else {
-					printf("%lu\n",t->rlim_max/1024);
-				}
-			return status;
-		}
-		if(t->rlim_cur == RLIM_INFINITY) {
-			printf("%s\n","unlimited");
-		} else {
-			printf("%lu\n",t->rlim_cur/1024);
-		}
-		return status;
-	}	else if(strcmp(lastpart,"-u")== 0 || strcmp(lastpart,"-Su")== 0 || strcmp(lastpart,"-Hu")== 0) {
-		status = getrlimit(RLIMIT_NPROC,t);
-		if(strcmp(lastpart,"-Hu")== 0) {
-			if(t->rlim_max == RLIM_INFINITY) {
-				printf("%s\n","unlimited");
-			} else {
-				printf("%lu\n",t->rlim_max);
-			}
-			return status;
-		}
-		if(t->rlim_cur == RLIM_INFINITY) {
-			printf("%s\n","unlimited");
-		} else {
-			printf("%lu\n",t->rlim_cur);
-		}
-		return status;
-	}
-	return status;
-}
-int setlimit(unused struct tokens * tokens) {
-	int status = -1;
-	int setstatus = -1;
-	struct rlimit  * t = malloc(sizeof(struct rlimit)); 
-	struct rlimit *newlimit = malloc(sizeof(struct rlimit));
-	char * lastpart = tokens_get_token(tokens,(size_t)1); 
-	if(strcmp(lastpart,"-f")== 0 || strcmp(lastpart,"-Sf")== 0 || strcmp(lastpart,"-Hf")== 0){
-		status = getrlimit(RLIMIT_FSIZE,t);
-		if(strcmp(lastpart,"-Hf")== 0) {
-			newlimit->rlim_cur = t->rlim_cur;
-			if(strcmp(tokens_get_token(tokens,(size_t)2),"unlimited") == 0) {
-				newlimit->rlim_max = RLIM_INFINITY;
-			} else {
-				newlimit->rlim_max = atoi(tokens_get_token(tokens,(size_t)2));
-			}
-			setstatus = setrlimit(RLIMIT_FSIZE,newlimit);
-			return setstatus;
-		}
-			newlimit->rlim_max = t->rlim_max;
-			if(strcmp(tokens_get_token(tokens,(size_t)2),"unlimited") == 0) {
-				newlimit->rlim_cur = RLIM_INFINITY;
-			} else {
-				newlimit->rlim_cur = atoi(tokens_get_token(tokens,(size_t)2));
-			}
-			setstatus = setrlimit(RLIMIT_FSIZE,newlimit);
-			return setstatus;
-		
-	} else if(strcmp(lastpart,"-c")== 0 || strcmp(lastpart,"-Sc")== 0 || strcmp(lastpart,"-Hc")== 0) {
-		status = getrlimit(RLIMIT_CORE,t);
-		if(strcmp(lastpart,"-Hc")== 0) {
-			newlimit->rlim_cur = t->rlim_cur;
-			if(strcmp(tokens_get_token(tokens,(size_t)2),"unlimited") == 0) {
-				newlimit->rlim_max = RLIM_INFINITY;
-			} else {
-				newlimit->rlim_max = atoi(tokens_get_token(tokens,(size_t)2));
-			}
-			setstatus = setrlimit(RLIMIT_CORE,newlimit);
-			return setstatus;
-		}
-			newlimit->rlim_max = t->rlim_max;
-			if(strcmp(tokens_get_token(tokens,(size_t)2),"unlimited") == 0) {
-				newlimit->rlim_cur = RLIM_INFINITY;
-			} else {
-				newlimit->rlim_cur = atoi(tokens_get_token(tokens,(size_t)2));
-			}
-			setstatus = setrlimit(RLIMIT_CORE,newlimit);
-			return setstatus;
-	} else if(strcmp(lastpart,"-t")== 0 || strcmp(lastpart,"-St")== 0 || strcmp(lastpart,"-Ht")== 0) {
-		status = getrlimit(RLIMIT_CPU,t);
-		if(strcmp(lastpart,"-Ht")== 0) {
-			newlimit->rlim_cur = t->rlim_cur;
-			if(strcmp(tokens_get_token(tokens,(size_t)2),"unlimited") == 0) {
-				newlimit->rlim_max = RLIM_INFINITY;
-			} else {
-				newlimit->rlim_max = atoi(tokens_get_token(tokens,(size_t)2));
-			}
-			setstatus = setrlimit(RLIMIT_CPU,newlimit);
-			return setstatus;
-		}
-			newlimit->rlim_max = t->rlim_max;
-			if(strcmp(tokens_get_token(tokens,(size_t)2),"unlimited") == 0) {
-				newlimit->rlim_cur = RLIM_INFINITY;
-			} else {
-				newlimit->rlim_cur = atoi(tokens_get_token(tokens,(size_t)2));
-			}
-			setstatus = setrlimit(RLIMIT_CPU,newlimit);
-			return setstatus;
-	} else if(strcmp(lastpart,"-v")== 0 || strcmp(lastpart,"-Sv")== 0 || strcmp(lastpart,"-Hv")== 0) {
-		status = getrlimit(RLIMIT_AS,t);
-		if(strcmp(lastpart,"-Hv")== 0) {
-			newlimit->rlim_cur = t->rlim_cur;
-			if(strcmp(tokens_get_token(tokens,(size_t)2),"unlimited") == 0) {
-				newlimit->rlim_max = RLIM_INFINITY;
-			} else {
-				newlimit->rlim_max = atoi(tokens_get_token(tokens,(size_t)2))*1024;
-			}
-			setstatus = setrlimit(RLIMIT_AS,newlimit);
-			return setstatus;
-		}
-			newlimit->rlim_max = t->rlim_max;
-			if(strcmp(tokens_get_token(tokens,(size_t)2),"unlimited") == 0) {
-				newlimit->rlim_cur = RLIM_INFINITY;
-			} else {
-				newlimit->rlim_cur = atoi(tokens_get_token(tokens,(size_t)2))*1024;
-			}
-			setstatus = setrlimit(RLIMIT_AS,newlimit);
-			return setstatus;
-	} else if(strcmp(lastpart,"-d")== 0 || strcmp(lastpart,"-Sd")== 0 || strcmp(lastpart,"-Hd")== 0) {
-		status = getrlimit(RLIMIT_DATA,t);
-		if(strcmp(lastpart,"-Hd")== 0) {
-			newlimit->rlim_cur = t->rlim_cur;
-			if(strcmp(tokens_get_token(tokens,(size_t)2),"unlimited") == 0) {
-				newlimit->rlim_max = RLIM_INFINITY;
-			} else {
-				newlimit->rlim_max = atoi(tokens_get_token(tokens,(size_t)2))*1024;
-			}
-			setstatus = setrlimit(RLIMIT_DATA,newlimit);
-			return setstatus;
-		}
-			newlimit->rlim_max = t->rlim_max;
-			if(strcmp(tokens_get_token(tokens,(size_t)2),"unlimited") == 0) {
-				newlimit->rlim_cur = RLIM_INFINITY;
-			} else {
-				newlimit->rlim_cur = atoi(tokens_get_token(tokens,(size_t)2))*1024;
-			}
-			setstatus = setrlimit(RLIMIT_DATA,newlimit);
-			return setstatus;
-	} else if(strcmp(lastpart,"-x")== 0 || strcmp(lastpart,"-Sx")== 0 || strcmp(lastpart,"-Hx")== 0) {
-		status = getrlimit(RLIMIT_LOCKS,t);
-		if(strcmp(lastpart,"-Hx")== 0) {
-			newlimit->rlim_cur = t->rlim_cur;
-			if(strcmp(tokens_get_token(tokens,(size_t)2),"unlimited") == 0) {
-				newlimit->rlim_max = RLIM_INFINITY;
-			} else {
-				newlimit->rlim_max = atoi(tokens_get_token(tokens,(size_t)2));
-			}
-			setstatus = setrlimit(RLIMIT_LOCKS,newlimit);
-			return setstatus;
-		}
-			newlimit->rlim_max = t->rlim_max;
-			if(strcmp(tokens_get_token(tokens,(size_t)2),"unlimited") == 0) {
-				newlimit->rlim_cur = RLIM_INFINITY;
-			} else {
-				newlimit->rlim_cur = atoi(tokens_get_token(tokens,(size_t)2));
-			}
-			setstatus = setrlimit(RLIMIT_LOCKS,newlimit);
-			return setstatus;
-	} else if(strcmp(lastpart,"-l")== 0 || strcmp(lastpart,"-Sl")== 0 || strcmp(lastpart,"-Hl")== 0) {
-		status = getrlimit(RLIMIT_MEMLOCK,t);
-		if(strcmp(lastpart,"-Hl")== 0) {
-			newlimit->rlim_cur = t->rlim_cur;
-			if(strcmp(tokens_get_token(tokens,(size_t)2),"unlimited") == 0) {
-				newlimit->rlim_max = RLIM_INFINITY;
-			} else {
-				newlimit->rlim_max = atoi(tokens_get_token(tokens,(size_t)2))*1024;
-			}
-			setstatus = setrlimit(RLIMIT_MEMLOCK,newlimit);
-			return setstatus;
-		}
-			newlimit->rlim_max = t->rlim_max;
-			if(strcmp(tokens_get_token(tokens,(size_t)2),"unlimited") == 0) {
-				newlimit->rlim_cur = RLIM_INFINITY;
-			} else {
-				newlimit->rlim_cur = atoi(tokens_get_token(tokens,(size_t)2))*1024;
-			}
-			setstatus = setrlimit(RLIMIT_MEMLOCK,newlimit);
-			return setstatus;
-
-	}	else if(strcmp(lastpart,"-q")== 0 || strcmp(lastpart,"-Sq")== 0 || strcmp(lastpart,"-Hq")== 0) {
-		status = getrlimit(RLIMIT_MSGQUEUE,t);
-		if(strcmp(lastpart,"-Hq")== 0) {
-			newlimit->rlim_cur = t->rlim_cur;
-			if(strcmp(tokens_get_token(tokens,(size_t)2),"unlimited") == 0) {
-				newlimit->rlim_max = RLIM_INFINITY;
-			} else {
-				newlimit->rlim_max = atoi(tokens_get_token(tokens,(size_t)2));
-			}
-			setstatus = setrlimit(RLIMIT_MSGQUEUE,newlimit);
-			return setstatus;
-		}
-			newlimit->rlim_max = t->rlim_max;
-			if(strcmp(tokens_get_token(tokens,(size_t)2),"unlimited") == 0) {
-				newlimit->rlim_cur = RLIM_INFINITY;
-			} else {
-				newlimit->rlim_cur = atoi(tokens_get_token(tokens,(size_t)2));
-			}
-			setstatus = setrlimit(RLIMIT_MSGQUEUE,newlimit);
-			return setstatus;
-	} else if(strcmp(lastpart,"-n")== 0 || strcmp(lastpart,"-Sn")== 0 || strcmp(lastpart,"-Hn")== 0) {
-		status = getrlimit(RLIMIT_NOFILE,t);
-		if(strcmp(lastpart,"-Hn")== 0) {
-			newlimit->rlim_cur = t->rlim_cur;
-			if(strcmp(tokens_get_token(tokens,(size_t)2),"unlimited") == 0) {
-				newlimit->rlim_max = RLIM_INFINITY;
-			} else {
-				newlimit->rlim_max = atoi(tokens_get_token(tokens,(size_t)2));
-				printf("es unda gaxdes limiti %lu\n",newlimit->rlim_max);
-			}
-			setstatus = setrlimit(RLIMIT_NOFILE,newlimit);
-			printf("%d/n",setstatus);
-			return setstatus;
-		}
-			newlimit->rlim_max = t->rlim_max;
-			if(strcmp(tokens_get_token(tokens,(size_t)2),"unlimited") == 0) {
-				newlimit->rlim_cur = RLIM_INFINITY;
-			} else {
-				newlimit->rlim_cur = atoi(tokens_get_token(tokens,(size_t)2));
-			}
-			setstatus = setrlimit(RLIMIT_NOFILE,newlimit);
-			return setstatus;
-	}else if(strcmp(lastpart,"-r")== 0 || strcmp(lastpart,"-Sr")== 0 || strcmp(lastpart,"-Hr")== 0) {
-		status = getrlimit(RLIMIT_RTPRIO,t);
-		if(strcmp(lastpart,"-Hr")== 0) {
-			newlimit->rlim_cur = t->rlim_cur;
-			if(strcmp(tokens_get_token(tokens,(size_t)2),"unlimited") == 0) {
-				newlimit->rlim_max = RLIM_INFINITY;
-			} else {
-				newlimit->rlim_max = atoi(tokens_get_token(tokens,(size_t)2));
-			}
-			setstatus = setrlimit(RLIMIT_RTPRIO,newlimit);
-			return setstatus;
-		}
-			newlimit->rlim_max = t->rlim_max;
-			if(strcmp(tokens_get_token(tokens,(size_t)2),"unlimited") == 0) {
-				newlimit->rlim_cur = RLIM_INFINITY;
-			} else {
-				newlimit->rlim_cur = atoi(tokens_get_token(tokens,(size_t)2));
-			}
-			setstatus = setrlimit(RLIMIT_RTPRIO,newlimit);
-			return setstatus;
-	}	else if(strcmp(lastpart,"-i")== 0 || strcmp(lastpart,"-Si")== 0 || strcmp(lastpart,"-Hi")== 0) {
-		status = getrlimit(RLIMIT_SIGPENDING,t);
-		if(strcmp(lastpart,"-Hi")== 0) {
-			newlimit->rlim_cur = t->rlim_cur;
-			if(strcmp(tokens_get_token(tokens,(size_t)2),"unlimited") == 0) {
-				newlimit->rlim_max = RLIM_INFINITY;
-			} else {
-				newlimit->rlim_max = atoi(tokens_get_token(tokens,(size_t)2));
-			}
-			setstatus = setrlimit(RLIMIT_SIGPENDING,newlimit);
-			return setstatus;
-		}
-			newlimit->rlim_max = t->rlim_max;
-			if(strcmp(tokens_get_token(tokens,(size_t)2),"unlimited") == 0) {
-				newlimit->rlim_cur = RLIM_INFINITY;
-			} else {
-				newlimit->rlim_cur = atoi(tokens_get_token(tokens,(size_t)2));
-			}
-			setstatus = setrlimit(RLIMIT_SIGPENDING,newlimit);
-			return setstatus;
-	}	else if(strcmp(lastpart,"-s")== 0 || strcmp(lastpart,"-Ss")== 0 || strcmp(lastpart,"-Hs")== 0) {
-		status = getrlimit(RLIMIT_STACK,t);
-		if(strcmp(lastpart,"-Hs")== 0) {
-			newlimit->rlim_cur = t->rlim_cur;
-			if(strcmp(tokens_get_token(tokens,(size_t)2),"unlimited") == 0) {
-				newlimit->rlim_max = RLIM_INFINITY;
-			} else {
-				newlimit->rlim_max = atoi(tokens_get_token(tokens,(size_t)2))*1024;
-			}
-			setstatus = setrlimit(RLIMIT_STACK,newlimit);
-			return setstatus;
-		}
-			newlimit->rlim_max = t->rlim_max;
-			if(strcmp(tokens_get_token(tokens,(size_t)2),"unlimited") == 0) {
-				newlimit->rlim_cur = RLIM_INFINITY;
-			} else {
-				newlimit->rlim_cur = atoi(tokens_get_token(tokens,(size_t)2))*1024;
-			}
-			setstatus = setrlimit(RLIMIT_STACK,newlimit);
-			return setstatus;
-	}	else if(strcmp(lastpart,"-u")== 0 || strcmp(lastpart,"-Su")== 0 || strcmp(lastpart,"-Hu")== 0) {
-		status = getrlimit(RLIMIT_NPROC,t);
-		if(strcmp(lastpart,"-Hu")== 0) {
-			newlimit->rlim_cur = t->rlim_cur;
-			if(strcmp(tokens_get_token(tokens,(size_t)2),"unlimited") == 0) {
-				newlimit->rlim_max = RLIM_INFINITY;
-			} else {
-				newlimit->rlim_max = atoi(tokens_get_token(tokens,(size_t)2));
-			}
-			setstatus = setrlimit(RLIMIT_NPROC,newlimit);
-			return setstatus;
-		}
-			newlimit->rlim_max = t->rlim_max;
-			if(strcmp(tokens_get_token(tokens,(size_t)2),"unlimited") == 0) {
-				newlimit->rlim_cur = RLIM_INFINITY;
-			} else {
-				newlimit->rlim_cur = atoi(tokens_get_token(tokens,(size_t)2));
-			}
-			setstatus = setrlimit(RLIMIT_NPROC,newlimit);
-			return setstatus;
-	}
-	return (setstatus +status);
-}
-int cmd_ulimit(unused struct tokens * tokens) {
-	int status = -1;
-	if(tokens_get_length(tokens)  == 2  || tokens_get_length(tokens)  == 1) {
-		 status = getlimit(tokens);
-		 return status;
-	}
-	if(tokens_get_length(tokens)  == 3) {
-		status = setlimit(tokens);
-		return status;
-	}
-	return status;
-}
-int cmd_nice(unused struct tokens * tokens) {
-	if(tokens_get_length(tokens) == 1) {
-		errno = 0;
-		int prio = getpriority(PRIO_PROCESS,0);
-		if(prio == -1 && errno != 0) {
-			 printf("folowwing error happned : %s\n",strerror(errno));
-			 return -1;
-		}
-		printf("%d\n",prio);
-		return 0;
-	} else if(tokens_get_length(tokens) == 2) {
-		int newniceval = atoi(tokens_get_token(tokens,(size_t)1));
-		int status = setpriority(PRIO_PROCESS,0,newniceval);
-		if(status == -1) {
-			printf("folowwing error happned : %s\n",strerror(errno));
-			return -1;
-		}
-	}
-	return 0;
-}
-
-
-int isIOCommand(struct tokens *tokens) {
-  char *strings[] = {">", "<", ">>"};
-  int size = tokens_get_length(tokens);
-  for (int i = 0; i < size; ++i) {
-    char *tok = tokens_get_token(tokens, i);
-    int arrLen = sizeof(strings)/sizeof(char *);
-    for (int j = 0; j < arrLen; j++) {
-      if (strcmp(tok, strings[j]) == 0){
-        return i;
-      } 
-    }
-  }
-  return 0;  
-}
-
-void handleIoCommand(struct tokens *tokens) {
-
-}
-
-
-
-
-int cmd_cd(unused struct tokens * tokens){
-    char *path = tokens_get_token(tokens,(size_t)1); 
-   
-    char buffer [512]; //buffer for current directory
-    char * currentDirectory = getcwd(buffer,512);
-  
-    if(strcmp(path,"..") == 0 && currentDirectory != NULL)
-    {
-     
-        char * last = strrchr(currentDirectory,'/'); //get address of last occurence of '/'
-        char previousDirectory [512];
-        memset(previousDirectory,0,512);
-        strncpy(previousDirectory,buffer,last-currentDirectory); //last-currentDirectory is size of previous Dir
-        int status = chdir(previousDirectory);
-        if(status == 0){
-           return 0; 
-
-        }else{
-             printf("folowwing error happned : %s\n",strerror(errno));
-             return -1;
-
-        }
-    }
-
-    int status = chdir(path); //change dir if possible for absolute path
-    if(status == 0){
-      return 0;
-
-
-    }else{
-      strcat(buffer,path);
-      int statusRelativePath = chdir(buffer); //change dir if possible for relative current dir + relative path
-      if(statusRelativePath == 0){
-
-
-        return 0;
-      }else{
-           printf("folowwing error happned : %s\n",strerror(errno));
-           return -1;
-
-      }
-
-
-    }
-}
-
-/*prints working directory */
-int cmd_pwd(unused struct tokens *tokens){
-    char * buffer = malloc(512);
-    char * result =  getcwd(buffer,512);
-   if(result == NULL){
-     printf("folowwing error happned : %s\n",strerror(errno));
-    
-     free(buffer);
-     return -1;
-
-   } else {
-     printf("%s\n",buffer);
-     free(buffer);
-     return 0;
-
-   }
-}
-
-int isBg(struct tokens *tokens) {
-  if (strcmp(tokens_get_token(tokens, tokens_get_length(tokens)-1), "&") == 0) return 1;
-  return 0;
-}
-
-
-
-
-/* executes given program,if absolutePath variable is empty that means we already have absolute paht in tokens[0],
-if it's not empty then absolute path will be in absolutePath variable
-
- */
-int progrExe(struct tokens *tokens,char * absolutePath) {
-
-  int isBgProcess = isBg(tokens);
-  int isIO = isIOCommand(tokens);
-  int lastFile;
-  pid_t pid;
-
-  pid = fork();
-
-  if (pid < 0) {
-    fprintf(stderr, "Fork Failed");
-    return 1;
-
-  } else if (pid == 0) {
-
-    if (setpgid(0, 0) == -1) {
-      perror(NULL);
-    }
-
-    size_t nArgs = tokens_get_length(tokens);
-
-    if (isBgProcess) {
-      nArgs = nArgs-1; // this means the last token is '&' symbol and is not a program argument
-    }
-
-    lastFile = nArgs;
-    if (isIO) {
-      lastFile = nArgs-1;
-      nArgs = isIO; // program arguments should be before io sign
-    }  
-
-    char *arr[nArgs+1];
-
-    if(absolutePath == NULL){
-      arr[0] = tokens_get_token(tokens,0);
-    }else{
- 
-      arr[0] = absolutePath;
-    }
-
-
-    // fill arguments for program to be execute
-    for (size_t i = 1; i < nArgs; ++i) {
-      arr[i] = tokens_get_token(tokens, i);
-    }
-
-    arr[nArgs] = NULL;
-
-    if (isIO) {
-      for (int i = isIO; i < lastFile; i += 2){
-        char *file = tokens_get_token(tokens, i+1);
-    
-        int fd;
-    
-    
-        int flags;
-        int newfd;
-    
-        
-        char *tok = tokens_get_token(tokens, i);
-        // output needs to be redrirected
-        if (strcmp(tok, ">") == 0) {
-          newfd = 1;
-          flags = O_CREAT | O_WRONLY | O_TRUNC;
-        // intput needs to be redrirected
-        } else if (strcmp(tok, "<") == 0) {
-          newfd = 0;
-          flags = O_RDONLY;
-        // output needs to be redrirected
-        } else if (strcmp(tok, ">>") == 0) {
-          newfd = 1;
-          flags = O_CREAT | O_WRONLY | O_APPEND;
-        }
-    
-        
-        fd = open(file, flags, S_IRUSR | S_IWUSR);
-        dup2(fd, newfd);
-      }
-    }
-
-    execv(arr[0], arr);
-
-    exit(EXIT_FAILURE); //it comes to this line if only execv failed.In this case termiosnate child process with failure
-
-   
-
-  } else {
-      signal(SIGTTOU, SIG_IGN); // ignore
-      
-    if (setpgid(pid, pid) == -1 && errno != EACCES) {
-      perror(NULL);
-    }
-    if (!isBgProcess) {
-      tcsetpgrp(0, pid);
-    }
-
-    int status = 0;
-    waitpid(-1, &status, WSTOPPED);
-   
-    if (!isBgProcess) {
-      tcsetpgrp(0, getpid());
-    }
-    return WEXITSTATUS(status); //on success returns 0,on error return 1
-
-  }
-
-  return 0;
-}
-
-
-// kill builtin
-int cmd_kill(struct tokens * tokens) {
-
-	int size = tokens_get_length(tokens);
-
-	if (size > 2) {
-		int sigNUM = -atoi(tokens_get_token(tokens, 1));
-		int pid = atoi(tokens_get_token(tokens, 2));
-
-		if (sigNUM > 0 && sigNUM < 65) {
-			return kill(pid, sigNUM);
-		} else {
-			printf("invalid signal specification\n");
-		}
-	}
-
-  return -1;
-}
-
-/* Prints a helpful description for the given command */
-int cmd_help(unused struct tokens *tokens) {
-  for (unsigned int i = 0; i < sizeof(cmd_table) / sizeof(fun_desc_t); i++)
-    printf("%s - %s\n", cmd_table[i].cmd, cmd_table[i].doc);
-  return 1;
-}
-
-/* Exits this shell */
-int cmd_exit(unused struct tokens *tokens) {
-
-  exit(0);
-}
-
-
-
-/* Intialization procedures for this shell */
-void init_shell() {
-  /* Our shell is connected to standard input. */
-  shell_terminal = STDIN_FILENO;
-
-  /* Check if we are running interactively */
-  shell_is_interactive = isatty(shell_terminal);
-
-  if (shell_is_interactive) {
-    /* If the shell is not currently in the foreground, we must pause the shell until it becomes a
-     * foreground process. We use SIGTTIN to pause the shell. When the shell gets moved to the
-     * foreground, we'll receive a SIGCONT. */
-    while (tcgetpgrp(shell_terminal) != (shell_pgid = getpgrp()))
-      kill(-shell_pgid, SIGTTIN);
-
-    /* Saves the shell's process id */
-    shell_pgid = getpid();
-
-    /* Take control of the terminal */
-    tcsetpgrp(shell_terminal, shell_pgid);
-
-    /* Save the current termios to a variable, so it can be restored later. */
-    tcgetattr(shell_terminal, &shell_tmodes);
-  }
-}
-
-char * searchInPath(char * program){
-  char * pathVariable = getenv("PATH");
-  char * copyPath = malloc(strlen(pathVariable)+1);
-  memset(copyPath,0,strlen(pathVariable)+1);
-  strncpy(copyPath,pathVariable,strlen(pathVariable));
-
-  
-
- 
-  for (char *token = strtok(copyPath,":"); token != NULL; token = strtok(NULL, ":"))
-  {
-    DIR *d;
-    struct dirent *dir;
- 
-    d = opendir(token);
-    if (d) {
-     while ((dir = readdir(d)) != NULL) {
-       if(strcmp(dir->d_name,program) == 0){
-         char * copy = malloc(strlen(token) + strlen(program) +2); //keep absolute path to program
-         strcpy(copy,token);
-         strcat(copy,"/");
-         strcat(copy,program);
-         
-
-         free(copyPath); //free copy of env variable 
-         return copy;
-       }
-
-     }
-    closedir(d);
-  }
-
-
-  }
-  free(copyPath); //free copy of env variable 
-  return NULL;
-}
-int cmd_type(unused struct tokens * tokens) {
-	if(tokens_get_length(tokens) == 2) {
-		char * cmd = tokens_get_token(tokens,(size_t)1);
-		char * str = malloc(512);
-		strcpy(str,cmd);
-		int res = lookup(cmd);
-		if(res >= 1) {
-			printf("%s is a shell builtin\n",cmd);
-			return 1;
-		}
-		if(searchInPath(str) != NULL) {
-			printf("%s\n",searchInPath(str));
-			return 1;
-		}
-		if(strcmp(cmd,"!") == 0  || strcmp(cmd,"[[") == 0 || strcmp(cmd,"]]") == 0 || strcmp(cmd,"{") == 0 || strcmp(cmd,"}") == 0 || strcmp(cmd,"case") == 0
-			|| strcmp(cmd,"do") == 0 || strcmp(cmd,"done") == 0 || strcmp(cmd,"fi") == 0 || strcmp(cmd,"for") == 0 || strcmp(cmd,"function") == 0 
-			|| strcmp(cmd,"while") == 0 || strcmp(cmd,"until") == 0 || strcmp(cmd,"select") == 0) {
-			printf("%s is a thell keyword \n",cmd);
-			return 1;
-		}
-		printf("-bash: type : %s : not found \n",cmd);
-		return -1; 
-	} 
-	if(strcmp(tokens_get_token(tokens,(size_t)1),"-a") == 0) {
-		char * cmd = tokens_get_token(tokens,(size_t)2);
-		char * str = malloc(512);
-		strcpy(str,cmd);
-		int res = lookup(cmd);
-		if(res >= 1) {
-			printf("%s is a shell builtin\n",cmd);
-		}
-		if(searchInPath(str) != NULL) {
-			printf("%s\n",searchInPath(str));
-		}
-		return -1;
-	}
-	if(strcmp(tokens_get_token(tokens,(size_t)1),"-p") == 0) {
-		char * cmd = tokens_get_token(tokens,(size_t)2);
-		char * str = malloc(512);
-		strcpy(str,cmd);
-		if(searchInPath(str) != NULL) {
-			printf("%s\n",searchInPath(str));
-		}
-		return -1;
-	}
-
-	return 0;
-}
-
-//calls progrExe based on given absolute path / only command 
-int runMyProgram(struct  tokens * tokens){
-  int status = progrExe(tokens,NULL); //if user gave us absolute path
-
-  if(status == 0){
-    return 0;
-  }else{
-
-    char * commandPath = searchInPath(tokens_get_token(tokens,0)); //user gave us only command.Get the absolutePath
-    
-   
-    int statusForCommand = progrExe(tokens,commandPath);
-    free(commandPath); //deallocation of path
-    if(statusForCommand == 0 ){ //success
-      return 0;
-    }else{
-      
-      return -1;
-    }
-
-  }
-
-}
-
-
-
-
-char ** getExecvArgument(struct  tokens * tokens,int quantityOfPipes , int * pipeTokenLocations ,int childIndex,int numChildren){
-     int start;
-     int end;
-     
-        if(childIndex == 0){
-          start = 0;
-          end = pipeTokenLocations[0];
-        }else {
-          start = pipeTokenLocations[childIndex-1]+1;  
-          if(childIndex == quantityOfPipes ){
-            end = tokens_get_length(tokens);
-          }else {
-            end = pipeTokenLocations[childIndex];
-          }
-        }
-        int argSize = end - start + 1;
-        int argsPos = 1;
-        char ** args = malloc(argSize * sizeof(char*));
-        args[0] = searchInPath(tokens_get_token(tokens,start));
-
-       
-        for(int index =start+1; index < end;index++ ){
-          args[argsPos] = tokens_get_token(tokens,index);
-
-          argsPos++;
-          
-        }
-
-         args[argSize-1] = NULL;
-
-
-    return args;     
-
-}
-
-
-int makePipes(struct tokens * tokens,int * pipeTokenLocations,int quantityOfPipes){
-  int pfd[quantityOfPipes][2];
-  int numChildren = quantityOfPipes +1;
-
-   for (int i=0; i<quantityOfPipes; i++)
-    {
-        if (pipe(pfd[i]) == -1)
-        {
-             printf("folowwing error happned : %s\n",strerror(errno));
-             return -1;
-        }
-    }
-
-  for(int i=0;i<numChildren;i++){
-    pid_t pid = fork();
-
-    if(pid < 0 ){
-       printf("folowwing error happned : %s\n",strerror(errno));
-      exit(EXIT_FAILURE);
-    }else if(pid == 0){
-
-
-       
-          //bind my stdin to previous pipe
-         if(i>0 && i<numChildren-1 ){
-           if(pfd[i-1][0] !=STDIN_FILENO){
-              if(dup2(pfd[i-1][0],STDIN_FILENO) == -1){
-                //errExit("dup2 ");
-                    printf("error with dup : %s\n",strerror(errno));
-                    exit(EXIT_FAILURE);
-              }
-              if(close(pfd[i-1][0]) == -1){
-                //errExit("close desc"); 
-                  printf("error with close: %s\n",strerror(errno));
-                  exit(EXIT_FAILURE);
-
-              }
-
-
-
-           }
-           //close my copy of previous pipe's writing
-            close(pfd[i-1][1]);
-
-            //bind my output to next pipe
-             if(pfd[i][1] !=STDOUT_FILENO){
-                if(dup2(pfd[i][1],STDOUT_FILENO) == -1){
-                  //errExit("dup2 1");
-                      exit(EXIT_FAILURE);
-                }
-                if(close(pfd[i][1]) == -1){
-                  //errExit("close 2"); 
-                      exit(EXIT_FAILURE);
-
-                }
-
-            }
-            //close my copy of next pipe's reading
-            close(pfd[i][0]);
-                 //close my copy of other descriptors
-          for (int j = 0; j < numChildren-1; j++) {
-            if (j != i && j != i - 1)  {
-              close(pfd[j][0]);
-              close(pfd[j][1]);
-              }
-         }
-          char ** args = getExecvArgument(tokens,quantityOfPipes,pipeTokenLocations,i,numChildren); 
-          execv(args[0],args);
-
-        }else   if(i == 0){
-          
-               //close my copy of reading 
-            if(close(pfd[i][0]) == -1){
-              exit(EXIT_FAILURE);
-            }
-             //bind my output to next pipe
-             if(pfd[i][1] !=STDOUT_FILENO){
-                if(dup2(pfd[i][1],STDOUT_FILENO) == -1){
-                  //errExit("dup2 1");
-                      exit(EXIT_FAILURE);
-                }
-                if(close(pfd[i][1]) == -1){
-                  //errExit("close 2"); 
-                      exit(EXIT_FAILURE);
-
-                }
-
-            }
-           
-             for (int j = 0; j < numChildren-1; j++) {
-              if (j != i)  {
-                close(pfd[j][0]);
-                close(pfd[j][1]);
-                }
-             }
-
-            char ** args = getExecvArgument(tokens,quantityOfPipes,pipeTokenLocations,i,numChildren); 
-            execv(args[0],args);
-
-        }else {
-
-            //close my copy of writing
-
-             if(close(pfd[i-1][1]) == -1){
-               exit(EXIT_FAILURE);
-             }
-             if(pfd[i-1][0] !=STDIN_FILENO){
-              if(dup2(pfd[i-1][0],STDIN_FILENO) == -1){
-                //errExit("dup2 ");
-                    printf("error with dup : %s\n",strerror(errno));
-                    exit(EXIT_FAILURE);
-              }
-              if(close(pfd[i-1][0]) == -1){
-                //errExit("close desc"); 
-                  printf("error with close: %s\n",strerror(errno));
-                  exit(EXIT_FAILURE);
-
-              }
-           
-            for (int j = 0; j < numChildren-1; j++) {
-              if (j != i-1  )  {
-                close(pfd[j][0]);
-                close(pfd[j][1]);
-                }
-             }
-
-               char ** args = getExecvArgument(tokens,quantityOfPipes,pipeTokenLocations,i,numChildren); 
-               execv(args[0],args);
-        }
-
-        
-
-       
- 
-      //errExit("exec problem");
-      printf("folowwing error happned : %s\n",strerror(errno));
-      exit(EXIT_FAILURE);
-
-
-      }
-    }
-
-
-  }
-
-
-
-  //parent closes it own descriptors
-  for(int i=0;i<numChildren-1;i++){
-    close(pfd[i][0]);
-    close(pfd[i][1]);
-  }
-
-  for(int i=0;i<numChildren;i++){
-    wait( NULL);
-  }
-
-  return 0;
-
-
-}
-
-int booleanOperationsHandler(struct tokens * tokens,int booleanOperationQuantity,int * booleanOperationLocations){
-  bool currentBooleanValue = true;
-  char args[1024];
-  memset(args,0,1024);
-  int currentBooleanIndex = 0;
-
-
-  for(int i=0;i<tokens_get_length(tokens);i++){
-    if(strcmp(tokens_get_token(tokens,i),"&&") == 0 || strcmp(tokens_get_token(tokens,i),"||") == 0 || i == tokens_get_length(tokens)-1){
-  
-      
-      if(i == tokens_get_length(tokens) -1 ){
-            strcat(args,tokens_get_token(tokens,i));
-      }
-
-      if(currentBooleanIndex == 0){
-
-             struct tokens *argsToken = tokenize(args);
-             int status = runMyProgram(argsToken);
-             if(status == 0){
-               currentBooleanValue = true;
-             }else {
-     
-               currentBooleanValue = false;
-             }
-
-             tokens_destroy(argsToken);
-             
-           
-
-      }else if((strcmp(tokens_get_token(tokens,booleanOperationLocations[currentBooleanIndex-1]),"&&") == 0 && currentBooleanValue == true) ||
-             (strcmp(tokens_get_token(tokens,booleanOperationLocations[currentBooleanIndex-1]), "||") == 0 && currentBooleanValue == false)    ){
-               struct tokens *argsToken = tokenize(args);
-         
-               int status =  runMyProgram(argsToken);
-               if(status == 0){
-                 currentBooleanValue = true;
-               }else{
-                 currentBooleanValue = false;
-               }
-
-               tokens_destroy(argsToken);
-             
-              
-
-             }
-               currentBooleanIndex++;
-               memset(args,0,1024); //clean up args for next one
-    }else{
-      strcat(args,tokens_get_token(tokens,i));
-      strcat(args," ");
-    }
-  }
-
-
-  return 0;
-  
-}
-
-void progrExeWrapper(struct tokens *tokens) {
-	  int booleanOperationQuantity = 0;
-	  int booleanOperationLocations[tokens_get_length(tokens)];
-
-	  for(int i=0;i<tokens_get_length(tokens);i++){
-	    if(strcmp(tokens_get_token(tokens,i),"&&" ) == 0 || strcmp(tokens_get_token(tokens,i),"||" ) == 0){
-	      booleanOperationLocations[booleanOperationQuantity] = i;
-	   
-	      booleanOperationQuantity++;
-	    }
-	  }
-
-	  if(booleanOperationQuantity > 0){
-	    booleanOperationsHandler(tokens,booleanOperationQuantity,booleanOperationLocations);
-	
-	}else{
-
-
-
-	  int quantityOfPipes = 0;
-	  int pipeTokenLocations[tokens_get_length(tokens)];
-	  for(int i=0;i<tokens_get_length(tokens);i++){
-	
-	    if(strcmp(tokens_get_token(tokens,i),"|") == 0){
-	      
-	      pipeTokenLocations[quantityOfPipes] = i;
-	      quantityOfPipes++;
-	    }
-
-	  }
-	
-	
-	  if(quantityOfPipes > 0){
-	    makePipes(tokens,pipeTokenLocations,quantityOfPipes);
-
-	  
-
-	 } else{
-
-
-
-	  if(tokens_get_length(tokens) != 0){
-
-	     runMyProgram(tokens);
-	  }
-
-	  }
-	 }
-}
-
-
-void shellExe(char *line) {
-    /* Split our line into words. */
-    struct tokens *tokens = tokenize(line);
-
-    /* Find which built-in function to run. */
-    int fundex = lookup(tokens_get_token(tokens, 0));
-
-
-
-    if (fundex >= 0) {
-      cmd_table[fundex].fun(tokens);
-    } else {
-    	progrExeWrapper(tokens);
-    }
-    
-
-
-
-    /* Clean up memory */
-    tokens_destroy(tokens);
-}
-
-/* Runs shell with passed arguments */
-void runFromBash(int argc, char *commands) {
-  for (char *token = strtok(commands,";"); token != NULL; token = strtok(NULL, ";")) {
-    shellExe(token);
-  }
-}
-
-
-int main(unused int argc, unused char *argv[]) {
-  init_shell();
-
-  static char line[4096];
-  int line_num = 0;
-
-  if (argc >= 3 && strcmp(argv[1], "-c") == 0) {
-    //printf("%s\n", argv[2]);
-    runFromBash(argc, argv[2]);
-  } else {
-
-    /* Please only print shell prompts when standard input is not a tty */
-    if (shell_is_interactive)
-      fprintf(stdout, "%d: ", line_num);
-  
-    while (fgets(line, 4096, stdin)) {
-      shellExe(line);
-  
-      if (shell_is_interactive)
-        /* Please only print shell prompts when standard input is not a tty */
-        fprintf(stdout, "%d: ", ++line_num);   
-    }
-  }
-  return 0;
-}
+#define _GNU_SOURCE
+#include <ctype.h>
+#include <errno.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <signal.h>
+#include <sys/wait.h>
+#include <termios.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <dlfcn.h>
+#include "tokenizer.h"
+#include "shell.h"
+#include "spawn.h"
+#include "cgroup.h"
+#include "history.h"
+#include "lineedit.h"
+#include "vars.h"
+#include "expand.h"
+#include "cmdsub.h"
+#include "heredoc.h"
+#include "redir.h"
+#include "glob.h"
+#include "bytecode.h"
+#include "func.h"
+#include "arith.h"
+#include "input.h"
+#include "test.h"
+#include "output.h"
+#include "stats.h"
+#include "alloc.h"
+
+
+/* Convenience macro to silence compiler warnings about unused function parameters. */
+#define unused __attribute__((unused))
+
+/* Whether the shell is connected to an actual terminal or not. */
+bool shell_is_interactive;
+bool shell_exec_in_place;
+
+/* File descriptor for the shell input */
+int shell_terminal;
+
+/* Terminal mode settings for the shell */
+struct termios shell_tmodes;
+
+/* Process group id for the shell */
+pid_t shell_pgid;
+
+int shell_last_status;
+
+int cmd_exit(struct tokens *tokens);
+int cmd_help(struct tokens *tokens);
+int cmd_pwd(struct tokens * tokens);
+int cmd_cd(struct tokens *tokens);
+int cmd_ulimit(struct tokens * tokens);
+int cmd_nice(struct tokens * tokens);
+int cmd_type(struct tokens * tokens);
+int cmd_kill(struct tokens * tokens);
+int cmd_enable(struct tokens * tokens);
+int cmd_sched(struct tokens * tokens);
+int cmd_exec(struct tokens * tokens);
+int cmd_true(struct tokens * tokens);
+int cmd_false(struct tokens * tokens);
+
+fun_desc_t cmd_table[] = {
+  {cmd_help, "?", "show this help menu"},
+  {cmd_exit, "exit", "exit the command shell"},
+  {cmd_true, "true", "do nothing, successfully"},
+  {cmd_true, ":", "do nothing, successfully"},
+  {cmd_false, "false", "do nothing, unsuccessfully"},
+  {cmd_pwd,"pwd","prints working directory"},
+  {cmd_cd,"cd","change directory"},
+  {cmd_ulimit,"ulimit","prints or changes current limit"},
+  {cmd_nice,"nice","prints or changes niceness, nice -n N cmd runs cmd with it raised"},
+  {cmd_stats, "stats", "stats [-n N] [-j] [-r]: the commands this session spent its time on"},
+  {cmd_alloc, "alloc", "alloc [-t]: allocations and live bytes per source file (ALLOC_ACCOUNTING=1 builds)"},
+  {cmd_history, "history", "history [-v] [N]: recent commands, history -s TEXT: search newest first"},
+  {cmd_export, "export", "export NAME[=value]...: put variables in the environment of commands"},
+  {cmd_readonly, "readonly", "readonly NAME[=value]...: make variables unchangeable"},
+  {cmd_unset, "unset", "unset NAME...: remove variables"},
+  {cmd_local, "local", "local NAME[=value]...: variables of the running function only"},
+  {cmd_return, "return", "return [N]: leave the running function with status N"},
+  {cmd_echo, "echo", "echo [-neE] [arg...]: print the arguments"},
+  {cmd_printf, "printf", "printf format [arg...]: print the arguments as format says"},
+  {cmd_test, "test", "test EXPR, [ EXPR ]: file tests, string and integer comparisons"},
+  {cmd_test, "[", "test EXPR, [ EXPR ]: file tests, string and integer comparisons"},
+  {cmd_read, "read", "read [-r] [-d delim] [-u fd] [name...]: read a line into variables"},
+  {cmd_mapfile, "mapfile", "mapfile [-t] [-d delim] [-n N] [-s N] [-u fd] [name]: read lines into an array"},
+  {cmd_shopt, "shopt", "shopt [-s|-u] [nullglob|failglob|dotglob]: set or show shell options"},
+  {cmd_sched, "sched", "run a command with --cpus LIST --policy batch|idle --ioprio CLASS --nice N"},
+  {cmd_type,"type","prints whether command is buili-in function or other program"},
+  {cmd_kill, "kill", "send a signal to a process"},
+  {cmd_exec, "exec", "exec cmd: replace the shell with cmd, exec 3>>file: keep redirections open"},
+  {cmd_enable, "enable", "enable -f lib.so name: load a builtin, -d name: unload it"},
+  {cmd_cgexec, "cgexec", "run a command in its own cgroup: --memory SIZE --cpu PCT --io-weight N -- cmd"}
+};
+
+/* Every builtin, static or loaded with enable -f, lives in this hash table. */
+#define BUILTIN_BUCKETS 64
+
+typedef struct builtin {
+  fun_desc_t desc;
+  void *handle; /* dlopen() handle for loaded builtins, NULL for cmd_table ones */
+  struct builtin *next;
+} builtin_t;
+
+static builtin_t *builtin_buckets[BUILTIN_BUCKETS];
+
+static unsigned int builtin_hash(const char *cmd) {
+  unsigned int h = 2166136261u;
+  for (; *cmd; cmd++)
+    h = (h ^ (unsigned char) *cmd) * 16777619u;
+  return h % BUILTIN_BUCKETS;
+}
+
+static builtin_t **builtin_slot(const char *cmd) {
+  builtin_t **slot = &builtin_buckets[builtin_hash(cmd)];
+  while (*slot && strcmp((*slot)->desc.cmd, cmd) != 0)
+    slot = &(*slot)->next;
+  return slot;
+}
+
+/* Adds or replaces a builtin; a replaced loaded builtin drops its library reference. */
+static void builtin_register(cmd_fun_t *fun, const char *cmd, const char *doc, void *handle) {
+  builtin_t **slot = builtin_slot(cmd);
+  builtin_t *b = *slot;
+  if (b == NULL) {
+    b = calloc(1, sizeof(builtin_t));
+    b->desc.cmd = strdup(cmd);
+    *slot = b;
+  } else if (b->handle) {
+    dlclose(b->handle);
+  }
+  free(b->desc.doc);
+  b->desc.fun = fun;
+  b->desc.doc = strdup(doc);
+  b->handle = handle;
+}
+
+void builtins_each(void (*fn)(const char *name, void *ctx), void *ctx) {
+  for (unsigned int i = 0; i < BUILTIN_BUCKETS; i++)
+    for (builtin_t *b = builtin_buckets[i]; b; b = b->next)
+      fn(b->desc.cmd, ctx);
+}
+
+/* Registers the compiled-in builtins. */
+void init_builtins() {
+  for (unsigned int i = 0; i < sizeof(cmd_table) / sizeof(fun_desc_t); i++)
+    builtin_register(cmd_table[i].fun, cmd_table[i].cmd, cmd_table[i].doc, NULL);
+}
+
+/* The cmd_table entry for cmd, which a loaded builtin may be shadowing; NULL if none. */
+static const fun_desc_t *static_builtin(const char *cmd) {
+  for (unsigned int i = 0; i < sizeof(cmd_table) / sizeof(fun_desc_t); i++)
+    if (strcmp(cmd_table[i].cmd, cmd) == 0)
+      return &cmd_table[i];
+  return NULL;
+}
+
+fun_desc_t *lookup(char cmd[]) {
+  if (cmd == NULL)
+    return NULL;
+  builtin_t *b = *builtin_slot(cmd);
+  return b ? &b->desc : NULL;
+}
+
+/* One row per resource ulimit knows: its flag, the resource, the unit values are
+ * printed and given in, and the label used by ulimit -a. */
+typedef struct limit_desc {
+  char flag;
+  int resource;
+  rlim_t scale;
+  char *name;
+  char *unit;
+} limit_desc_t;
+
+static const limit_desc_t limit_table[] = {
+  {'c', RLIMIT_CORE, 1024, "core file size", "blocks"},
+  {'d', RLIMIT_DATA, 1024, "data seg size", "kbytes"},
+  {'e', RLIMIT_NICE, 1, "scheduling priority", NULL},
+  {'f', RLIMIT_FSIZE, 1024, "file size", "blocks"},
+  {'i', RLIMIT_SIGPENDING, 1, "pending signals", NULL},
+  {'l', RLIMIT_MEMLOCK, 1024, "max locked memory", "kbytes"},
+  {'m', RLIMIT_RSS, 1024, "max memory size", "kbytes"},
+  {'n', RLIMIT_NOFILE, 1, "open files", NULL},
+  {'q', RLIMIT_MSGQUEUE, 1, "POSIX message queues", "bytes"},
+  {'r', RLIMIT_RTPRIO, 1, "real-time priority", NULL},
+  {'s', RLIMIT_STACK, 1024, "stack size", "kbytes"},
+  {'t', RLIMIT_CPU, 1, "cpu time", "seconds"},
+  {'u', RLIMIT_NPROC, 1, "max user processes", NULL},
+  {'v', RLIMIT_AS, 1024, "virtual memory", "kbytes"},
+  {'x', RLIMIT_LOCKS, 1, "file locks", NULL},
+};
+
+#define LIMIT_COUNT (sizeof(limit_table) / sizeof(limit_desc_t))
+
+static const limit_desc_t *limit_find(char flag) {
+  for (unsigned int i = 0; i < LIMIT_COUNT; i++)
+    if (limit_table[i].flag == flag)
+      return &limit_table[i];
+  return NULL;
+}
+
+/* Parses a limit value in the resource's unit. "unlimited", "soft" and "hard" are
+ * understood, and a K/M/G/T suffix gives the raw amount (bytes for sizes), so
+ * "-v 4G" means four gigabytes. Returns -1 on malformed input. */
+static int limit_parse(const limit_desc_t *desc, const char *value, const struct rlimit *cur,
+    rlim_t *out) {
+  if (strcmp(value, "unlimited") == 0 || strcmp(value, "infinity") == 0) {
+    *out = RLIM_INFINITY;
+    return 0;
+  } else if (strcmp(value, "soft") == 0) {
+    *out = cur->rlim_cur;
+    return 0;
+  } else if (strcmp(value, "hard") == 0) {
+    *out = cur->rlim_max;
+    return 0;
+  }
+
+  char *end;
+  errno = 0;
+  unsigned long long n = strtoull(value, &end, 10);
+  if (errno != 0 || end == value || value[0] == '-')
+    return -1;
+
+  rlim_t mult = desc->scale;
+  if (*end != '\0') {
+    const char *suffixes = "kmgt";
+    const char *p = strchr(suffixes, tolower((unsigned char) *end));
+    if (p == NULL || end[1] != '\0')
+      return -1;
+    mult = 1;
+    for (const char *q = suffixes; q <= p; q++)
+      mult *= 1024;
+  }
+  if (n > (RLIM_INFINITY - 1) / mult)
+    return -1;
+  *out = n * mult;
+  return 0;
+}
+
+static void limit_print(const limit_desc_t *desc, rlim_t value, bool labelled) {
+  if (labelled) {
+    char label[32];
+    if (desc->unit)
+      snprintf(label, sizeof(label), "(%s, -%c)", desc->unit, desc->flag);
+    else
+      snprintf(label, sizeof(label), "(-%c)", desc->flag);
+    printf("%-24s%16s ", desc->name, label);
+  }
+  if (value == RLIM_INFINITY)
+    printf("unlimited\n");
+  else
+    printf("%llu\n", (unsigned long long) (value / desc->scale));
+}
+
+/* ulimit [-SH] [-p PID] [-a] [-flag [value]]... [-- command...]
+ *
+ * Prints or sets the limits named by the flags in limit_table, several per call. -S picks
+ * the soft limit (the default), -H the hard one, both together set both. -p reads or
+ * changes the limits of another running process with prlimit(). After "--" the new
+ * limits apply only to the command that follows instead of the shell. */
+int cmd_ulimit(struct tokens * tokens) {
+  size_t len = tokens_get_length(tokens);
+  bool soft = false, hard = false, all = false;
+  pid_t pid = 0;
+  size_t cmdstart = 0;
+
+  /* Each requested resource, with the value to set or NULL to print it. */
+  const limit_desc_t *descs[len + LIMIT_COUNT];
+  char *values[len + LIMIT_COUNT];
+  size_t nreq = 0;
+
+  for (size_t i = 1; i < len; i++) {
+    char *tok = tokens_get_token(tokens, i);
+    if (strcmp(tok, "--") == 0) {
+      cmdstart = i + 1;
+      break;
+    }
+    if (tok[0] != '-' || tok[1] == '\0') {
+      /* A bare value sets the file size limit, like "ulimit 1024". */
+      if (nreq > 0) {
+        fprintf(stderr, "ulimit: %s: unexpected argument\n", tok);
+        return 1;
+      }
+      descs[nreq] = limit_find('f');
+      values[nreq++] = tok;
+      continue;
+    }
+    bool takes_value = false;
+    for (char *c = tok + 1; *c; c++) {
+      const limit_desc_t *desc;
+      if (*c == 'S') {
+        soft = true;
+      } else if (*c == 'H') {
+        hard = true;
+      } else if (*c == 'a') {
+        all = true;
+      } else if (*c == 'p') {
+        char *arg = tokens_get_token(tokens, ++i);
+        char *end;
+        if (arg == NULL || (pid = strtol(arg, &end, 10)) <= 0 || *end != '\0') {
+          fprintf(stderr, "ulimit: -p: process id expected\n");
+          return 1;
+        }
+        takes_value = false;
+      } else if ((desc = limit_find(*c)) != NULL) {
+        descs[nreq] = desc;
+        values[nreq++] = NULL;
+        takes_value = true;
+      } else {
+        fprintf(stderr, "ulimit: -%c: invalid option\n", *c);
+        return 1;
+      }
+    }
+    /* A value after the flags belongs to the last resource named. */
+    char *next = tokens_get_token(tokens, i + 1);
+    if (takes_value && next != NULL && next[0] != '-')
+      values[nreq - 1] = tokens_get_token(tokens, ++i);
+  }
+
+  if (all) {
+    for (unsigned int i = 0; i < LIMIT_COUNT; i++) {
+      descs[nreq] = &limit_table[i];
+      values[nreq++] = NULL;
+    }
+  } else if (nreq == 0) {
+    descs[nreq] = limit_find('f');
+    values[nreq++] = NULL;
+  }
+  if (!soft && !hard)
+    soft = true;
+
+  bool prefixed = cmdstart > 0;
+  if (prefixed && (pid != 0 || cmdstart >= len)) {
+    fprintf(stderr, "ulimit: -- needs a command and can't be combined with -p\n");
+    return 1;
+  }
+
+  struct spawn_attrs attrs;
+  spawn_attrs_init(&attrs, spawn_pending);
+  int status = 0;
+  size_t nprint = 0;
+  for (size_t i = 0; i < nreq; i++)
+    nprint += values[i] == NULL;
+
+  for (size_t i = 0; i < nreq; i++) {
+    const limit_desc_t *desc = descs[i];
+    struct rlimit cur;
+    if (prlimit(pid, desc->resource, NULL, &cur) == -1) {
+      fprintf(stderr, "ulimit: %s: %s\n", desc->name, strerror(errno));
+      return 1;
+    }
+
+    if (values[i] == NULL) {
+      if (prefixed) {
+        fprintf(stderr, "ulimit: -%c: value expected before --\n", desc->flag);
+        return 1;
+      }
+      limit_print(desc, soft && !hard ? cur.rlim_cur : cur.rlim_max, nprint > 1);
+      continue;
+    }
+
+    rlim_t value;
+    if (limit_parse(desc, values[i], &cur, &value) == -1) {
+      fprintf(stderr, "ulimit: %s: invalid number\n", values[i]);
+      return 1;
+    }
+    struct rlimit next = cur;
+    if (soft)
+      next.rlim_cur = value;
+    if (hard)
+      next.rlim_max = value;
+
+    if (prefixed) {
+      spawn_attrs_limit(&attrs, desc->resource, &next);
+    } else if (prlimit(pid, desc->resource, &next, NULL) == -1) {
+      fprintf(stderr, "ulimit: %s: cannot modify limit: %s\n", desc->name, strerror(errno));
+      status = 1;
+    }
+  }
+
+  if (prefixed) {
+    /* A lowered hard limit could not be raised back, so it only ever reaches a child. */
+    struct tokens *cmd = tokens_slice(tokens, cmdstart, tokens_get_length(tokens));
+    status = spawn_run(cmd, &attrs);
+    tokens_destroy(cmd);
+  }
+  return status;
+}
+/* nice [N] prints or sets the shell's niceness. nice [-n N] command... launches command
+ * with its niceness raised by N (10 by default), set in the child before exec. */
+int cmd_nice(unused struct tokens * tokens) {
+	size_t len = tokens_get_length(tokens);
+	if(len == 1) {
+		errno = 0;
+		int prio = getpriority(PRIO_PROCESS,0);
+		if(prio == -1 && errno != 0) {
+			 printf("folowwing error happned : %s\n",strerror(errno));
+			 return -1;
+		}
+		printf("%d\n",prio);
+		return 0;
+	}
+	char *first = tokens_get_token(tokens,(size_t)1);
+	char *end;
+	long value = strtol(first,&end,10);
+	if(len == 2 && *end == '\0') {
+		int status = setpriority(PRIO_PROCESS,0,(int)value);
+		if(status == -1) {
+			printf("folowwing error happned : %s\n",strerror(errno));
+			return -1;
+		}
+		return 0;
+	}
+
+	struct spawn_attrs attrs;
+	spawn_attrs_init(&attrs, spawn_pending);
+	size_t cmdstart = 1;
+	int increment = 10;
+	if(strcmp(first,"-n") == 0) {
+		char *arg = tokens_get_token(tokens,(size_t)2);
+		if(arg == NULL || (increment = strtol(arg,&end,10), *end != '\0') || len < 4) {
+			fprintf(stderr, "usage: nice [-n N] command...\n");
+			return 1;
+		}
+		cmdstart = 3;
+	}
+	attrs.nice = (attrs.has_nice ? attrs.nice : 0) + increment;
+	attrs.has_nice = true;
+
+	struct tokens *cmd = tokens_slice(tokens, cmdstart, len);
+	int status = spawn_run(cmd, &attrs);
+	tokens_destroy(cmd);
+	return status;
+}
+
+/* Parses a CPU list such as "0-7,9,12-15". */
+static int parse_cpu_list(const char *list, cpu_set_t *set) {
+  CPU_ZERO(set);
+  const char *p = list;
+  while (*p) {
+    char *end;
+    long lo = strtol(p, &end, 10), hi = lo;
+    if (end == p || lo < 0)
+      return -1;
+    if (*end == '-') {
+      p = end + 1;
+      hi = strtol(p, &end, 10);
+      if (end == p || hi < lo)
+        return -1;
+    }
+    if (hi >= CPU_SETSIZE)
+      return -1;
+    for (long cpu = lo; cpu <= hi; cpu++)
+      CPU_SET(cpu, set);
+    if (*end == ',')
+      end++;
+    else if (*end != '\0')
+      return -1;
+    p = end;
+  }
+  return CPU_COUNT(set) > 0 ? 0 : -1;
+}
+
+/* Parses an I/O priority "idle", "be[:LEVEL]" or "rt[:LEVEL]" into an ioprio_set() value. */
+static int parse_ioprio(const char *value) {
+  static const char *classes[] = {"none", "rt", "be", "idle"};
+  for (int class = 1; class < 4; class++) {
+    size_t n = strlen(classes[class]);
+    if (strncmp(value, classes[class], n) != 0 || (value[n] != '\0' && value[n] != ':'))
+      continue;
+    int level = class == 3 ? 0 : 4;
+    if (value[n] == ':') {
+      char *end;
+      level = strtol(value + n + 1, &end, 10);
+      if (*end != '\0' || level < 0 || level > 7)
+        return -1;
+    }
+    return class << 13 | level;
+  }
+  return -1;
+}
+
+/* sched [--cpus LIST] [--policy P] [--prio N] [--ioprio CLASS[:LEVEL]] [--nice N] [--] cmd...
+ * Launches cmd with the given CPU affinity, scheduling policy (other, batch, idle, fifo,
+ * rr), I/O priority and niceness, all set in the child between fork and exec. */
+int cmd_sched(struct tokens *tokens) {
+  static const struct { char *name; int policy; } policies[] = {
+    {"other", SCHED_OTHER}, {"batch", SCHED_BATCH}, {"idle", SCHED_IDLE},
+    {"fifo", SCHED_FIFO}, {"rr", SCHED_RR},
+  };
+  size_t len = tokens_get_length(tokens);
+  struct spawn_attrs attrs;
+  spawn_attrs_init(&attrs, spawn_pending);
+
+  size_t i = 1;
+  for (; i < len; i++) {
+    char *opt = tokens_get_token(tokens, i);
+    if (strcmp(opt, "--") == 0) {
+      i++;
+      break;
+    }
+    if (strncmp(opt, "--", 2) != 0)
+      break;
+    char *value = tokens_get_token(tokens, ++i);
+    if (value == NULL) {
+      fprintf(stderr, "sched: %s: value expected\n", opt);
+      return 1;
+    }
+    char *end;
+    if (strcmp(opt, "--cpus") == 0) {
+      if (parse_cpu_list(value, &attrs.cpus) == -1) {
+        fprintf(stderr, "sched: %s: invalid cpu list\n", value);
+        return 1;
+      }
+      attrs.has_cpus = true;
+    } else if (strcmp(opt, "--policy") == 0) {
+      unsigned int p = 0;
+      while (p < sizeof(policies) / sizeof(policies[0]) && strcmp(policies[p].name, value) != 0)
+        p++;
+      if (p == sizeof(policies) / sizeof(policies[0])) {
+        fprintf(stderr, "sched: %s: unknown policy\n", value);
+        return 1;
+      }
+      attrs.policy = policies[p].policy;
+    } else if (strcmp(opt, "--prio") == 0) {
+      attrs.rtprio = strtol(value, &end, 10);
+      if (*end != '\0') {
+        fprintf(stderr, "sched: %s: invalid priority\n", value);
+        return 1;
+      }
+    } else if (strcmp(opt, "--ioprio") == 0) {
+      if ((attrs.ioprio = parse_ioprio(value)) == -1) {
+        fprintf(stderr, "sched: %s: invalid io priority\n", value);
+        return 1;
+      }
+    } else if (strcmp(opt, "--nice") == 0) {
+      int increment = strtol(value, &end, 10);
+      if (*end != '\0') {
+        fprintf(stderr, "sched: %s: invalid niceness\n", value);
+        return 1;
+      }
+      attrs.nice = (attrs.has_nice ? attrs.nice : 0) + increment;
+      attrs.has_nice = true;
+    } else {
+      fprintf(stderr, "sched: %s: invalid option\n", opt);
+      return 1;
+    }
+  }
+  if ((attrs.policy == SCHED_FIFO || attrs.policy == SCHED_RR) && attrs.rtprio == 0)
+    attrs.rtprio = 1;
+  if (i >= len) {
+    fprintf(stderr, "usage: sched [--cpus LIST] [--policy P] [--prio N] [--ioprio CLASS[:LEVEL]] [--nice N] [--] command...\n");
+    return 1;
+  }
+
+  struct tokens *cmd = tokens_slice(tokens, i, len);
+  int status = spawn_run(cmd, &attrs);
+  tokens_destroy(cmd);
+  return status;
+}
+
+
+void handleIoCommand(struct tokens *tokens) {
+
+}
+
+
+
+
+/* cd [dir]: to dir, or to $HOME without one. */
+int cmd_cd(struct tokens *tokens){
+  const char *path = tokens_get_length(tokens) > 1 ? tokens_get_token(tokens, 1) : vars_get("HOME");
+  if (path == NULL) {
+    fprintf(stderr, "cd: HOME not set\n");
+    return 1;
+  }
+  if (chdir(path) == -1) {
+    fprintf(stderr, "cd: %s: %s\n", path, strerror(errno));
+    return 1;
+  }
+  return 0;
+}
+
+/*prints working directory */
+int cmd_pwd(unused struct tokens *tokens){
+  char *cwd = getcwd(NULL, 0);
+  if (cwd == NULL) {
+    fprintf(stderr, "pwd: %s\n", strerror(errno));
+    return 1;
+  }
+  printf("%s\n", cwd);
+  free(cwd);
+  return 0;
+}
+
+int isBg(struct tokens *tokens) {
+  if (tokens_is_op(tokens, tokens_get_length(tokens)-1, "&")) return 1;
+  return 0;
+}
+
+
+
+
+/* executes given program,if absolutePath variable is empty that means we already have absolute paht in tokens[0],
+if it's not empty then absolute path will be in absolutePath variable
+
+ */
+int progrExe(struct tokens *tokens,char * absolutePath) {
+
+  int isBgProcess = isBg(tokens);
+  pid_t pid;
+  /* The child's end of execPipe closes when it execs, which is when the parent's read()
+   * of it returns: that is how long exec took. */
+  int execPipe[2] = {-1, -1};
+  uint64_t started = stats_clock(), spawned;
+
+  /* A subshell running its last command becomes it instead of forking once more; a
+   * cgroup has to be entered by a new child (and cgexec reports on it afterwards). */
+  if (shell_exec_in_place && (spawn_pending == NULL || spawn_pending->cgroup_fd < 0)) {
+    out_flush();
+    pid = 0;
+  }
+  else {
+    if (pipe2(execPipe, O_CLOEXEC) == -1)
+      execPipe[0] = execPipe[1] = -1;
+    pid = spawn_fork();
+  }
+  spawned = stats_clock();
+
+  if (pid < 0) {
+    fprintf(stderr, "Fork Failed");
+    if (execPipe[0] != -1) {
+      close(execPipe[0]);
+      close(execPipe[1]);
+    }
+    return 1;
+
+  } else if (pid == 0) {
+    if (execPipe[0] != -1)
+      close(execPipe[0]);
+
+    /* Only an interactive shell has jobs; a script's or a subshell's programs stay in
+     * its process group, which is the one holding the terminal. */
+    if (shell_is_interactive && setpgid(0, 0) == -1) {
+      perror(NULL);
+    }
+    if (spawn_apply(spawn_pending) == -1) {
+      _exit(EXIT_FAILURE);
+    }
+
+    size_t nArgs = tokens_get_length(tokens);
+
+    if (isBgProcess) {
+      nArgs = nArgs-1; // this means the last token is '&' symbol and is not a program argument
+    }
+
+    char *arr[nArgs+1];
+
+    if(absolutePath == NULL){
+      arr[0] = tokens_get_token(tokens,0);
+    }else{
+ 
+      arr[0] = absolutePath;
+    }
+
+
+    // fill arguments for program to be execute
+    for (size_t i = 1; i < nArgs; ++i) {
+      arr[i] = tokens_get_token(tokens, i);
+    }
+
+    arr[nArgs] = NULL;
+
+    if (redir_pending != NULL && redir_apply(redir_pending) == -1) {
+      _exit(EXIT_FAILURE);
+    }
+    cmdsub_process_inherit();
+
+    execve(arr[0], arr, spawn_envp());
+
+    //it comes to this line if only execv failed.In this case terminate child process with failure
+    fprintf(stderr, "%s: %s\n", arr[0], strerror(errno));
+    _exit(errno == ENOENT ? 127 : 126);
+
+   
+
+  } else {
+      signal(SIGTTOU, SIG_IGN); // ignore
+      
+    if (shell_is_interactive && setpgid(pid, pid) == -1 && errno != EACCES) {
+      perror(NULL);
+    }
+    if (!isBgProcess && shell_is_interactive) {
+      tcsetpgrp(0, pid);
+    }
+
+    uint64_t execed = 0;
+    if (execPipe[0] != -1) {
+      char c;
+      close(execPipe[1]);
+      while (read(execPipe[0], &c, 1) == -1 && errno == EINTR)
+        ;
+      execed = stats_clock();
+      close(execPipe[0]);
+    }
+
+    int status = 0;
+    struct rusage usage;
+    if (wait4(pid, &status, WSTOPPED, &usage) == pid) {
+      stats_program(absolutePath ? absolutePath : tokens_get_token(tokens, 0), started,
+          spawned, execed, &usage);
+    }
+   
+    if (!isBgProcess && shell_is_interactive) {
+      tcsetpgrp(0, getpid());
+    }
+    if (WIFSIGNALED(status)) {
+      return 128 + WTERMSIG(status);
+    }
+    return WEXITSTATUS(status); //on success returns 0,on error return 1
+
+  }
+
+  return 0;
+}
+
+
+// kill builtin
+int cmd_kill(struct tokens * tokens) {
+
+	int size = tokens_get_length(tokens);
+
+	if (size > 2) {
+		int sigNUM = -atoi(tokens_get_token(tokens, 1));
+		int pid = atoi(tokens_get_token(tokens, 2));
+
+		if (sigNUM > 0 && sigNUM < 65) {
+			return kill(pid, sigNUM);
+		} else {
+			printf("invalid signal specification\n");
+		}
+	}
+
+  return -1;
+}
+
+/* Prints a helpful description for the given command */
+int cmd_help(unused struct tokens *tokens) {
+  /* Compiled-in names as whatever answers to them now, then the loaded ones that
+   * shadow none of them. */
+  for (unsigned int i = 0; i < sizeof(cmd_table) / sizeof(fun_desc_t); i++) {
+    fun_desc_t *desc = lookup(cmd_table[i].cmd);
+    printf("%s - %s\n", desc->cmd, desc->doc);
+  }
+  for (unsigned int i = 0; i < BUILTIN_BUCKETS; i++)
+    for (builtin_t *b = builtin_buckets[i]; b; b = b->next)
+      if (b->handle && static_builtin(b->desc.cmd) == NULL)
+        printf("%s - %s\n", b->desc.cmd, b->desc.doc);
+  return 0;
+}
+
+/* enable -f lib.so name...: loads builtins from a shared object. Each name must be an
+ * exported function with the cmd_fun_t signature; an optional "const char name_doc[]"
+ * supplies the help text. enable -d name... removes loaded builtins, bringing back a
+ * compiled-in one of the same name; enable alone lists the loaded ones. */
+int cmd_enable(struct tokens *tokens) {
+  size_t len = tokens_get_length(tokens);
+
+  if (len == 1) {
+    for (unsigned int i = 0; i < BUILTIN_BUCKETS; i++)
+      for (builtin_t *b = builtin_buckets[i]; b; b = b->next)
+        if (b->handle) {
+          Dl_info info;
+          const char *lib = dladdr((void *) b->desc.fun, &info) ? info.dli_fname : "?";
+          printf("enable -f %s %s\n", lib, b->desc.cmd);
+        }
+    return 0;
+  }
+
+  char *flag = tokens_get_token(tokens, 1);
+  if (strcmp(flag, "-d") == 0) {
+    int status = 0;
+    for (size_t i = 2; i < len; i++) {
+      char *cmd = tokens_get_token(tokens, i);
+      builtin_t **slot = builtin_slot(cmd);
+      if (*slot == NULL || (*slot)->handle == NULL) {
+        printf("enable: %s: not a dynamically loaded builtin\n", cmd);
+        status = 1;
+        continue;
+      }
+      /* A compiled-in builtin it shadowed comes back. */
+      const fun_desc_t *shadowed = static_builtin(cmd);
+      if (shadowed != NULL) {
+        builtin_register(shadowed->fun, shadowed->cmd, shadowed->doc, NULL);
+        continue;
+      }
+      builtin_t *b = *slot;
+      *slot = b->next;
+      dlclose(b->handle);
+      free(b->desc.cmd);
+      free(b->desc.doc);
+      free(b);
+    }
+    return status;
+  }
+
+  if (strcmp(flag, "-f") != 0 || len < 4) {
+    printf("usage: enable [-f lib.so name...] [-d name...]\n");
+    return 1;
+  }
+
+  char *lib = tokens_get_token(tokens, 2);
+  int status = 0;
+  for (size_t i = 3; i < len; i++) {
+    char *cmd = tokens_get_token(tokens, i);
+    /* Every registered name holds its own reference, so -d can unload names one by one. */
+    void *handle = dlopen(lib, RTLD_NOW | RTLD_LOCAL);
+    if (handle == NULL) {
+      printf("enable: %s\n", dlerror());
+      return 1;
+    }
+    cmd_fun_t *fun = (cmd_fun_t *) dlsym(handle, cmd);
+    if (fun == NULL) {
+      printf("enable: %s: no such function in %s\n", cmd, lib);
+      dlclose(handle);
+      status = 1;
+      continue;
+    }
+    char docsym[strlen(cmd) + sizeof("_doc")];
+    sprintf(docsym, "%s_doc", cmd);
+    const char *doc = (const char *) dlsym(handle, docsym);
+    builtin_register(fun, cmd, doc ? doc : lib, handle);
+  }
+  return status;
+}
+
+/* Exits this shell */
+/* exit [n]: n, or the status of the last command, as sh has it; ( exit 3 ) is how a
+ * subshell reports one. Only the output is flushed: exit() would also seek a script on
+ * stdin back to where its FILE had read, under the feet of the shell a subshell was
+ * forked from. */
+int cmd_exit(struct tokens *tokens) {
+  int status = shell_last_status;
+  if (tokens_get_length(tokens) > 1) {
+    char *end;
+    const char *arg = tokens_get_token(tokens, 1);
+    status = (int) strtol(arg, &end, 10);
+    if (*arg == '\0' || *end != '\0') {
+      fprintf(stderr, "exit: %s: numeric argument required\n", arg);
+      status = 2;
+    }
+  }
+  out_flush();
+  _exit(status & 0xff);
+}
+
+int cmd_true(unused struct tokens *tokens) {
+  return 0;
+}
+
+int cmd_false(unused struct tokens *tokens) {
+  return 1;
+}
+
+
+
+/* Intialization procedures for this shell */
+void init_shell() {
+  /* Our shell is connected to standard input. */
+  shell_terminal = STDIN_FILENO;
+
+  /* Check if we are running interactively */
+  shell_is_interactive = isatty(shell_terminal);
+
+  if (shell_is_interactive) {
+    /* If the shell is not currently in the foreground, we must pause the shell until it becomes a
+     * foreground process. We use SIGTTIN to pause the shell. When the shell gets moved to the
+     * foreground, we'll receive a SIGCONT. */
+    while (tcgetpgrp(shell_terminal) != (shell_pgid = getpgrp()))
+      kill(-shell_pgid, SIGTTIN);
+
+    /* Saves the shell's process id */
+    shell_pgid = getpid();
+
+    /* Take control of the terminal */
+    tcsetpgrp(shell_terminal, shell_pgid);
+
+    /* Save the current termios to a variable, so it can be restored later. */
+    tcgetattr(shell_terminal, &shell_tmodes);
+  }
+}
+
+char * searchInPath(char * program){
+  const char * pathVariable = vars_get("PATH");
+  if (pathVariable == NULL) {
+    return NULL;
+  }
+  char * copyPath = strdup(pathVariable);
+
+  
+
+ 
+  for (char *token = strtok(copyPath,":"); token != NULL; token = strtok(NULL, ":"))
+  {
+    DIR *d;
+    struct dirent *dir;
+ 
+    d = opendir(token);
+    if (d) {
+     while ((dir = readdir(d)) != NULL) {
+       if(strcmp(dir->d_name,program) == 0){
+         char * copy = malloc(strlen(token) + strlen(program) +2); //keep absolute path to program
+         strcpy(copy,token);
+         strcat(copy,"/");
+         strcat(copy,program);
+         
+
+         closedir(d);
+         free(copyPath); //free copy of env variable 
+         return copy;
+       }
+
+     }
+    closedir(d);
+  }
+
+
+  }
+  free(copyPath); //free copy of env variable 
+  return NULL;
+}
+/* exec cmd [args...] replaces the shell with cmd. Without a command it does nothing
+ * itself: exeRedirected() has already applied its redirections for good. */
+int cmd_exec(struct tokens *tokens) {
+  size_t len = tokens_get_length(tokens);
+  if (len < 2) {
+    return 0;
+  }
+  char *name = tokens_get_token(tokens, 1);
+  char *path = strchr(name, '/') != NULL ? strdup(name) : searchInPath(name);
+  if (path == NULL) {
+    fprintf(stderr, "%s: command not found\n", name);
+    return 127;
+  }
+  char *args[len];
+  args[0] = path;
+  for (size_t i = 2; i < len; i++) {
+    args[i - 1] = tokens_get_token(tokens, i);
+  }
+  args[len - 1] = NULL;
+  out_flush();
+  cmdsub_process_inherit();
+  execve(path, args, spawn_envp());
+  fprintf(stderr, "%s: %s\n", path, strerror(errno));
+  free(path);
+  return errno == ENOENT ? 127 : 126;
+}
+
+int cmd_type(unused struct tokens * tokens) {
+	if(tokens_get_length(tokens) == 2) {
+		char * cmd = tokens_get_token(tokens,(size_t)1);
+		if(func_lookup(cmd) != NULL) {
+			printf("%s is a function\n",cmd);
+			return 0;
+		}
+		if(lookup(cmd) != NULL) {
+			printf("%s is a shell builtin\n",cmd);
+			return 0;
+		}
+		char * path = searchInPath(cmd);
+		if(path != NULL) {
+			printf("%s\n",path);
+			free(path);
+			return 0;
+		}
+		if(strcmp(cmd,"!") == 0  || strcmp(cmd,"[[") == 0 || strcmp(cmd,"]]") == 0 || strcmp(cmd,"{") == 0 || strcmp(cmd,"}") == 0 || strcmp(cmd,"case") == 0
+			|| strcmp(cmd,"do") == 0 || strcmp(cmd,"done") == 0 || strcmp(cmd,"fi") == 0 || strcmp(cmd,"for") == 0 || strcmp(cmd,"function") == 0 
+			|| strcmp(cmd,"while") == 0 || strcmp(cmd,"until") == 0 || strcmp(cmd,"select") == 0) {
+			printf("%s is a thell keyword \n",cmd);
+			return 0;
+		}
+		printf("-bash: type : %s : not found \n",cmd);
+		return 1; 
+	} 
+	if(strcmp(tokens_get_token(tokens,(size_t)1),"-a") == 0) {
+		char * cmd = tokens_get_token(tokens,(size_t)2);
+		if(lookup(cmd) != NULL) {
+			printf("%s is a shell builtin\n",cmd);
+		}
+		char * path = searchInPath(cmd);
+		if(path != NULL) {
+			printf("%s\n",path);
+			free(path);
+		}
+		return -1;
+	}
+	if(strcmp(tokens_get_token(tokens,(size_t)1),"-p") == 0) {
+		char * cmd = tokens_get_token(tokens,(size_t)2);
+		char * path = searchInPath(cmd);
+		if(path != NULL) {
+			printf("%s\n",path);
+			free(path);
+		}
+		return -1;
+	}
+
+	return 0;
+}
+
+//calls progrExe with the program's path: tokens[0] itself if it has a '/' in it, otherwise found in PATH
+int runMyProgram(struct  tokens * tokens){
+  char *name = tokens_get_token(tokens, 0);
+  if (strchr(name, '/') != NULL) {
+    return progrExe(tokens, NULL);
+  }
+
+  char * commandPath = searchInPath(name);
+  if (commandPath == NULL) {
+    fprintf(stderr, "%s: command not found\n", name);
+    return 127;
+  }
+  int status = progrExe(tokens, commandPath);
+  free(commandPath); //deallocation of path
+  return status;
+}
+
+
+
+
+/* Runs pipeline stage childIndex in its child: execs its program, or runs it right here
+ * and exits if it is a compound stage, a function or a builtin. Never returns. */
+void execStage(struct  tokens * tokens,int quantityOfPipes , int * pipeTokenLocations ,int childIndex,int numChildren,
+    struct program ** stages){
+     int start;
+     int end;
+     
+        if(childIndex == 0){
+          start = 0;
+          end = pipeTokenLocations[0];
+        }else {
+          start = pipeTokenLocations[childIndex-1]+1;  
+          if(childIndex == quantityOfPipes ){
+            end = tokens_get_length(tokens);
+          }else {
+            end = pipeTokenLocations[childIndex];
+          }
+        }
+        /* The stage's own redirections go on top of its pipe ends (cmd 2>&1 | less). */
+        cmdsub_process_inherit();
+
+        /* A compound stage runs its compiled body right here, redirections and all. */
+        if (stages != NULL && stages[childIndex] != NULL) {
+          shell_is_interactive = false;
+          int status = bytecode_run(stages[childIndex]);
+          out_flush();
+          _exit(status & 0xff);
+        }
+        struct tokens *stage = tokens_slice(tokens, start, end);
+        struct redir_plan plan;
+        if (redir_plan(stage, &plan) == -1 || redir_apply(&plan) == -1) {
+          _exit(EXIT_FAILURE);
+        }
+        start = 0;
+        end = tokens_get_length(plan.args);
+
+        /* A function or builtin runs right here in the stage's child. */
+        struct function *function = end > 0 ? func_lookup(tokens_get_token(plan.args, 0)) : NULL;
+        fun_desc_t *builtin = end > 0 && function == NULL ? lookup(tokens_get_token(plan.args, 0)) : NULL;
+        if (function != NULL || builtin != NULL) {
+          int status = function ? func_call(function, plan.args) : builtin->fun(plan.args);
+          out_flush();
+          _exit(status < 0 ? 1 : status & 0xff);
+        }
+
+        if (end == 0) {
+          _exit(0); /* only redirections */
+        }
+        char *name = tokens_get_token(plan.args, start);
+        char *path = strchr(name, '/') != NULL ? strdup(name) : searchInPath(name);
+        if (path == NULL) {
+          fprintf(stderr, "%s: command not found\n", name);
+          _exit(127);
+        }
+        char *args[end - start + 1];
+        args[0] = path;
+        for (int index = start + 1; index < end; index++) {
+          args[index - start] = tokens_get_token(plan.args, index);
+        }
+        args[end - start] = NULL;
+        execve(path, args, spawn_envp());
+        fprintf(stderr, "%s: %s\n", path, strerror(errno));
+        free(path);
+        _exit(errno == ENOENT ? 127 : 126);
+}
+
+
+int makePipes(struct tokens * tokens,int * pipeTokenLocations,int quantityOfPipes,struct program ** stages){
+  int pfd[quantityOfPipes][2];
+  int numChildren = quantityOfPipes +1;
+
+   for (int i=0; i<quantityOfPipes; i++)
+    {
+        if (pipe(pfd[i]) == -1)
+        {
+             printf("folowwing error happned : %s\n",strerror(errno));
+             return -1;
+        }
+    }
+
+  pid_t lastPid = -1;
+  pid_t pids[numChildren];
+  uint64_t started = stats_clock(), spawned[numChildren];
+  for(int i=0;i<numChildren;i++){
+    pid_t pid = spawn_fork();
+    spawned[i] = stats_clock();
+    pids[i] = pid;
+    if (i == numChildren - 1) {
+      lastPid = pid; // the pipeline's status is the last program's
+    }
+
+    if(pid < 0 ){
+       printf("folowwing error happned : %s\n",strerror(errno));
+      exit(EXIT_FAILURE);
+    }else if(pid == 0){
+
+          if (spawn_apply(spawn_pending) == -1) {
+            _exit(EXIT_FAILURE);
+          }
+       
+          //bind my stdin to previous pipe
+         if(i>0 && i<numChildren-1 ){
+           if(pfd[i-1][0] !=STDIN_FILENO){
+              if(dup2(pfd[i-1][0],STDIN_FILENO) == -1){
+                //errExit("dup2 ");
+                    printf("error with dup : %s\n",strerror(errno));
+                    _exit(EXIT_FAILURE);
+              }
+              if(close(pfd[i-1][0]) == -1){
+                //errExit("close desc"); 
+                  printf("error with close: %s\n",strerror(errno));
+                  _exit(EXIT_FAILURE);
+
+              }
+
+
+
+           }
+           //close my copy of previous pipe's writing
+            close(pfd[i-1][1]);
+
+            //bind my output to next pipe
+             if(pfd[i][1] !=STDOUT_FILENO){
+                if(dup2(pfd[i][1],STDOUT_FILENO) == -1){
+                  //errExit("dup2 1");
+                      _exit(EXIT_FAILURE);
+                }
+                if(close(pfd[i][1]) == -1){
+                  //errExit("close 2"); 
+                      _exit(EXIT_FAILURE);
+
+                }
+
+            }
+            //close my copy of next pipe's reading
+            close(pfd[i][0]);
+                 //close my copy of other descriptors
+          for (int j = 0; j < numChildren-1; j++) {
+            if (j != i && j != i - 1)  {
+              close(pfd[j][0]);
+              close(pfd[j][1]);
+              }
+         }
+          execStage(tokens,quantityOfPipes,pipeTokenLocations,i,numChildren,stages);
+
+        }else   if(i == 0){
+          
+               //close my copy of reading 
+            if(close(pfd[i][0]) == -1){
+              _exit(EXIT_FAILURE);
+            }
+             //bind my output to next pipe
+             if(pfd[i][1] !=STDOUT_FILENO){
+                if(dup2(pfd[i][1],STDOUT_FILENO) == -1){
+                  //errExit("dup2 1");
+                      _exit(EXIT_FAILURE);
+                }
+                if(close(pfd[i][1]) == -1){
+                  //errExit("close 2"); 
+                      _exit(EXIT_FAILURE);
+
+                }
+
+            }
+           
+             for (int j = 0; j < numChildren-1; j++) {
+              if (j != i)  {
+                close(pfd[j][0]);
+                close(pfd[j][1]);
+                }
+             }
+
+            execStage(tokens,quantityOfPipes,pipeTokenLocations,i,numChildren,stages);
+
+        }else {
+
+            //close my copy of writing
+
+             if(close(pfd[i-1][1]) == -1){
+               _exit(EXIT_FAILURE);
+             }
+             if(pfd[i-1][0] !=STDIN_FILENO){
+              if(dup2(pfd[i-1][0],STDIN_FILENO) == -1){
+                //errExit("dup2 ");
+                    printf("error with dup : %s\n",strerror(errno));
+                    _exit(EXIT_FAILURE);
+              }
+              if(close(pfd[i-1][0]) == -1){
+                //errExit("close desc"); 
+                  printf("error with close: %s\n",strerror(errno));
+                  _exit(EXIT_FAILURE);
+
+              }
+           
+            for (int j = 0; j < numChildren-1; j++) {
+              if (j != i-1  )  {
+                close(pfd[j][0]);
+                close(pfd[j][1]);
+                }
+             }
+
+               execStage(tokens,quantityOfPipes,pipeTokenLocations,i,numChildren,stages);
+        }
+
+        
+
+       
+ 
+      //errExit("exec problem");
+      printf("folowwing error happned : %s\n",strerror(errno));
+      _exit(EXIT_FAILURE);
+
+
+      }
+    }
+
+
+  }
+
+
+
+  //parent closes it own descriptors
+  for(int i=0;i<numChildren-1;i++){
+    close(pfd[i][0]);
+    close(pfd[i][1]);
+  }
+
+  int status = 0, lastStatus = 0;
+  for(int i=0;i<numChildren;i++){
+    struct rusage usage;
+    if (wait4(pids[i], &status, 0, &usage) != pids[i]) {
+      continue;
+    }
+    if (pids[i] == lastPid) {
+      lastStatus = status;
+    }
+    /* A stage is kept under its first word; a compound one isn't kept. */
+    int first = i == 0 ? 0 : pipeTokenLocations[i-1]+1;
+    if ((stages == NULL || stages[i] == NULL) && first < (int) tokens_get_length(tokens) &&
+        !tokens_is_op(tokens, first, "|")) {
+      stats_program(tokens_get_token(tokens, first), i == 0 ? started : spawned[i-1], spawned[i], 0, &usage);
+    }
+  }
+
+  if (WIFSIGNALED(lastStatus)) {
+    return 128 + WTERMSIG(lastStatus);
+  }
+  return WEXITSTATUS(lastStatus);
+
+
+}
+
+/* Runs the parts of a list joined by && and || left to right, each through exeTokens;
+ * a part is skipped when the operator before it and the status so far say so. */
+int booleanOperationsHandler(struct tokens * tokens,int booleanOperationQuantity,int * booleanOperationLocations){
+  int status = 0;
+  size_t start = 0;
+
+  for (int i = 0; i <= booleanOperationQuantity; i++) {
+    size_t end = i < booleanOperationQuantity ? (size_t) booleanOperationLocations[i] : tokens_get_length(tokens);
+    bool run = i == 0 ||
+      (tokens_is_op(tokens, booleanOperationLocations[i-1], "&&") ? status == 0 : status != 0);
+    if (run) {
+      struct tokens *part = tokens_slice(tokens, start, end);
+      status = exeTokens(part);
+      tokens_destroy(part);
+    }
+    start = end + 1;
+  }
+
+  return status;
+}
+
+int progrExeWrapper(struct tokens *tokens) {
+	  int quantityOfPipes = 0;
+	  int pipeTokenLocations[tokens_get_length(tokens)];
+	  for(int i=0;i<tokens_get_length(tokens);i++){
+	
+	    if(tokens_is_op(tokens,i,"|")){
+	      
+	      pipeTokenLocations[quantityOfPipes] = i;
+	      quantityOfPipes++;
+	    }
+
+	  }
+	
+	
+	  if(quantityOfPipes > 0){
+	    return makePipes(tokens,pipeTokenLocations,quantityOfPipes,NULL);
+	  }
+
+	  if(tokens_get_length(tokens) != 0){
+	     return runMyProgram(tokens);
+	  }
+	  return 0;
+}
+
+
+/* Runs a command line that starts with NAME=value words. Alone they set shell variables;
+ * in front of a command they only go into that command's environment (or, for a builtin,
+ * are set while it runs and put back afterwards). */
+int exeAssignments(struct tokens *tokens, size_t nassign) {
+    size_t len = tokens_get_length(tokens);
+    if (nassign == len) {
+      int status = 0;
+      for (size_t i = 0; i < nassign; i++) {
+        char *word = tokens_get_token(tokens, i);
+        size_t name_len;
+        vars_is_assignment(word, &name_len);
+        char *name = strndup(word, name_len);
+        if (vars_set(name, word + name_len + 1, 0) == -1) {
+          fprintf(stderr, "%s: readonly variable\n", name);
+          status = 1;
+        }
+        free(name);
+      }
+      return status;
+    }
+
+    struct tokens *cmd = tokens_slice(tokens, nassign, len);
+    int status;
+    if (lookup(tokens_get_token(cmd, 0)) != NULL || func_lookup(tokens_get_token(cmd, 0)) != NULL) {
+      char *names[nassign], *saved[nassign];
+      for (size_t i = 0; i < nassign; i++) {
+        char *word = tokens_get_token(tokens, i);
+        size_t name_len;
+        vars_is_assignment(word, &name_len);
+        names[i] = strndup(word, name_len);
+        const char *old = vars_get(names[i]);
+        saved[i] = old ? strdup(old) : NULL;
+        vars_set(names[i], word + name_len + 1, 0);
+      }
+      status = exeTokens(cmd);
+      for (size_t i = nassign; i > 0; i--) {
+        if (saved[i - 1])
+          vars_set(names[i - 1], saved[i - 1], 0);
+        else
+          vars_unset(names[i - 1]);
+        free(saved[i - 1]);
+        free(names[i - 1]);
+      }
+    } else {
+      struct spawn_attrs attrs;
+      spawn_attrs_init(&attrs, spawn_pending);
+      char *assigns[attrs.nassigns + nassign];
+      memcpy(assigns, attrs.assigns, attrs.nassigns * sizeof(char *));
+      for (size_t i = 0; i < nassign; i++)
+        assigns[attrs.nassigns + i] = tokens_get_token(tokens, i);
+      attrs.assigns = assigns;
+      attrs.nassigns += nassign;
+      status = spawn_run(cmd, &attrs);
+    }
+    tokens_destroy(cmd);
+    return status;
+}
+
+/* Runs one expanded command: assignments, a builtin, or programs joined by pipes. */
+static int exeRedirected(struct tokens *tokens);
+
+static int exeCommand(struct tokens *tokens) {
+    bool piped = false;
+    for (size_t i = 0; i < tokens_get_length(tokens) && !piped; i++)
+      piped = tokens_is_op(tokens, i, "|");
+
+    /* Pipeline stages apply their own redirections in makePipes(). */
+    if (!piped && redir_any(tokens)) {
+      return exeRedirected(tokens);
+    }
+
+    size_t nassign = 0;
+    while (nassign < tokens_get_length(tokens) &&
+        vars_is_assignment(tokens_get_raw(tokens, nassign), NULL))
+      nassign++;
+    if (nassign > 0) {
+      return exeAssignments(tokens, nassign);
+    }
+
+    /* Functions come before builtins of the same name. */
+    struct function *function = piped ? NULL : func_lookup(tokens_get_token(tokens, 0));
+    if (function != NULL) {
+      return func_call(function, tokens);
+    }
+
+    /* Find which built-in function to run; in a pipeline it runs in the stage's child. */
+    fun_desc_t *builtin = piped ? NULL : lookup(tokens_get_token(tokens, 0));
+
+    if (builtin != NULL) {
+      uint64_t started = stats_clock();
+      int status = builtin->fun(tokens);
+      stats_builtin(builtin->cmd, started);
+      return status < 0 ? 1 : status;
+    }
+    return progrExeWrapper(tokens);
+}
+
+/* A command with redirections, which are planned once. An external command gets them in
+ * its child; builtins and assignments get them in the shell while they run, except exec,
+ * which keeps them. */
+static int exeRedirected(struct tokens *tokens) {
+    struct redir_plan plan;
+    if (redir_plan(tokens, &plan) == -1) {
+      return 1;
+    }
+    struct tokens *args = plan.args;
+    size_t len = tokens_get_length(args);
+    fun_desc_t *builtin = len ? lookup(tokens_get_token(args, 0)) : NULL;
+
+    int status;
+    if (builtin != NULL && builtin->fun == cmd_exec) {
+      out_flush();
+      status = redir_apply(&plan) == -1 ? 1 : cmd_exec(args);
+    } else if (builtin == NULL && len > 0 && !vars_is_assignment(tokens_get_raw(args, 0), NULL) &&
+        func_lookup(tokens_get_token(args, 0)) == NULL) {
+      redir_pending = &plan;
+      status = progrExeWrapper(args);
+      redir_pending = NULL;
+    } else {
+      struct redir_saved saved;
+      status = redir_apply_saved(&plan, &saved) == -1 ? 1 : len ? exeCommand(args) : 0;
+      redir_restore(&saved);
+    }
+    redir_plan_free(&plan);
+    return status;
+}
+
+static int runCompound(struct tokens *tokens, size_t n, bool arith) {
+    if (!arith) {
+      return test_command(tokens, 0, n);
+    }
+    char *text = arith_command_text(tokens, 0, n);
+    int status = arith_command(text, false);
+    free(text);
+    return status;
+}
+
+/* (( )) or [[ ]], the first n words of tokens, run in the shell under the redirections
+ * written after it. */
+static int exeCompound(struct tokens *tokens, size_t n, bool arith) {
+    size_t len = tokens_get_length(tokens);
+    if (n == len) {
+      return runCompound(tokens, n, arith);
+    }
+    size_t subs = cmdsub_process_mark();
+    struct tokens *rest = tokens_slice(tokens, n, len);
+    struct tokens *words = expand_words(rest);
+    struct redir_plan plan;
+    int status = 1;
+    if (words != NULL && redir_plan(words, &plan) == 0) {
+      if (tokens_get_length(plan.args) > 0) {
+        fprintf(stderr, "%s: unexpected word: %s\n", arith ? "((" : "[[", tokens_get_token(plan.args, 0));
+        status = 2;
+      } else {
+        struct redir_saved saved;
+        if (redir_apply_saved(&plan, &saved) == 0) {
+          status = runCompound(tokens, n, arith);
+        }
+        redir_restore(&saved);
+      }
+      redir_plan_free(&plan);
+    }
+    if (words != NULL && words != rest) {
+      tokens_destroy(words);
+    }
+    tokens_destroy(rest);
+    cmdsub_process_done(subs);
+    return status;
+}
+
+/* Runs one tokenized command line. Each part of an && / || list is expanded just before
+ * it runs, so $? in a || b is a's status. */
+int exeTokens(struct tokens *tokens) {
+    size_t len = tokens_get_length(tokens);
+    if (len == 0) {
+      return shell_last_status;
+    }
+
+    int booleanOperationQuantity = 0;
+    int booleanOperationLocations[len];
+    bool part_start = true;
+    for (size_t i = 0; i < len; i++) {
+      if (tokens_is_op(tokens, i, "&&") || tokens_is_op(tokens, i, "||")) {
+        booleanOperationLocations[booleanOperationQuantity++] = i;
+        part_start = true;
+        continue;
+      }
+      /* && inside (( )) is arithmetic, inside [[ ]] part of the test */
+      size_t inner = part_start ? arith_command_words(tokens, i) + test_command_words(tokens, i) : 0;
+      if (inner > 0)
+        i += inner - 1;
+      part_start = false;
+    }
+
+    size_t nassign = 0;
+    while (nassign < len && vars_is_assignment(tokens_get_raw(tokens, nassign), NULL))
+      nassign++;
+
+    int status;
+    size_t arith = arith_command_words(tokens, 0);
+    if (booleanOperationQuantity > 0) {
+      status = booleanOperationsHandler(tokens, booleanOperationQuantity, booleanOperationLocations);
+    } else if (arith > 0) {
+      status = exeCompound(tokens, arith, true);
+    } else if (test_command_words(tokens, 0) > 0) {
+      status = exeCompound(tokens, test_command_words(tokens, 0), false);
+    } else if (nassign == len && len > 1) {
+      /* A=1 B=$A: each assignment is expanded after the ones before it are made. */
+      status = 0;
+      for (size_t i = 0; i < len && status == 0; i++) {
+        struct tokens *one = tokens_slice(tokens, i, i + 1);
+        status = exeTokens(one);
+        tokens_destroy(one);
+      }
+    } else {
+      size_t subs = cmdsub_process_mark();
+      struct tokens *words = expand_words(tokens);
+      if (words == NULL) {
+        status = 1;
+      } else {
+        status = tokens_get_length(words) ? exeCommand(words) : 0;
+        /* X=$(cmd) alone has the status of cmd */
+        if (status == 0 && cmdsub_status >= 0 && nassign == len) {
+          status = cmdsub_status;
+        }
+        if (words != tokens) {
+          tokens_destroy(words);
+        }
+      }
+      cmdsub_process_done(subs);
+    }
+    shell_last_status = status;
+    return status;
+}
+
+/* The commands of a piece of input, handed out one at a time with the bodies of their
+ * here-documents attached. */
+struct source {
+  char *line;
+  size_t len, start;
+  size_t bodies; /* where the next here-document body starts, 0 before the first */
+};
+
+static struct tokens *nextCommand(void *ctx, int *sep) {
+    struct source *src = ctx;
+    char *line = src->line;
+    size_t start = src->start;
+    if (start > src->len) {
+      return NULL;
+    }
+    size_t end = tokens_command_end(line, start);
+    char separator = line[end];
+    line[end] = '\0';
+
+    /* Split our command into words. */
+    struct tokens *tokens = tokenize(line + start);
+    line[end] = separator;
+
+    /* Here-document bodies follow the line, after all of its commands. */
+    if (memmem(line + start, end - start, "<<", 2) != NULL) {
+      if (src->bodies == 0) {
+        src->bodies = end;
+        while (line[src->bodies] == ';')
+          src->bodies = tokens_command_end(line, src->bodies + 1);
+        src->bodies++;
+      }
+      struct tokens *attached = heredoc_attach(tokens, line, &src->bodies);
+      if (attached != tokens) {
+        tokens_destroy(tokens);
+        tokens = attached;
+      }
+    }
+
+    *sep = separator;
+    src->start = end + 1;
+    if (separator == ';' && line[end + 1] == ';') {
+      *sep = BYTECODE_DSEMI;
+      src->start++;
+    }
+    if (separator != ';' && src->bodies != 0) {
+      src->start = src->bodies;
+      src->bodies = 0;
+    }
+    return tokens;
+}
+
+int shellExe(char *line) {
+    int status = shell_last_status;
+    struct source src = {line, strlen(line), 0, 0};
+    struct tokens *tokens;
+    int sep;
+    while ((tokens = nextCommand(&src, &sep)) != NULL) {
+      if (bytecode_is_compound(tokens)) {
+        /* if, while, for and case take the commands up to their end along */
+        struct program *prog = bytecode_compile(tokens, sep, nextCommand, &src);
+        status = prog ? bytecode_run(prog) : (shell_last_status = 2);
+        bytecode_free(prog);
+        continue;
+      }
+      status = exeTokens(tokens);
+
+      /* Clean up memory */
+      tokens_destroy(tokens);
+    }
+    return status;
+}
+
+/* Runs one interactive line and records it in the shared history. */
+void shellExeRecorded(char *line) {
+    size_t len = strlen(line);
+    if (len > 0 && line[len - 1] == '\n')
+      line[len - 1] = '\0';
+    if (line[strspn(line, " \t")] == '\0')
+      return;
+
+    char cwd[4096];
+    if (getcwd(cwd, sizeof(cwd)) == NULL)
+      cwd[0] = '\0';
+    struct timespec start, end;
+    time_t started = time(NULL);
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    int status = shellExe(line);
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    long long us = (end.tv_sec - start.tv_sec) * 1000000LL + (end.tv_nsec - start.tv_nsec) / 1000;
+    history_add(line, started, cwd, status, us);
+}
+
+/* Runs shell with passed arguments */
+/* Reads input up to the end of the here-documents line opens and of the compound
+ * commands it starts (with a "> " prompt when interactive). Returns line itself if
+ * there is nothing more to read, a malloc()ed copy with the rest otherwise. */
+static char *readCommand(char *line) {
+  struct bytecode_nesting nesting = {0};
+  struct heredoc_reader reader;
+  bytecode_nesting_line(&nesting, line);
+  bool pending = heredoc_reader_start(&reader, line);
+  if (!pending && nesting.depth == 0) {
+    heredoc_reader_free(&reader);
+    return line;
+  }
+  size_t len = strlen(line), cap = 2 * len + 4096;
+  char *text = malloc(cap);
+  memcpy(text, line, len + 1);
+  char edited[4096], *script = NULL, *more;
+  size_t script_cap = 0;
+  while (pending || nesting.depth > 0) {
+    if (shell_is_interactive)
+      more = lineedit_read("> ", edited, sizeof(edited));
+    else
+      more = getline(&script, &script_cap, stdin) == -1 ? NULL : script;
+    if (more == NULL)
+      break;
+    size_t n = strlen(more);
+    if (pending) {
+      pending = heredoc_reader_line(&reader, more);
+    } else {
+      heredoc_reader_free(&reader);
+      bytecode_nesting_line(&nesting, more);
+      pending = heredoc_reader_start(&reader, more);
+    }
+    if (len + n + 1 > cap) {
+      cap = 2 * (len + n + 1);
+      text = realloc(text, cap);
+    }
+    memcpy(text + len, more, n);
+    len += n;
+  }
+  text[len] = '\0';
+  free(script);
+  heredoc_reader_free(&reader);
+  return text;
+}
+
+void runFromBash(int argc, char *commands) {
+  shellExe(commands);
+}
+
+
+int main(unused int argc, unused char *argv[]) {
+  out_init();
+  vars_init(environ);
+  expand_set_params(argv[0], 0, NULL);
+  init_shell();
+  init_builtins();
+
+  static char line[4096];
+  int line_num = 0;
+
+  if (argc >= 3 && strcmp(argv[1], "-c") == 0) {
+    /* shell -c 'commands' [name [args...]], as in sh: name is $0, args are $1... */
+    if (argc > 3)
+      expand_set_params(argv[3], argc - 4, argv + 4);
+    else
+      expand_set_params(argv[0], 0, NULL);
+    runFromBash(argc, argv[2]);
+  } else {
+
+    if (shell_is_interactive) {
+      /* Interactive lines go through the line editor and into the history. */
+      history_init();
+      lineedit_init(shell_terminal, &shell_tmodes);
+      char prompt[32];
+      for (;;) {
+        snprintf(prompt, sizeof(prompt), "%d: ", line_num++);
+        out_flush();
+        if (lineedit_read(prompt, line, sizeof(line)) == NULL)
+          break;
+        char *text = readCommand(line);
+        shellExeRecorded(text);
+        if (text != line)
+          free(text);
+      }
+    } else {
+      /* Lines of a script can be any length; getline() reads them whole. */
+      char *script_line = NULL;
+      size_t script_cap = 0;
+      while (getline(&script_line, &script_cap, stdin) != -1) {
+        char *text = readCommand(script_line);
+        shellExe(text);
+        out_flush();
+        if (text != script_line)
+          free(text);
+      }
+      free(script_line);
+    }
+  }
+  return shell_last_status;
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include <stdbool.h>
+#include "tokenizer.h"
+
+/* Built-in command functions take token array (see tokenizer.h) and return int */
+typedef int cmd_fun_t(struct tokens *tokens);
+
+/* Built-in command struct and lookup table */
+typedef struct fun_desc {
+  cmd_fun_t *fun;
+  char *cmd;
+  char *doc;
+} fun_desc_t;
+
+/* Looks up the built-in command, if it exists. */
+fun_desc_t *lookup(char cmd[]);
+
+/* Whether the shell is connected to an actual terminal or not. */
+extern bool shell_is_interactive;
+/* Set in a subshell whose only remaining command is the one being run: progrExe() then
+ * execs it in place of the subshell. */
+extern bool shell_exec_in_place;
+
+/* Status of the last command, for $? */
+extern int shell_last_status;
+
+/* Runs one tokenized command line and returns its status. */
+int exeTokens(struct tokens *tokens);
+
+struct program;
+
+/* Runs the stages of tokens between the |s at pipeTokenLocations, each in a child of its
+ * own, and returns the last one's status. A stage whose stages entry isn't NULL runs
+ * that program instead of its words; stages may be NULL. */
+int makePipes(struct tokens *tokens, int *pipeTokenLocations, int quantityOfPipes,
+    struct program **stages);
+
+/* Runs an external command, found in PATH unless its name has a '/' in it. */
+int runMyProgram(struct tokens *tokens);
+
+/* Runs a line of commands separated by ';' or newlines; returns the last one's status. */
+int shellExe(char *line);
+
+/* Calls fn with the name of every builtin, static and loaded. */
+void builtins_each(void (*fn)(const char *name, void *ctx), void *ctx);
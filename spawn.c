@@ -0,0 +1,153 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <signal.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include "cmdsub.h"
+#include "func.h"
+#include "shell.h"
+#include "spawn.h"
+#include "output.h"
+#include "vars.h"
+#include "stats.h"
+
+struct spawn_attrs *spawn_pending;
+
+void spawn_attrs_init(struct spawn_attrs *attrs, const struct spawn_attrs *outer) {
+  if (outer) {
+    *attrs = *outer;
+  } else {
+    memset(attrs, 0, sizeof(*attrs));
+    attrs->cgroup_fd = -1;
+    attrs->policy = -1;
+    attrs->ioprio = -1;
+  }
+}
+
+void spawn_attrs_limit(struct spawn_attrs *attrs, int resource, const struct rlimit *limit) {
+  int i = 0;
+  while (i < attrs->nlimits && attrs->limits[i].resource != resource)
+    i++;
+  if (i == attrs->nlimits)
+    attrs->nlimits++;
+  attrs->limits[i].resource = resource;
+  attrs->limits[i].limit = *limit;
+}
+
+int spawn_join_cgroup(int cgroup_fd) {
+  int fd = openat(cgroup_fd, "cgroup.procs", O_WRONLY | O_CLOEXEC);
+  if (fd == -1)
+    return -1;
+  ssize_t n = write(fd, "0", 1);
+  int saved = errno;
+  close(fd);
+  errno = saved;
+  return n == 1 ? 0 : -1;
+}
+
+/* A plain fork(), so glibc's own fork handling runs and the child may use malloc and
+ * stdio before it execs. A raw clone3(CLONE_INTO_CGROUP) would skip that, so the child
+ * joins its cgroup itself, before it does anything else. */
+static pid_t fork_into_cgroup(const struct spawn_attrs *attrs) {
+  pid_t pid = fork();
+  if (pid == 0 && attrs != NULL && attrs->cgroup_fd >= 0 && spawn_join_cgroup(attrs->cgroup_fd) == -1)
+    fprintf(stderr, "cgexec: cannot join cgroup: %s\n", strerror(errno));
+  return pid;
+}
+
+pid_t spawn_fork(void) {
+  out_flush();
+  uint64_t started = stats_clock();
+  pid_t pid = fork_into_cgroup(spawn_pending);
+  if (pid > 0)
+    stats_fork(started);
+  return pid;
+}
+
+/* A builtin or function would run in the shell itself, out of reach of attrs, so it runs
+ * in a fork of the shell that takes them on first. Its own children inherit them from
+ * there; only the environment additions still go through spawn_pending. */
+static int spawn_run_forked(struct tokens *cmd, const struct spawn_attrs *attrs) {
+  pid_t pid = spawn_fork();
+  if (pid == -1) {
+    fprintf(stderr, "%s: fork: %s\n", tokens_get_token(cmd, 0), strerror(errno));
+    return 1;
+  }
+  if (pid == 0) {
+    cmdsub_process_inherit();
+    shell_is_interactive = false;
+    struct spawn_attrs env;
+    spawn_attrs_init(&env, NULL);
+    env.assigns = attrs->assigns;
+    env.nassigns = attrs->nassigns;
+    int status = 1;
+    if (spawn_apply(attrs) == 0) {
+      spawn_pending = &env;
+      status = exeTokens(cmd);
+    }
+    out_flush();
+    _exit(status & 0xff);
+  }
+  int wstatus;
+  while (waitpid(pid, &wstatus, 0) == -1 && errno == EINTR)
+    ;
+  return WIFSIGNALED(wstatus) ? 128 + WTERMSIG(wstatus) : WEXITSTATUS(wstatus);
+}
+
+int spawn_run(struct tokens *cmd, struct spawn_attrs *attrs) {
+  struct spawn_attrs *outer = spawn_pending;
+  spawn_pending = attrs;
+  char *name = tokens_get_token(cmd, 0);
+  int status;
+  if (name != NULL && (func_lookup(name) != NULL || lookup(name) != NULL))
+    status = spawn_run_forked(cmd, attrs);
+  else
+    status = exeTokens(cmd);
+  spawn_pending = outer;
+  return status;
+}
+
+char **spawn_envp(void) {
+  if (spawn_pending == NULL)
+    return vars_envp();
+  return vars_envp_with(spawn_pending->assigns, spawn_pending->nassigns);
+}
+
+int spawn_apply(const struct spawn_attrs *attrs) {
+  if (attrs == NULL)
+    return 0;
+  for (int i = 0; i < attrs->nlimits; i++) {
+    if (setrlimit(attrs->limits[i].resource, &attrs->limits[i].limit) == -1) {
+      fprintf(stderr, "ulimit: %s\n", strerror(errno));
+      return -1;
+    }
+  }
+  if (attrs->has_nice) {
+    errno = 0;
+    if (nice(attrs->nice) == -1 && errno != 0) {
+      fprintf(stderr, "nice: %s\n", strerror(errno));
+      return -1;
+    }
+  }
+  if (attrs->has_cpus && sched_setaffinity(0, sizeof(cpu_set_t), &attrs->cpus) == -1) {
+    fprintf(stderr, "sched: cpus: %s\n", strerror(errno));
+    return -1;
+  }
+  if (attrs->policy != -1) {
+    struct sched_param param = { .sched_priority = attrs->rtprio };
+    if (sched_setscheduler(0, attrs->policy, &param) == -1) {
+      fprintf(stderr, "sched: policy: %s\n", strerror(errno));
+      return -1;
+    }
+  }
+  /* glibc has no wrapper; 1 is IOPRIO_WHO_PROCESS. */
+  if (attrs->ioprio != -1 && syscall(SYS_ioprio_set, 1, 0, attrs->ioprio) == -1) {
+    fprintf(stderr, "sched: ioprio: %s\n", strerror(errno));
+    return -1;
+  }
+  return 0;
+}
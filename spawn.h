@@ -0,0 +1,54 @@
+#pragma once
+
+#include <sched.h>
+#include <stdbool.h>
+#include <sys/resource.h>
+#include <sys/types.h>
+#include "tokenizer.h"
+
+/* Process attributes for one command, applied in the child between fork and exec. */
+struct spawn_attrs {
+  int nlimits;
+  struct {
+    int resource;
+    struct rlimit limit;
+  } limits[RLIM_NLIMITS];
+  int cgroup_fd; /* cgroup v2 directory the child starts in, or -1 */
+  bool has_nice;
+  int nice; /* added to the niceness, like nice(1) */
+  bool has_cpus;
+  cpu_set_t cpus;
+  int policy; /* SCHED_* policy, or -1 to inherit */
+  int rtprio; /* priority for SCHED_FIFO / SCHED_RR */
+  int ioprio; /* ioprio_set() value, or -1 to inherit */
+  char **assigns; /* NAME=value pairs added to the child's environment (VAR=x cmd) */
+  size_t nassigns;
+};
+
+/* Attributes for the command the shell is about to launch, or NULL. Builtins that take
+ * a command as their tail (ulimit ... -- cmd) point this at their attrs while it runs. */
+extern struct spawn_attrs *spawn_pending;
+
+/* Starts attrs empty, or as a copy of outer so nested prefixes (cgexec -- ulimit -- cmd)
+ * add up instead of replacing each other. */
+void spawn_attrs_init(struct spawn_attrs *attrs, const struct spawn_attrs *outer);
+
+/* Sets the limit for resource, replacing an earlier one for the same resource. */
+void spawn_attrs_limit(struct spawn_attrs *attrs, int resource, const struct rlimit *limit);
+
+/* fork() that honours spawn_pending: the child moves itself into its cgroup first thing. */
+pid_t spawn_fork(void);
+
+/* Moves the calling process into the cgroup directory open at cgroup_fd. Returns -1 with
+ * errno set on failure, which only costs the containment. */
+int spawn_join_cgroup(int cgroup_fd);
+
+/* Runs cmd with attrs as spawn_pending and returns its status. A builtin or function
+ * runs in a fork of the shell, so attrs never change the shell itself. */
+int spawn_run(struct tokens *cmd, struct spawn_attrs *attrs);
+
+/* The environment to exec with: the exported variables plus spawn_pending's assigns. */
+char **spawn_envp(void);
+
+/* Applies attrs to the calling process. Returns -1 after printing the reason on failure. */
+int spawn_apply(const struct spawn_attrs *attrs);
@@ -0,0 +1,252 @@
+#define _GNU_SOURCE
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "stats.h"
+
+/* Bucket b of a histogram counts the runs that took [2^(b-1), 2^b) ticks, bucket 0 the
+ * ones under a tick, the last one everything longer (minutes, at GHz rates). */
+#define STATS_BUCKETS 40
+
+/* Times are in ticks of stats_clock(). */
+struct entry {
+  char *key;       /* NULL for a free slot */
+  uint32_t hash;
+  uint64_t runs, forked;
+  uint64_t wall;
+  uint64_t user_us, sys_us;
+  uint64_t spawn;
+  uint64_t exec, execs; /* over the runs exec was timed for */
+  uint32_t hist[STATS_BUCKETS];
+};
+
+/* Open addressing, a power of two long and at most 3/4 full. */
+static struct entry *table;
+static size_t cap, used;
+static uint64_t builtins, forks, fork_ticks;
+
+/* A tick count and the CLOCK_MONOTONIC time it was read at, to tell the tick rate by. */
+static uint64_t base_tick, base_ns;
+
+static uint64_t monotonic_ns(void) {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t) ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+#if !STATS_TSC
+uint64_t stats_clock(void) {
+  return monotonic_ns();
+}
+#endif
+
+/* Measured over everything since the first command, or over a millisecond spent here if
+ * that isn't long enough to tell. */
+static double ns_per_tick(void) {
+  if (!STATS_TSC)
+    return 1;
+  if (base_tick == 0 || monotonic_ns() - base_ns < 1000000) {
+    base_ns = monotonic_ns();
+    base_tick = stats_clock();
+    while (monotonic_ns() - base_ns < 1000000)
+      ;
+  }
+  uint64_t ns = monotonic_ns() - base_ns, ticks = stats_clock() - base_tick;
+  return ticks ? (double) ns / ticks : 1;
+}
+
+static uint32_t hash(const char *s) {
+  uint32_t h = 2166136261u;
+  for (; *s; s++)
+    h = (h ^ (unsigned char) *s) * 16777619u;
+  return h;
+}
+
+static void grow(void) {
+  struct entry *old = table;
+  size_t old_cap = cap;
+  cap = cap ? cap * 2 : 64;
+  table = calloc(cap, sizeof(struct entry));
+  for (size_t i = 0; i < old_cap; i++) {
+    if (old[i].key == NULL)
+      continue;
+    size_t k = old[i].hash & (cap - 1);
+    while (table[k].key != NULL)
+      k = (k + 1) & (cap - 1);
+    table[k] = old[i];
+  }
+  free(old);
+}
+
+static struct entry *find(const char *key) {
+  if ((used + 1) * 4 > cap * 3)
+    grow();
+  uint32_t h = hash(key);
+  for (size_t i = h & (cap - 1);; i = (i + 1) & (cap - 1)) {
+    struct entry *e = &table[i];
+    if (e->key == NULL) {
+      e->key = strdup(key);
+      e->hash = h;
+      used++;
+      return e;
+    }
+    if (e->hash == h && strcmp(e->key, key) == 0)
+      return e;
+  }
+}
+
+static void record(struct entry *e, uint64_t started, uint64_t now) {
+  uint64_t wall = now - started;
+  int bucket = wall == 0 ? 0 : 64 - __builtin_clzll(wall);
+  if (base_tick == 0) {
+    base_tick = now;
+    base_ns = monotonic_ns();
+  }
+  e->runs++;
+  e->wall += wall;
+  e->hist[bucket < STATS_BUCKETS ? bucket : STATS_BUCKETS - 1]++;
+}
+
+void stats_builtin(const char *name, uint64_t started) {
+  uint64_t now = stats_clock();
+  builtins++;
+  record(find(name), started, now);
+}
+
+void stats_program(const char *key, uint64_t started, uint64_t spawned, uint64_t execed,
+    const struct rusage *ru) {
+  uint64_t now = stats_clock();
+  struct entry *e = find(key);
+  record(e, started, now);
+  e->forked++;
+  e->user_us += ru->ru_utime.tv_sec * 1000000ULL + ru->ru_utime.tv_usec;
+  e->sys_us += ru->ru_stime.tv_sec * 1000000ULL + ru->ru_stime.tv_usec;
+  e->spawn += spawned - started;
+  if (execed != 0) {
+    e->exec += execed - spawned;
+    e->execs++;
+  }
+}
+
+void stats_fork(uint64_t started) {
+  forks++;
+  fork_ticks += stats_clock() - started;
+}
+
+static void reset(void) {
+  for (size_t i = 0; i < cap; i++)
+    free(table[i].key);
+  free(table);
+  table = NULL;
+  cap = used = 0;
+  builtins = forks = fork_ticks = 0;
+}
+
+static int by_wall(const void *a, const void *b) {
+  const struct entry *x = *(struct entry *const *) a, *y = *(struct entry *const *) b;
+  return x->wall < y->wall ? 1 : x->wall > y->wall ? -1 : strcmp(x->key, y->key);
+}
+
+/* The upper end, in microseconds, of the bucket the run at fraction q of them falls in. */
+static double quantile(const struct entry *e, double q, double ns) {
+  uint64_t rank = (uint64_t) (q * (e->runs - 1)), seen = 0;
+  int b = 0;
+  for (; b < STATS_BUCKETS - 1; b++) {
+    seen += e->hist[b];
+    if (seen > rank)
+      break;
+  }
+  return (double) (1ULL << b) * ns / 1e3;
+}
+
+static void put_json_string(const char *s) {
+  putchar('"');
+  for (; *s; s++) {
+    unsigned char c = *s;
+    if (c == '"' || c == '\\')
+      printf("\\%c", c);
+    else if (c < 0x20)
+      printf("\\u%04x", c);
+    else
+      putchar(c);
+  }
+  putchar('"');
+}
+
+/* Histograms come with where their buckets end, in microseconds. */
+static void print_json(struct entry **sorted, size_t n, double ns) {
+  printf("{\"builtins\":%llu,\"forks\":%llu,\"fork_ns\":%.0f,\"bucket_us\":[",
+      (unsigned long long) builtins, (unsigned long long) forks, fork_ticks * ns);
+  for (int b = 0; b < STATS_BUCKETS; b++)
+    printf("%s%.3f", b ? "," : "", (double) (1ULL << b) * ns / 1e3);
+  printf("],\"commands\":[");
+  for (size_t i = 0; i < n; i++) {
+    const struct entry *e = sorted[i];
+    printf("%s{\"command\":", i ? "," : "");
+    put_json_string(e->key);
+    printf(",\"runs\":%llu,\"forked\":%llu,\"wall_ns\":%.0f,\"user_us\":%llu,\"sys_us\":%llu,"
+        "\"spawn_ns\":%.0f,\"exec_ns\":%.0f,\"execs\":%llu,\"histogram\":[",
+        (unsigned long long) e->runs, (unsigned long long) e->forked, e->wall * ns,
+        (unsigned long long) e->user_us, (unsigned long long) e->sys_us, e->spawn * ns,
+        e->exec * ns, (unsigned long long) e->execs);
+    int last = STATS_BUCKETS - 1;
+    while (last > 0 && e->hist[last] == 0)
+      last--;
+    for (int b = 0; b <= last; b++)
+      printf("%s%u", b ? "," : "", e->hist[b]);
+    printf("]}");
+  }
+  printf("]}\n");
+}
+
+static void print_top(struct entry **sorted, size_t n, size_t top, double ns) {
+  printf("%8s %7s %10s %9s %9s %9s %9s %9s %8s %8s  %s\n", "runs", "forked", "total ms",
+      "mean us", "p50 us", "p99 us", "user ms", "sys ms", "fork us", "exec us", "command");
+  for (size_t i = 0; i < n && i < top; i++) {
+    const struct entry *e = sorted[i];
+    printf("%8llu %7llu %10.3f %9.1f %9.1f %9.1f %9.3f %9.3f %8.1f %8.1f  %s\n",
+        (unsigned long long) e->runs, (unsigned long long) e->forked, e->wall * ns / 1e6,
+        e->wall * ns / 1e3 / e->runs, quantile(e, 0.5, ns), quantile(e, 0.99, ns),
+        e->user_us / 1e3, e->sys_us / 1e3, e->forked ? e->spawn * ns / 1e3 / e->forked : 0.0,
+        e->execs ? e->exec * ns / 1e3 / e->execs : 0.0, e->key);
+  }
+  printf("%llu builtins run in the shell, %llu forks (%.1f us each)\n",
+      (unsigned long long) builtins, (unsigned long long) forks,
+      forks ? fork_ticks * ns / 1e3 / forks : 0.0);
+}
+
+int cmd_stats(struct tokens *tokens) {
+  size_t len = tokens_get_length(tokens), top = 10;
+  bool json = false;
+  for (size_t i = 1; i < len; i++) {
+    const char *opt = tokens_get_token(tokens, i);
+    char *end;
+    if (strcmp(opt, "-r") == 0) {
+      reset();
+      return 0;
+    } else if (strcmp(opt, "-j") == 0) {
+      json = true;
+    } else if (strcmp(opt, "-n") == 0 && i + 1 < len &&
+        (top = strtoul(tokens_get_token(tokens, ++i), &end, 10), *end == '\0')) {
+    } else {
+      fprintf(stderr, "usage: stats [-n N] [-j] [-r]\n");
+      return 2;
+    }
+  }
+
+  struct entry **sorted = malloc((used + 1) * sizeof(struct entry *));
+  size_t n = 0;
+  for (size_t i = 0; i < cap; i++)
+    if (table[i].key != NULL)
+      sorted[n++] = &table[i];
+  qsort(sorted, n, sizeof(struct entry *), by_wall);
+  double ns = ns_per_tick();
+  if (json)
+    print_json(sorted, n, ns);
+  else
+    print_top(sorted, n, top, ns);
+  free(sorted);
+  return 0;
+}
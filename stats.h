@@ -0,0 +1,41 @@
+#pragma once
+
+#include <stdint.h>
+#include <sys/resource.h>
+#include "tokenizer.h"
+
+/* What the commands of this session cost, kept in a table keyed by what each command
+ * resolved to: a builtin's name, a program's path. A builtin costs two clock reads and a
+ * table lookup; a program, its rusage from wait4() and how long fork() and exec took.
+ * Pipeline stages resolve their program in their own child and are kept under the name
+ * they were written with. */
+
+/* A timestamp for the functions below: TSC ticks on x86, where reading it costs a few
+ * nanoseconds, CLOCK_MONOTONIC nanoseconds elsewhere. Ticks become nanoseconds only
+ * when stats prints them. */
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define STATS_TSC 1
+static inline uint64_t stats_clock(void) {
+  return __rdtsc();
+}
+#else
+#define STATS_TSC 0
+uint64_t stats_clock(void);
+#endif
+
+/* A builtin that started at started has returned. */
+void stats_builtin(const char *name, uint64_t started);
+
+/* A program has been waited for: started is from before its fork, spawned from when
+ * fork() returned, execed from when it was seen to exec (0 if it wasn't watched), ru is
+ * what wait4() said it used. */
+void stats_program(const char *key, uint64_t started, uint64_t spawned, uint64_t execed,
+    const struct rusage *ru);
+
+/* spawn_fork() has forked a child; it started forking at started. */
+void stats_fork(uint64_t started);
+
+/* stats [-n N] [-j] [-r]: the N commands that took longest (10), everything as JSON, or
+ * all of it forgotten. */
+int cmd_stats(struct tokens *tokens);
@@ -0,0 +1,425 @@
+#define _GNU_SOURCE
+#include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <regex.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "arith.h"
+#include "expand.h"
+#include "glob.h"
+#include "test.h"
+#include "vars.h"
+
+/* The files an expression has looked at; a binary operator needs two at once. */
+#define STAT_CACHE 2
+
+struct stat_entry {
+  char *path;
+  bool link;  /* lstat(), for -L and -h */
+  int rc;
+  struct stat st;
+};
+
+struct cond {
+  const char *name;       /* test, [ or [[, for messages */
+  char **argv;            /* test's words, expanded already */
+  struct tokens *tokens;  /* [['s words as written */
+  size_t pos, end;
+  bool skip;              /* the side of && || not taken: nothing is expanded or looked at */
+  bool failed;
+  struct stat_entry cache[STAT_CACHE];
+  size_t next_entry;
+};
+
+static const char *const unary_ops[] = {
+  "-e", "-f", "-d", "-r", "-w", "-x", "-s", "-L", "-h", "-b", "-c", "-p", "-S", "-g", "-u",
+  "-k", "-O", "-G", "-t", "-z", "-n", "-v",
+};
+
+static const char *const binary_ops[] = {
+  "=", "==", "!=", "<", ">", "-eq", "-ne", "-lt", "-le", "-gt", "-ge", "-nt", "-ot", "-ef", "=~",
+};
+
+static void error(struct cond *c, const char *format, ...) {
+  if (c->failed)
+    return;
+  c->failed = true;
+  va_list ap;
+  va_start(ap, format);
+  fprintf(stderr, "%s: ", c->name);
+  vfprintf(stderr, format, ap);
+  fputc('\n', stderr);
+  va_end(ap);
+}
+
+/* Whether word pos + k is op; in [[ only unquoted words are operators. */
+static bool is_op(struct cond *c, size_t k, const char *op) {
+  size_t i = c->pos + k;
+  if (i >= c->end)
+    return false;
+  if (c->tokens)
+    return tokens_is_op(c->tokens, i, op);
+  return strcmp(c->argv[i], op) == 0;
+}
+
+static const char *unary_op(struct cond *c, size_t k) {
+  for (size_t i = 0; i < sizeof(unary_ops) / sizeof(unary_ops[0]); i++)
+    if (is_op(c, k, unary_ops[i]))
+      return unary_ops[i];
+  return NULL;
+}
+
+static const char *binary_op(struct cond *c, size_t k) {
+  for (size_t i = 0; i < sizeof(binary_ops) / sizeof(binary_ops[0]); i++)
+    if (is_op(c, k, binary_ops[i]) && (c->tokens || strcmp(binary_ops[i], "=~") != 0))
+      return binary_ops[i];
+  return NULL;
+}
+
+/* Word i as a string, malloc()ed: test's as it is, [['s expanded, "" when skipped. */
+static char *word(struct cond *c, size_t i) {
+  if (c->tokens == NULL)
+    return strdup(c->argv[i]);
+  if (c->skip)
+    return strdup("");
+  return expand_string(tokens_get_raw(c->tokens, i));
+}
+
+/* The stat (lstat with link) of path, looked up once per expression; NULL if it fails. */
+static const struct stat *file_stat(struct cond *c, const char *path, bool link) {
+  for (size_t i = 0; i < STAT_CACHE; i++) {
+    struct stat_entry *e = &c->cache[i];
+    if (e->path != NULL && e->link == link && strcmp(e->path, path) == 0)
+      return e->rc == 0 ? &e->st : NULL;
+  }
+  struct stat_entry *e = &c->cache[c->next_entry++ % STAT_CACHE];
+  free(e->path);
+  e->path = strdup(path);
+  e->link = link;
+  e->rc = link ? lstat(path, &e->st) : stat(path, &e->st);
+  return e->rc == 0 ? &e->st : NULL;
+}
+
+/* -r -w -x ask the kernel, as the effective ids: the mode bits alone miss ACLs,
+ * read-only mounts and capabilities. */
+static bool permitted(const char *path, int mode) {
+  return faccessat(AT_FDCWD, path, mode, AT_EACCESS) == 0;
+}
+
+static bool unary(struct cond *c, const char *op, const char *arg) {
+  switch (op[1]) {
+  case 'z':
+    return arg[0] == '\0';
+  case 'n':
+    return arg[0] != '\0';
+  case 't': {
+    char *end;
+    long fd = strtol(arg, &end, 10);
+    return arg[0] != '\0' && *end == '\0' && fd >= 0 && fd <= INT_MAX && isatty(fd);
+  }
+  case 'v':
+    return vars_get(arg) != NULL;
+  }
+  const struct stat *st = file_stat(c, arg, op[1] == 'L' || op[1] == 'h');
+  if (st == NULL)
+    return false;
+  switch (op[1]) {
+  case 'e': return true;
+  case 'f': return S_ISREG(st->st_mode);
+  case 'd': return S_ISDIR(st->st_mode);
+  case 'b': return S_ISBLK(st->st_mode);
+  case 'c': return S_ISCHR(st->st_mode);
+  case 'p': return S_ISFIFO(st->st_mode);
+  case 'S': return S_ISSOCK(st->st_mode);
+  case 'L':
+  case 'h': return S_ISLNK(st->st_mode);
+  case 's': return st->st_size > 0;
+  case 'r': return permitted(arg, R_OK);
+  case 'w': return permitted(arg, W_OK);
+  case 'x': return permitted(arg, X_OK);
+  case 'g': return st->st_mode & S_ISGID;
+  case 'u': return st->st_mode & S_ISUID;
+  case 'k': return st->st_mode & S_ISVTX;
+  case 'O': return st->st_uid == geteuid();
+  case 'G': return st->st_gid == getegid();
+  }
+  return false;
+}
+
+/* An operand of -eq and the like: a decimal integer for test, arithmetic for [[. */
+static bool integer(struct cond *c, const char *s, long long *n) {
+  if (c->tokens) {
+    if (arith_eval(s, n) == 0)
+      return true;
+    c->failed = true;
+    return false;
+  }
+  const char *p = s;
+  while (isspace((unsigned char) *p))
+    p++;
+  char *end;
+  errno = 0;
+  *n = strtoll(p, &end, 10);
+  bool digits = end > p && isdigit((unsigned char) end[-1]);
+  while (isspace((unsigned char) *end))
+    end++;
+  if (!digits || *end != '\0' || errno == ERANGE) {
+    error(c, "%s: integer expression expected", s);
+    return false;
+  }
+  return true;
+}
+
+/* [[ s =~ word ]], which also sets BASH_REMATCH to the match and its groups. */
+static bool regex_match(struct cond *c, const char *s, size_t r) {
+  char *re = expand_regex(tokens_get_raw(c->tokens, r));
+  regex_t rx;
+  int rc = regcomp(&rx, re, REG_EXTENDED);
+  if (rc != 0) {
+    char message[128];
+    regerror(rc, &rx, message, sizeof(message));
+    error(c, "%s: %s", re, message);
+    free(re);
+    return false;
+  }
+  size_t ngroups = rx.re_nsub + 1, set = 0;
+  regmatch_t groups[ngroups];
+  bool matched = regexec(&rx, s, ngroups, groups, 0) == 0;
+  for (; matched && set < ngroups; set++) {
+    regmatch_t *g = &groups[set];
+    char *text = g->rm_so == -1 ? strdup("") : strndup(s + g->rm_so, g->rm_eo - g->rm_so);
+    vars_array_set("BASH_REMATCH", set, text);
+    free(text);
+  }
+  vars_array_truncate("BASH_REMATCH", set);
+  regfree(&rx);
+  free(re);
+  return matched;
+}
+
+static bool newer(const struct stat *a, const struct stat *b) {
+  return a->st_mtim.tv_sec != b->st_mtim.tv_sec ? a->st_mtim.tv_sec > b->st_mtim.tv_sec
+      : a->st_mtim.tv_nsec > b->st_mtim.tv_nsec;
+}
+
+static bool binary(struct cond *c, const char *op, size_t l, size_t r) {
+  if (c->skip)
+    return false;
+  char *left = word(c, l);
+  bool result = false;
+  if (c->tokens && (strcmp(op, "=") == 0 || strcmp(op, "==") == 0 || strcmp(op, "!=") == 0)) {
+    char *pattern = expand_pattern(tokens_get_raw(c->tokens, r));
+    struct glob_pattern *g = glob_pattern_new(pattern);
+    result = glob_pattern_match(g, left) == (op[0] != '!');
+    glob_pattern_free(g);
+    free(pattern);
+    free(left);
+    return result;
+  }
+  if (strcmp(op, "=~") == 0) {
+    result = regex_match(c, left, r);
+    free(left);
+    return result;
+  }
+
+  char *right = word(c, r);
+  long long a, b;
+  if (op[0] != '-') {
+    int cmp = strcmp(left, right);
+    result = op[0] == '!' ? cmp != 0 : op[0] == '<' ? cmp < 0 : op[0] == '>' ? cmp > 0 : cmp == 0;
+  } else if (strcmp(op, "-nt") == 0 || strcmp(op, "-ot") == 0 || strcmp(op, "-ef") == 0) {
+    const struct stat *st = file_stat(c, left, false);
+    struct stat ls = st ? *st : (struct stat) {0};
+    bool lok = st != NULL;
+    const struct stat *rs = file_stat(c, right, false);
+    if (op[1] == 'e')
+      result = lok && rs && ls.st_dev == rs->st_dev && ls.st_ino == rs->st_ino;
+    else if (op[1] == 'n')
+      result = lok && (rs == NULL || newer(&ls, rs));
+    else
+      result = rs && (!lok || newer(rs, &ls));
+  } else if (integer(c, left, &a) && integer(c, right, &b)) {
+    switch (op[1] == 'e' ? 0 : op[1] == 'n' ? 1 : op[2] == 't' ? 2 : 3) {
+    case 0: result = a == b; break;
+    case 1: result = a != b; break;
+    case 2: result = op[1] == 'l' ? a < b : a > b; break;
+    case 3: result = op[1] == 'l' ? a <= b : a >= b; break;
+    }
+  }
+  free(left);
+  free(right);
+  return result;
+}
+
+static bool or_expr(struct cond *c);
+
+static bool primary(struct cond *c) {
+  size_t left = c->end - c->pos;
+  const char *op;
+  if (left == 0) {
+    error(c, "argument expected");
+    return false;
+  }
+  if (is_op(c, 0, "(") && !(left >= 3 && binary_op(c, 1))) {
+    c->pos++;
+    bool value = or_expr(c);
+    if (!is_op(c, 0, ")")) {
+      error(c, "`)' expected");
+      return false;
+    }
+    c->pos++;
+    return value;
+  }
+  if (left >= 3 && (op = binary_op(c, 1)) != NULL) {
+    bool value = binary(c, op, c->pos, c->pos + 2);
+    c->pos += 3;
+    return value;
+  }
+  if (left >= 2 && (op = unary_op(c, 0)) != NULL) {
+    char *arg = word(c, c->pos + 1);
+    bool value = !c->skip && unary(c, op, arg);
+    free(arg);
+    c->pos += 2;
+    return value;
+  }
+  char *w = word(c, c->pos++);
+  bool value = w[0] != '\0';
+  free(w);
+  return value;
+}
+
+static bool not_expr(struct cond *c) {
+  if (is_op(c, 0, "!") && !(c->end - c->pos >= 3 && binary_op(c, 1))) {
+    c->pos++;
+    return !not_expr(c);
+  }
+  return primary(c);
+}
+
+/* One side of && (-a) or || (-o); the other is only looked at when it decides. */
+static bool and_expr(struct cond *c) {
+  const char *and = c->tokens ? "&&" : "-a";
+  bool value = not_expr(c);
+  while (!c->failed && is_op(c, 0, and)) {
+    c->pos++;
+    bool skip = c->skip;
+    c->skip |= !value;
+    bool right = not_expr(c);
+    c->skip = skip;
+    value = value && right;
+  }
+  return value;
+}
+
+static bool or_expr(struct cond *c) {
+  const char *or = c->tokens ? "||" : "-o";
+  bool value = and_expr(c);
+  while (!c->failed && is_op(c, 0, or)) {
+    c->pos++;
+    bool skip = c->skip;
+    c->skip |= value;
+    bool right = and_expr(c);
+    c->skip = skip;
+    value = value || right;
+  }
+  return value;
+}
+
+static bool whole(struct cond *c) {
+  bool value = or_expr(c);
+  if (!c->failed && c->pos < c->end)
+    error(c, "%s: unexpected argument", c->tokens ? tokens_get_raw(c->tokens, c->pos) : c->argv[c->pos]);
+  return value;
+}
+
+/* test with up to four arguments is read by their number first, as POSIX says, so that
+ * [ "$a" = ! ] and [ ! = x ] mean what they look like. */
+static bool posix(struct cond *c) {
+  char **argv = c->argv + c->pos;
+  const char *op;
+  switch (c->end - c->pos) {
+  case 0:
+    return false;
+  case 1:
+    return argv[0][0] != '\0';
+  case 2:
+    if (is_op(c, 0, "!"))
+      return argv[1][0] == '\0';
+    if (unary_op(c, 0) == NULL) {
+      error(c, "%s: unary operator expected", argv[0]);
+      return false;
+    }
+    break;
+  case 3:
+    if ((op = binary_op(c, 1)) != NULL)
+      return binary(c, op, c->pos, c->pos + 2);
+    if (is_op(c, 0, "!")) {
+      c->pos++;
+      return !posix(c);
+    }
+    if (is_op(c, 0, "(") && is_op(c, 2, ")"))
+      return argv[1][0] != '\0';
+    break;
+  case 4:
+    if (is_op(c, 0, "!")) {
+      c->pos++;
+      return !posix(c);
+    }
+    if (is_op(c, 0, "(") && is_op(c, 3, ")")) {
+      c->pos++;
+      c->end--;
+      return posix(c);
+    }
+    break;
+  }
+  return whole(c);
+}
+
+static int finish(struct cond *c, bool value) {
+  for (size_t i = 0; i < STAT_CACHE; i++)
+    free(c->cache[i].path);
+  return c->failed ? 2 : value ? 0 : 1;
+}
+
+int cmd_test(struct tokens *tokens) {
+  size_t len = tokens_get_length(tokens);
+  char *argv[len + 1];
+  for (size_t i = 0; i < len; i++)
+    argv[i] = tokens_get_token(tokens, i);
+  struct cond c = {.name = argv[0], .argv = argv, .pos = 1, .end = len};
+  if (strcmp(argv[0], "[") == 0) {
+    if (len < 2 || strcmp(argv[len - 1], "]") != 0) {
+      fprintf(stderr, "[: missing ]\n");
+      return 2;
+    }
+    c.end--;
+  }
+  return finish(&c, posix(&c));
+}
+
+size_t test_command_words(struct tokens *tokens, size_t i) {
+  size_t len = tokens_get_length(tokens);
+  if (i >= len || !tokens_is_op(tokens, i, "[["))
+    return 0;
+  for (size_t j = i + 1; j < len; j++)
+    if (tokens_is_op(tokens, j, "]]"))
+      return j - i + 1;
+  return 0;
+}
+
+int test_command(struct tokens *tokens, size_t i, size_t n) {
+  struct cond c = {.name = "[[", .tokens = tokens, .pos = i + 1, .end = i + n - 1};
+  bool value = false;
+  if (c.pos == c.end)
+    error(&c, "expression expected");
+  else
+    value = whole(&c);
+  return finish(&c, value);
+}
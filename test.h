@@ -0,0 +1,18 @@
+#pragma once
+
+#include <stddef.h>
+#include "tokenizer.h"
+
+/* test and [ ... ]: file tests, string and integer comparisons, ! ( ) -a -o, with the
+ * POSIX rules for how one to four arguments are read. 0 true, 1 false, 2 on an error.
+ * A file named more than once in an expression is stat()ed once. */
+int cmd_test(struct tokens *tokens);
+
+/* How many words the [[ ... ]] command starting at word i takes, 0 if none starts there. */
+size_t test_command_words(struct tokens *tokens, size_t i);
+
+/* Runs the [[ ... ]] that is words i to i + n - 1, as written: operands are expanded
+ * without splitting or globbing only when they are used, == and != match the right side
+ * as a pattern, =~ as an extended regex (groups go to BASH_REMATCH), -eq and the like
+ * compare arithmetic, and && || ! ( ) group. */
+int test_command(struct tokens *tokens, size_t i, size_t n);
@@ -3,15 +3,22 @@
 #include <string.h>
 #include "tokenizer.h"
 #include <stdio.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define TOKENS_HAVE_X86 1
+#endif
+
 struct tokens {
   size_t tokens_length;
   char **tokens;
-  size_t buffers_length;
-  char **buffers;
+  size_t raws_length;
+  char **raws; /* source text of quoted words, NULL where it equals the word */
 };
 
 static void *vector_push(char ***pointer, size_t *size, void *elem) {
-  *pointer = (char**) realloc(*pointer, sizeof(char *) * (*size + 1));
+  /* Capacity is the next power of two, so only grow when size hits one. */
+  if ((*size & (*size - 1)) == 0)
+    *pointer = (char**) realloc(*pointer, sizeof(char *) * (*size ? *size * 2 : 1));
   (*pointer)[*size] = elem;
   *size += 1;
   return elem;
@@ -20,33 +27,240 @@ static void *vector_push(char ***pointer, size_t *size, void *elem) {
 static void *copy_word(char *source, size_t n) {
   source[n] = '\0';
   char *word = (char *) malloc(n + 1);
-  strncpy(word, source, n + 1);
+  memcpy(word, source, n + 1);
   return word;
 }
 
+/* Ends the current word: the cooked text, and the raw one only if it had quoting in it. */
+static void push_word(struct tokens *tokens, char *token, size_t n,
+    const char *line, int start, size_t end, int quoted) {
+  vector_push(&tokens->tokens, &tokens->tokens_length, copy_word(token, n));
+  vector_push(&tokens->raws, &tokens->raws_length,
+      quoted ? strndup(line + start, end - start) : NULL);
+}
+
+/* A byte tokenize() has to look at: whitespace, a quote, a backslash, or the '(' of a
+ * $( and a backquote, which keep a command substitution in one word.
+ * Everything else is copied into the current word unchanged. */
+static inline int is_special(unsigned char c) {
+  return c == ' ' || (c >= '\t' && c <= '\r') || c == '\'' || c == '"' || c == '\\' ||
+    c == '(' || c == '`';
+}
+
+/* Scanners return the length of the run of plain bytes at the start of s. */
+static size_t scan_plain_scalar(const char *s, size_t n) {
+  size_t i = 0;
+  while (i < n && !is_special((unsigned char) s[i]))
+    i++;
+  return i;
+}
+
+#ifdef TOKENS_HAVE_X86
+__attribute__((target("sse2")))
+static size_t scan_plain_sse2(const char *s, size_t n) {
+  const __m128i space = _mm_set1_epi8(' ');
+  const __m128i squote = _mm_set1_epi8('\'');
+  const __m128i dquote = _mm_set1_epi8('"');
+  const __m128i backslash = _mm_set1_epi8('\\');
+  const __m128i paren = _mm_set1_epi8('(');
+  const __m128i backquote = _mm_set1_epi8('`');
+  const __m128i tab = _mm_set1_epi8('\t');
+  const __m128i ctl_span = _mm_set1_epi8('\r' - '\t');
+  size_t i = 0;
+  for (; i + 16 <= n; i += 16) {
+    __m128i v = _mm_loadu_si128((const __m128i *) (s + i));
+    /* '\t'..'\r' is a contiguous range: (v - '\t') <= 4 as unsigned. */
+    __m128i ctl = _mm_sub_epi8(v, tab);
+    __m128i hit = _mm_cmpeq_epi8(_mm_min_epu8(ctl, ctl_span), ctl);
+    hit = _mm_or_si128(hit, _mm_cmpeq_epi8(v, space));
+    hit = _mm_or_si128(hit, _mm_cmpeq_epi8(v, squote));
+    hit = _mm_or_si128(hit, _mm_cmpeq_epi8(v, dquote));
+    hit = _mm_or_si128(hit, _mm_cmpeq_epi8(v, backslash));
+    hit = _mm_or_si128(hit, _mm_cmpeq_epi8(v, paren));
+    hit = _mm_or_si128(hit, _mm_cmpeq_epi8(v, backquote));
+    unsigned int mask = _mm_movemask_epi8(hit);
+    if (mask)
+      return i + __builtin_ctz(mask);
+  }
+  return i + scan_plain_scalar(s + i, n - i);
+}
+
+__attribute__((target("avx2")))
+static size_t scan_plain_avx2(const char *s, size_t n) {
+  const __m256i space = _mm256_set1_epi8(' ');
+  const __m256i squote = _mm256_set1_epi8('\'');
+  const __m256i dquote = _mm256_set1_epi8('"');
+  const __m256i backslash = _mm256_set1_epi8('\\');
+  const __m256i paren = _mm256_set1_epi8('(');
+  const __m256i backquote = _mm256_set1_epi8('`');
+  const __m256i tab = _mm256_set1_epi8('\t');
+  const __m256i ctl_span = _mm256_set1_epi8('\r' - '\t');
+  size_t i = 0;
+  for (; i + 32 <= n; i += 32) {
+    __m256i v = _mm256_loadu_si256((const __m256i *) (s + i));
+    __m256i ctl = _mm256_sub_epi8(v, tab);
+    __m256i hit = _mm256_cmpeq_epi8(_mm256_min_epu8(ctl, ctl_span), ctl);
+    hit = _mm256_or_si256(hit, _mm256_cmpeq_epi8(v, space));
+    hit = _mm256_or_si256(hit, _mm256_cmpeq_epi8(v, squote));
+    hit = _mm256_or_si256(hit, _mm256_cmpeq_epi8(v, dquote));
+    hit = _mm256_or_si256(hit, _mm256_cmpeq_epi8(v, backslash));
+    hit = _mm256_or_si256(hit, _mm256_cmpeq_epi8(v, paren));
+    hit = _mm256_or_si256(hit, _mm256_cmpeq_epi8(v, backquote));
+    unsigned int mask = (unsigned int) _mm256_movemask_epi8(hit);
+    if (mask)
+      return i + __builtin_ctz(mask);
+  }
+  /* The tail runs legacy SSE code; clear the upper halves first. */
+  _mm256_zeroupper();
+  return i + scan_plain_sse2(s + i, n - i);
+}
+#endif
+
+static size_t scan_plain_auto(const char *s, size_t n);
+
+/* The scanner in use; resolved on the first call to tokenize(). */
+static size_t (*scan_plain)(const char *s, size_t n) = scan_plain_auto;
+
+int tokens_set_scanner(enum tokens_scanner which) {
+  switch (which) {
+  case TOKENS_SCAN_AUTO:
+#ifdef TOKENS_HAVE_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+      scan_plain = scan_plain_avx2;
+    else if (__builtin_cpu_supports("sse2"))
+      scan_plain = scan_plain_sse2;
+    else
+#endif
+      scan_plain = scan_plain_scalar;
+    return 0;
+  case TOKENS_SCAN_SCALAR:
+    scan_plain = scan_plain_scalar;
+    return 0;
+#ifdef TOKENS_HAVE_X86
+  case TOKENS_SCAN_SSE2:
+    __builtin_cpu_init();
+    if (!__builtin_cpu_supports("sse2"))
+      return -1;
+    scan_plain = scan_plain_sse2;
+    return 0;
+  case TOKENS_SCAN_AVX2:
+    __builtin_cpu_init();
+    if (!__builtin_cpu_supports("avx2"))
+      return -1;
+    scan_plain = scan_plain_avx2;
+    return 0;
+#endif
+  default:
+    return -1;
+  }
+}
+
+static size_t scan_plain_auto(const char *s, size_t n) {
+  tokens_set_scanner(TOKENS_SCAN_AUTO);
+  return scan_plain(s, n);
+}
+
+/* Index of the byte ending the quote or substitution that opens at s[i]: the closing
+ * quote, backquote or ')' of $(, or n - 1 if it is never closed. */
+static size_t skip_quoted(const char *s, size_t i, size_t n) {
+  char open = s[i];
+  int depth = 1;
+  for (size_t j = i + 1; j < n; j++) {
+    char c = s[j];
+    if (c == '\\' && open != '\'') {
+      j++;
+    } else if (open == '(') {
+      if (c == '\'' || c == '"' || c == '`')
+        j = skip_quoted(s, j, n);
+      else if (c == '(')
+        depth++;
+      else if (c == ')' && --depth == 0)
+        return j;
+    } else if (c == open) {
+      return j;
+    } else if (open == '"' && c == '(' && j > 0 && s[j - 1] == '$') {
+      j = skip_quoted(s, j, n);
+    }
+  }
+  return n - 1;
+}
+
+size_t tokens_subst_end(const char *s, size_t i, size_t n) {
+  return skip_quoted(s, i, n);
+}
+
+size_t tokens_command_end(const char *line, size_t start) {
+  size_t n = strlen(line);
+  for (size_t i = start; i < n; i++) {
+    char c = line[i];
+    if (c == ';' || c == '\n')
+      return i;
+    if (c == '\\')
+      i++;
+    else if (c == '\'' || c == '"' || c == '`' || (c == '(' && i > 0 && strchr("$<>", line[i - 1])))
+      i = skip_quoted(line, i, n);
+  }
+  return n;
+}
+
 struct tokens *tokenize(const char *line) {
   if (line == NULL) {
     return NULL;
   }
 
-  static char token[4096];
-  size_t n = 0, n_max = 4096;
+  /* Words are built here. Unquoting only ever shrinks text, so no word outgrows the
+   * line; the buffer is kept for the next call at the longest line seen. */
+  static char *token;
+  static size_t token_size;
+  size_t n = 0;
   struct tokens *tokens;
   size_t line_length = strlen(line);
+  if (line_length + 1 > token_size) {
+    token_size = line_length + 1 > 4096 ? line_length + 1 : 4096;
+    free(token);
+    token = malloc(token_size);
+  }
 
-  tokens = (struct tokens *) malloc(sizeof(struct tokens));
-  tokens->tokens_length = 0;
-  tokens->tokens = NULL;
-  tokens->buffers_length = 0;
-  tokens->buffers = NULL;
+  tokens = (struct tokens *) calloc(1, sizeof(struct tokens));
 
   const int MODE_NORMAL = 0,
         MODE_SQUOTE = 1,
         MODE_DQUOTE = 2;
   int mode = MODE_NORMAL;
+  /* Where the current word starts in line (-1 between words), and whether it was quoted,
+   * so "" is still a word and expansion can tell '$x' from $x. escaped is where in token
+   * the last backslash-escaped byte went, so \$( is not a substitution. */
+  int start = -1, quoted = 0;
+  size_t escaped = (size_t) -1;
 
   for (unsigned int i = 0; i < line_length; i++) {
+    if (start < 0 && !isspace(line[i]))
+      start = i;
+    /* Copy the run of plain bytes in one go; only specials need the state machine. */
+    size_t run = scan_plain(line + i, line_length - i);
+    if (run > 0) {
+      memcpy(token + n, line + i, run);
+      n += run;
+      i += run;
+      if (i >= line_length) break;
+    }
     char c = line[i];
+    if (c == '\'' || c == '"' || c == '\\') {
+      quoted = 1;
+    }
+    int process_sub = mode == MODE_NORMAL && c == '(' && n == 1 && (token[0] == '<' || token[0] == '>') &&
+      escaped != 0;
+    if (process_sub ||
+        (mode != MODE_SQUOTE && (c == '`' || (c == '(' && n > 0 && token[n - 1] == '$' && escaped != n - 1)))) {
+      /* A command or process substitution is kept whole, for expansion to run. */
+      size_t end = skip_quoted(line, i, line_length);
+      memcpy(token + n, line + i, end - i + 1);
+      n += end - i + 1;
+      i = end;
+      quoted = 1;
+      continue;
+    }
     if (mode == MODE_NORMAL) {
       if (c == '\'') {
         mode = MODE_SQUOTE;
@@ -54,13 +268,16 @@ struct tokens *tokenize(const char *line) {
         mode = MODE_DQUOTE;
       } else if (c == '\\') {
         if (i + 1 < line_length) {
+          escaped = n;
           token[n++] = line[++i];
         }
       } else if (isspace(c)) {
-        if (n > 0) {
-          void *word = copy_word(token, n);
-          vector_push(&tokens->tokens, &tokens->tokens_length, word);
+        if (start >= 0) {
+          push_word(tokens, token, n, line, start, i, quoted);
           n = 0;
+          start = -1;
+          quoted = 0;
+          escaped = (size_t) -1;
         }
       } else {
         token[n++] = c;
@@ -68,35 +285,38 @@ struct tokens *tokenize(const char *line) {
     } else if (mode == MODE_SQUOTE) {
       if (c == '\'') {
         mode = MODE_NORMAL;
-      } else if (c == '\\') {
-        if (i + 1 < line_length) {
-          token[n++] = line[++i];
-        }
       } else {
         token[n++] = c;
       }
     } else if (mode == MODE_DQUOTE) {
+      /* Between double quotes a backslash only quotes $ ` " \ and newline. */
       if (c == '"') {
         mode = MODE_NORMAL;
-      } else if (c == '\\') {
-        if (i + 1 < line_length) {
-          token[n++] = line[++i];
-        }
+      } else if (c == '\\' && i + 1 < line_length && strchr("$`\"\\\n", line[i + 1]) != NULL) {
+        escaped = n;
+        token[n++] = line[++i];
       } else {
         token[n++] = c;
       }
     }
-    if (n + 1 >= n_max) abort();
   }
 
-  if (n > 0) {
-    void *word = copy_word(token, n);
-    vector_push(&tokens->tokens, &tokens->tokens_length, word);
-    n = 0;
+  if (start >= 0) {
+    push_word(tokens, token, n, line, start, line_length, quoted);
   }
   return tokens;
 }
 
+struct tokens *tokens_create(void) {
+  return (struct tokens *) calloc(1, sizeof(struct tokens));
+}
+
+void tokens_append(struct tokens *tokens, const char *word, const char *raw) {
+  vector_push(&tokens->tokens, &tokens->tokens_length, strdup(word));
+  vector_push(&tokens->raws, &tokens->raws_length,
+      raw && strcmp(raw, word) != 0 ? strdup(raw) : NULL);
+}
+
 size_t tokens_get_length(struct tokens *tokens) {
   if (tokens == NULL) {
     return 0;
@@ -113,6 +333,29 @@ char *tokens_get_token(struct tokens *tokens, size_t n) {
   }
 }
 
+char *tokens_get_raw(struct tokens *tokens, size_t n) {
+  if (tokens == NULL || n >= tokens->tokens_length) {
+    return NULL;
+  }
+  return tokens->raws[n] ? tokens->raws[n] : tokens->tokens[n];
+}
+
+int tokens_is_op(struct tokens *tokens, size_t n, const char *op) {
+  return tokens != NULL && n < tokens->tokens_length && tokens->raws[n] == NULL &&
+    strcmp(tokens->tokens[n], op) == 0;
+}
+
+struct tokens *tokens_slice(struct tokens *tokens, size_t start, size_t end) {
+  struct tokens *slice = tokens_create();
+  size_t length = tokens_get_length(tokens);
+  if (end > length) {
+    end = length;
+  }
+  for (size_t i = start; i < end; i++) {
+    tokens_append(slice, tokens->tokens[i], tokens->raws[i]);
+  }
+  return slice;
+}
 
 void tokens_print(struct tokens *tokens) {
   int len = tokens_get_length(tokens);
@@ -127,12 +370,11 @@ void tokens_destroy(struct tokens *tokens) {
   }
   for (int i = 0; i < tokens->tokens_length; i++) {
     free(tokens->tokens[i]);
-  }
-  for (int i = 0; i < tokens->buffers_length; i++) {
-    free(tokens->buffers[i]);
+    free(tokens->raws[i]);
   }
   if (tokens->tokens) {
     free(tokens->tokens);
   }
+  free(tokens->raws);
   free(tokens);
 }
@@ -3,15 +3,48 @@
 /* A struct that represents a list of words. */
 struct tokens;
 
+/* Ways tokenize() can skip over runs of plain (non-space, non-quote,
+ * non-backslash, non-'(' and non-'`') bytes.  AUTO picks the widest one the CPU supports. */
+enum tokens_scanner {
+  TOKENS_SCAN_AUTO,
+  TOKENS_SCAN_SCALAR,
+  TOKENS_SCAN_SSE2,
+  TOKENS_SCAN_AVX2
+};
+
+/* Select the scanner; returns -1 if this CPU can't run it. */
+int tokens_set_scanner(enum tokens_scanner which);
+
 /* Turn a string into a list of words. */
 struct tokens *tokenize(const char *line);
 
+/* Index of the ')' closing the $( whose '(' is s[i] (or of the quote or backquote
+ * closing the one at s[i]); n - 1 if there is none. */
+size_t tokens_subst_end(const char *s, size_t i, size_t n);
+
+/* Index of the ';' or newline ending the command that starts at line[start], or the
+ * length of line; separators in quotes and substitutions don't count. */
+size_t tokens_command_end(const char *line, size_t start);
+
 /* How many words are there? */
 size_t tokens_get_length(struct tokens *tokens);
 
 /* Get me the Nth word (zero-indexed) */
 char *tokens_get_token(struct tokens *tokens, size_t n);
 
+/* Get the Nth word as it was written, quotes and backslashes included */
+char *tokens_get_raw(struct tokens *tokens, size_t n);
+
+/* Is the Nth word the unquoted operator op? ('|' quoted is just a word) */
+int tokens_is_op(struct tokens *tokens, size_t n, const char *op);
+
+/* An empty list, and adding a word to it (raw may be NULL when it equals word) */
+struct tokens *tokens_create(void);
+void tokens_append(struct tokens *tokens, const char *word, const char *raw);
+
+/* Copy words [start, end) into a new list of their own */
+struct tokens *tokens_slice(struct tokens *tokens, size_t start, size_t end);
+
 /* Free the memory */
 void tokens_destroy(struct tokens *tokens);
 
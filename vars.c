@@ -0,0 +1,393 @@
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "vars.h"
+
+/* Variables live in a chained hash table that doubles when it gets full. Exported ones
+ * also own their "NAME=value" string and remember their slot in the cached envp, so
+ * changing a value just swaps one pointer. Only exporting or unexporting a variable
+ * leaves the vector to be rebuilt on the next exec. */
+struct var {
+  char *name;
+  char *value;
+  int flags;
+  char *envstr;   /* "NAME=value" while exported */
+  long env_slot;  /* index in env_cache, -1 if not in it */
+  struct var *next;
+};
+
+static struct var **buckets;
+static size_t nbuckets, nvars;
+
+static char **env_cache;
+static size_t env_count;
+static bool env_dirty = true;
+
+static size_t vars_hash(const char *name, size_t len) {
+  size_t h = 5381;
+  for (size_t i = 0; i < len; i++)
+    h = h * 33 + (unsigned char) name[i];
+  return h;
+}
+
+static struct var *vars_find(const char *name, size_t len) {
+  if (nbuckets == 0)
+    return NULL;
+  for (struct var *v = buckets[vars_hash(name, len) & (nbuckets - 1)]; v; v = v->next)
+    if (strncmp(v->name, name, len) == 0 && v->name[len] == '\0')
+      return v;
+  return NULL;
+}
+
+static void vars_grow(void) {
+  size_t n = nbuckets ? nbuckets * 2 : 64;
+  struct var **b = calloc(n, sizeof(struct var *));
+  for (size_t i = 0; i < nbuckets; i++) {
+    for (struct var *v = buckets[i], *next; v; v = next) {
+      next = v->next;
+      size_t h = vars_hash(v->name, strlen(v->name)) & (n - 1);
+      v->next = b[h];
+      b[h] = v;
+    }
+  }
+  free(buckets);
+  buckets = b;
+  nbuckets = n;
+}
+
+/* Keeps envstr and the cached vector in step with the variable's value and flags. */
+static void vars_sync_env(struct var *v) {
+  free(v->envstr);
+  v->envstr = NULL;
+  if ((v->flags & VAR_EXPORT) && v->value) {
+    size_t n = strlen(v->name), m = strlen(v->value);
+    v->envstr = malloc(n + m + 2);
+    memcpy(v->envstr, v->name, n);
+    v->envstr[n] = '=';
+    memcpy(v->envstr + n + 1, v->value, m + 1);
+  }
+  if (v->env_slot >= 0 && v->envstr && !env_dirty)
+    env_cache[v->env_slot] = v->envstr;
+  else if (v->env_slot >= 0 || v->envstr)
+    env_dirty = true;
+}
+
+void vars_init(char **envp) {
+  for (; envp && *envp; envp++) {
+    char *eq = strchr(*envp, '=');
+    if (eq == NULL)
+      continue;
+    char name[eq - *envp + 1];
+    memcpy(name, *envp, eq - *envp);
+    name[eq - *envp] = '\0';
+    vars_set(name, eq + 1, VAR_EXPORT);
+  }
+}
+
+const char *vars_get(const char *name) {
+  struct var *v = vars_find(name, strlen(name));
+  return v ? v->value : NULL;
+}
+
+int vars_set(const char *name, const char *value, int flags) {
+  size_t len = strlen(name);
+  struct var *v = vars_find(name, len);
+  if (v && (v->flags & VAR_READONLY) && value)
+    return -1;
+  if (v == NULL) {
+    if (nvars >= nbuckets)
+      vars_grow();
+    v = calloc(1, sizeof(struct var));
+    v->name = strdup(name);
+    v->env_slot = -1;
+    size_t h = vars_hash(name, len) & (nbuckets - 1);
+    v->next = buckets[h];
+    buckets[h] = v;
+    nvars++;
+  }
+  if (value) {
+    char *copy = strdup(value);
+    free(v->value);
+    v->value = copy;
+  }
+  v->flags |= flags;
+  vars_sync_env(v);
+  return 0;
+}
+
+int vars_unset(const char *name) {
+  size_t len = strlen(name);
+  if (nbuckets == 0)
+    return 0;
+  struct var **slot = &buckets[vars_hash(name, len) & (nbuckets - 1)];
+  while (*slot && strcmp((*slot)->name, name) != 0)
+    slot = &(*slot)->next;
+  struct var *v = *slot;
+  if (v == NULL)
+    return 0;
+  if (v->flags & VAR_READONLY)
+    return -1;
+  if (v->env_slot >= 0)
+    env_dirty = true;
+  *slot = v->next;
+  nvars--;
+  free(v->name);
+  free(v->value);
+  free(v->envstr);
+  free(v);
+  return 0;
+}
+
+/* What local replaced, to be put back when the function returns. */
+struct saved_var {
+  char *name;
+  char *value;  /* NULL if it was unset */
+  int flags;
+};
+
+struct scope {
+  struct saved_var *vars;
+  size_t n, cap;
+};
+
+static struct scope *scopes;
+static size_t nscopes, scopes_cap;
+
+void vars_push_scope(void) {
+  if (nscopes == scopes_cap) {
+    scopes_cap = scopes_cap ? scopes_cap * 2 : 8;
+    scopes = realloc(scopes, scopes_cap * sizeof(struct scope));
+  }
+  scopes[nscopes++] = (struct scope) {NULL, 0, 0};
+}
+
+void vars_pop_scope(void) {
+  struct scope *scope = &scopes[--nscopes];
+  for (size_t i = scope->n; i-- > 0; ) {
+    struct saved_var *saved = &scope->vars[i];
+    struct var *v = vars_find(saved->name, strlen(saved->name));
+    if (v)
+      v->flags &= ~VAR_READONLY; /* readonly inside the function doesn't outlive it */
+    if (saved->value) {
+      vars_set(saved->name, saved->value, 0);
+      v = vars_find(saved->name, strlen(saved->name));
+      v->flags = saved->flags;
+      vars_sync_env(v);
+    } else {
+      vars_unset(saved->name);
+    }
+    free(saved->name);
+    free(saved->value);
+  }
+  free(scope->vars);
+}
+
+int vars_local(const char *name, const char *value) {
+  if (nscopes == 0)
+    return -1;
+  struct scope *scope = &scopes[nscopes - 1];
+  struct var *v = vars_find(name, strlen(name));
+  if (v && (v->flags & VAR_READONLY))
+    return -1;
+  bool known = false;
+  for (size_t i = 0; i < scope->n && !known; i++)
+    known = strcmp(scope->vars[i].name, name) == 0;
+  if (!known) {
+    if (scope->n == scope->cap) {
+      scope->cap = scope->cap ? scope->cap * 2 : 4;
+      scope->vars = realloc(scope->vars, scope->cap * sizeof(struct saved_var));
+    }
+    scope->vars[scope->n++] = (struct saved_var) {
+      strdup(name), v && v->value ? strdup(v->value) : NULL, v ? v->flags : 0};
+  }
+  if (value)
+    vars_set(name, value, 0);
+  return 0;
+}
+
+int vars_array_set(const char *name, size_t index, const char *value) {
+  char element[strlen(name) + 24];
+  sprintf(element, "%s[%zu]", name, index);
+  return vars_set(element, value, 0);
+}
+
+const char *vars_array_get(const char *name, size_t index) {
+  char element[strlen(name) + 24];
+  sprintf(element, "%s[%zu]", name, index);
+  return vars_get(element);
+}
+
+size_t vars_array_length(const char *name) {
+  size_t n = 0;
+  while (vars_array_get(name, n) != NULL)
+    n++;
+  return n;
+}
+
+void vars_array_truncate(const char *name, size_t length) {
+  char element[strlen(name) + 24];
+  for (size_t i = length;; i++) {
+    sprintf(element, "%s[%zu]", name, i);
+    if (vars_get(element) == NULL || vars_unset(element) == -1)
+      break;
+  }
+}
+
+bool vars_is_assignment(const char *s, size_t *name_len) {
+  if (!(isalpha((unsigned char) s[0]) || s[0] == '_'))
+    return false;
+  size_t i = 1;
+  while (isalnum((unsigned char) s[i]) || s[i] == '_')
+    i++;
+  if (s[i] != '=')
+    return false;
+  if (name_len)
+    *name_len = i;
+  return true;
+}
+
+char **vars_envp(void) {
+  if (!env_dirty)
+    return env_cache;
+  size_t n = 0;
+  for (size_t i = 0; i < nbuckets; i++)
+    for (struct var *v = buckets[i]; v; v = v->next)
+      n += v->envstr != NULL;
+  env_cache = realloc(env_cache, (n + 1) * sizeof(char *));
+  env_count = 0;
+  for (size_t i = 0; i < nbuckets; i++) {
+    for (struct var *v = buckets[i]; v; v = v->next) {
+      v->env_slot = v->envstr ? (long) env_count : -1;
+      if (v->envstr)
+        env_cache[env_count++] = v->envstr;
+    }
+  }
+  env_cache[env_count] = NULL;
+  env_dirty = false;
+  return env_cache;
+}
+
+char **vars_envp_with(char **assigns, size_t n) {
+  char **base = vars_envp();
+  if (n == 0)
+    return base;
+  char **env = malloc((env_count + n + 1) * sizeof(char *));
+  memcpy(env, base, env_count * sizeof(char *));
+  size_t count = env_count;
+  for (size_t i = 0; i < n; i++) {
+    size_t len;
+    if (!vars_is_assignment(assigns[i], &len))
+      continue;
+    struct var *v = vars_find(assigns[i], len);
+    if (v && v->env_slot >= 0) {
+      env[v->env_slot] = assigns[i];
+      continue;
+    }
+    /* A name not in the environment yet; a later assignment to it wins. */
+    size_t j = env_count;
+    while (j < count && strncmp(env[j], assigns[i], len + 1) != 0)
+      j++;
+    env[j] = assigns[i];
+    if (j == count)
+      count++;
+  }
+  env[count] = NULL;
+  return env;
+}
+
+/* Prints every variable with flag set, in a form the shell can read back. */
+static void vars_print(const char *cmd, int flag) {
+  for (size_t i = 0; i < nbuckets; i++) {
+    for (struct var *v = buckets[i]; v; v = v->next) {
+      if (!(v->flags & flag))
+        continue;
+      if (v->value == NULL) {
+        printf("%s %s\n", cmd, v->name);
+        continue;
+      }
+      printf("%s %s=\"", cmd, v->name);
+      for (const char *p = v->value; *p; p++) {
+        if (*p == '"' || *p == '\\')
+          putchar('\\');
+        putchar(*p);
+      }
+      printf("\"\n");
+    }
+  }
+}
+
+/* Shared by export and readonly: NAME or NAME=value arguments get flag. */
+static int vars_flag_builtin(struct tokens *tokens, const char *cmd, int flag) {
+  size_t len = tokens_get_length(tokens);
+  if (len == 1) {
+    vars_print(cmd, flag);
+    return 0;
+  }
+  int status = 0;
+  for (size_t i = 1; i < len; i++) {
+    char *arg = tokens_get_token(tokens, i);
+    size_t name_len;
+    int rc;
+    if (vars_is_assignment(arg, &name_len)) {
+      char name[name_len + 1];
+      memcpy(name, arg, name_len);
+      name[name_len] = '\0';
+      rc = vars_set(name, arg + name_len + 1, flag);
+    } else if (isalpha((unsigned char) arg[0]) || arg[0] == '_') {
+      rc = vars_set(arg, NULL, flag);
+    } else {
+      fprintf(stderr, "%s: %s: not a valid identifier\n", cmd, arg);
+      status = 1;
+      continue;
+    }
+    if (rc == -1) {
+      fprintf(stderr, "%s: %s: readonly variable\n", cmd, arg);
+      status = 1;
+    }
+  }
+  return status;
+}
+
+int cmd_export(struct tokens *tokens) {
+  return vars_flag_builtin(tokens, "export", VAR_EXPORT);
+}
+
+int cmd_readonly(struct tokens *tokens) {
+  return vars_flag_builtin(tokens, "readonly", VAR_READONLY);
+}
+
+int cmd_unset(struct tokens *tokens) {
+  int status = 0;
+  for (size_t i = 1; i < tokens_get_length(tokens); i++) {
+    if (vars_unset(tokens_get_token(tokens, i)) == -1) {
+      fprintf(stderr, "unset: %s: readonly variable\n", tokens_get_token(tokens, i));
+      status = 1;
+    }
+  }
+  return status;
+}
+
+int cmd_local(struct tokens *tokens) {
+  if (nscopes == 0) {
+    fprintf(stderr, "local: not in a function\n");
+    return 1;
+  }
+  int status = 0;
+  for (size_t i = 1; i < tokens_get_length(tokens); i++) {
+    char *arg = tokens_get_token(tokens, i);
+    size_t name_len = strlen(arg);
+    bool assign = vars_is_assignment(arg, &name_len);
+    char name[name_len + 1];
+    memcpy(name, arg, name_len);
+    name[name_len] = '\0';
+    if (!assign && !(isalpha((unsigned char) arg[0]) || arg[0] == '_')) {
+      fprintf(stderr, "local: %s: not a valid identifier\n", arg);
+      status = 1;
+    } else if (vars_local(name, assign ? arg + name_len + 1 : NULL) == -1) {
+      fprintf(stderr, "local: %s: readonly variable\n", name);
+      status = 1;
+    }
+  }
+  return status;
+}
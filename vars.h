@@ -0,0 +1,52 @@
+#pragma once
+
+#include <stdbool.h>
+#include <stddef.h>
+#include "tokenizer.h"
+
+/* Variable flags */
+#define VAR_EXPORT 1
+#define VAR_READONLY 2
+
+/* Loads the process environment as exported variables. */
+void vars_init(char **envp);
+
+/* Value of a variable, or NULL if unset. */
+const char *vars_get(const char *name);
+
+/* Sets a variable and ORs flags into its flags; value NULL keeps the current value (for
+ * export NAME). Returns -1 without changing anything if it is readonly. */
+int vars_set(const char *name, const char *value, int flags);
+
+/* Removes a variable. Returns -1 if it is readonly. */
+int vars_unset(const char *name);
+
+/* Whether s is NAME=value with a valid name; *name_len gets the name's length. */
+bool vars_is_assignment(const char *s, size_t *name_len);
+
+/* Arrays (what mapfile makes) are variables NAME[0], NAME[1]... up to the first one
+ * unset. set returns -1 for a readonly element; truncate unsets the ones from length on. */
+int vars_array_set(const char *name, size_t index, const char *value);
+const char *vars_array_get(const char *name, size_t index);
+size_t vars_array_length(const char *name);
+void vars_array_truncate(const char *name, size_t length);
+
+/* Function scopes: local saves a variable's value and flags in the innermost scope, and
+ * popping the scope puts them back. vars_local() returns -1 outside a function or for a
+ * readonly variable; value NULL keeps the current value. */
+void vars_push_scope(void);
+void vars_pop_scope(void);
+int vars_local(const char *name, const char *value);
+
+/* The environment for exec: "NAME=value" for every exported variable. The vector is kept
+ * between calls and only patched or rebuilt when an exported variable changes. */
+char **vars_envp(void);
+
+/* vars_envp() with NAME=value assignments layered on top, for VAR=x cmd. Meant to be
+ * called in the child right before exec; the base vector is copied, not rebuilt. */
+char **vars_envp_with(char **assigns, size_t n);
+
+int cmd_export(struct tokens *tokens);
+int cmd_unset(struct tokens *tokens);
+int cmd_readonly(struct tokens *tokens);
+int cmd_local(struct tokens *tokens);
@@ -0,0 +1,272 @@
+#define _GNU_SOURCE
+#include <errno.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "arith.h"
+#include "bytecode.h"
+#include "cmdsub.h"
+#include "expand.h"
+#include "func.h"
+#include "glob.h"
+#include "output.h"
+#include "redir.h"
+#include "shell.h"
+#include "spawn.h"
+#include "stats.h"
+#include "test.h"
+#include "vars.h"
+
+/* A loop's status and the words a for loop goes through, or a case's subject. */
+struct slot {
+  int status;
+  struct tokens *words;
+  bool own_words; /* words aren't the program's own */
+  size_t next;
+  char *subject;
+};
+
+/* Redirections applied around a compound command. */
+struct applied {
+  struct tokens *words;
+  bool own_words;
+  struct redir_plan plan;
+  struct redir_saved saved;
+};
+
+/* A function, a builtin, or a program for OP_SPAWN or when there's neither by that
+ * name. Functions are looked up either way, since they can be defined after the
+ * command was compiled. */
+static int call(enum opcode op, struct tokens *words) {
+  if (tokens_get_length(words) == 0)
+    return 0;
+  struct function *f = func_lookup(tokens_get_token(words, 0));
+  if (f != NULL)
+    return func_call(f, words);
+  fun_desc_t *builtin = op == OP_BUILTIN ? lookup(tokens_get_token(words, 0)) : NULL;
+  if (builtin == NULL) {
+    int status = runMyProgram(words);
+    return status < 0 ? 1 : status;
+  }
+  uint64_t started = stats_clock();
+  int status = builtin->fun(words);
+  stats_builtin(builtin->cmd, started);
+  return status < 0 ? 1 : status;
+}
+
+static bool matches(struct program *prog, uint32_t pattern, const char *subject) {
+  if (prog->patterns[pattern])
+    return glob_pattern_match(prog->patterns[pattern], subject);
+  char *text = expand_pattern(prog->strings[pattern]);
+  struct glob_pattern *compiled = glob_pattern_new(text);
+  bool matched = glob_pattern_match(compiled, subject);
+  glob_pattern_free(compiled);
+  free(text);
+  return matched;
+}
+
+/* ( list ): a fork of the shell runs the list, already compiled, and exits. In an
+ * interactive shell it is a job of its own: its own process group, given the terminal
+ * while it runs, which the programs it starts stay in. */
+static int subshell(struct program *body) {
+  bool interactive = shell_is_interactive;
+  pid_t pid = spawn_fork();
+  if (pid == -1) {
+    fprintf(stderr, "fork: %s\n", strerror(errno));
+    return 1;
+  }
+  if (pid == 0) {
+    if (interactive)
+      setpgid(0, 0);
+    cmdsub_process_inherit();
+    shell_is_interactive = false;
+    int status = bytecode_run(body);
+    out_flush();
+    _exit(status & 0xff);
+  }
+  if (interactive) {
+    signal(SIGTTOU, SIG_IGN); /* to take the terminal back from the background */
+    setpgid(pid, pid);
+    tcsetpgrp(0, pid);
+  }
+  int wstatus;
+  while (waitpid(pid, &wstatus, WUNTRACED) == -1 && errno == EINTR)
+    ;
+  if (interactive)
+    tcsetpgrp(0, getpid());
+  if (WIFSTOPPED(wstatus))
+    return 128 + WSTOPSIG(wstatus);
+  return WIFSIGNALED(wstatus) ? 128 + WTERMSIG(wstatus) : WEXITSTATUS(wstatus);
+}
+
+/* The words of the simple stages are expanded here, as exeTokens() would. */
+static int pipeline(struct program *prog, const struct insn *in) {
+  size_t subs = cmdsub_process_mark();
+  struct tokens *words = expand_words(prog->cmds[in->a]);
+  int status = 1;
+  if (words != NULL) {
+    size_t len = tokens_get_length(words);
+    int pipes[len], npipes = 0;
+    for (size_t i = 0; i < len; i++)
+      if (tokens_is_op(words, i, "|"))
+        pipes[npipes++] = i;
+    status = makePipes(words, pipes, npipes, prog->bodies + in->b);
+    if (words != prog->cmds[in->a])
+      tokens_destroy(words);
+  }
+  cmdsub_process_done(subs);
+  return status;
+}
+
+int bytecode_run(struct program *prog) {
+  struct slot *slots = calloc(prog->nslots + 1, sizeof(struct slot));
+  struct applied *applied = malloc((prog->nredirs + 1) * sizeof(struct applied));
+  size_t napplied = 0;
+  struct tokens *cmd = NULL, *words = NULL;
+  size_t subs = 0;
+
+  for (size_t pc = 0; pc < prog->ncode; ) {
+    const struct insn *in = &prog->code[pc++];
+    struct slot *slot = in->a < prog->nslots ? &slots[in->a] : NULL;
+    struct applied *r;
+    switch ((enum opcode) in->op) {
+    case OP_RUN:
+      exeTokens(prog->cmds[in->a]);
+      if (func_returning)
+        pc = prog->ncode;
+      break;
+    case OP_EXPAND:
+      cmd = prog->cmds[in->a];
+      subs = cmdsub_process_mark();
+      words = in->b ? cmd : expand_words(cmd);
+      if (words == NULL) {
+        cmdsub_process_done(subs);
+        shell_last_status = 1;
+        pc++;
+      }
+      break;
+    case OP_BUILTIN:
+    case OP_SPAWN:
+      shell_last_status = call(in->op, words);
+      if (words != cmd)
+        tokens_destroy(words);
+      cmdsub_process_done(subs);
+      if (func_returning)
+        pc = prog->ncode;
+      break;
+    case OP_JUMP:
+      pc = in->a;
+      break;
+    case OP_JUMP_FALSE:
+      if (shell_last_status != 0)
+        pc = in->a;
+      break;
+    case OP_JUMP_TRUE:
+      if (shell_last_status == 0)
+        pc = in->a;
+      break;
+    case OP_STATUS:
+      shell_last_status = in->a;
+      break;
+    case OP_SAVE:
+      slot->status = shell_last_status;
+      break;
+    case OP_LOOP_INIT:
+      slot->status = 0;
+      if (in->b == BYTECODE_NONE)
+        break;
+      if (slot->own_words)
+        tokens_destroy(slot->words);
+      subs = cmdsub_process_mark();
+      slot->words = expand_words(prog->cmds[in->b]);
+      slot->own_words = slot->words != NULL && slot->words != prog->cmds[in->b];
+      slot->next = 0;
+      cmdsub_process_done(subs);
+      if (slot->words == NULL)
+        slot->status = 1;
+      break;
+    case OP_FOR_NEXT:
+      if (slot->words == NULL || slot->next == tokens_get_length(slot->words)) {
+        pc = in->c;
+      } else if (vars_set(prog->strings[in->b],
+            tokens_get_token(slot->words, slot->next++), 0) == -1) {
+        fprintf(stderr, "%s: readonly variable\n", prog->strings[in->b]);
+        slot->status = 1;
+        pc = in->c;
+      }
+      break;
+    case OP_LOOP_END:
+      shell_last_status = slot->status;
+      break;
+    case OP_CASE:
+      free(slot->subject);
+      slot->subject = expand_string(prog->strings[in->b]);
+      break;
+    case OP_MATCH:
+      if (matches(prog, in->b, slot->subject))
+        pc = in->c;
+      break;
+    case OP_REDIR:
+      r = &applied[napplied];
+      r->words = expand_words(prog->cmds[in->a]);
+      r->own_words = r->words != prog->cmds[in->a];
+      if (r->words != NULL && redir_plan(r->words, &r->plan) == 0) {
+        if (redir_apply_saved(&r->plan, &r->saved) == 0) {
+          napplied++;
+          break;
+        }
+        redir_restore(&r->saved);
+        redir_plan_free(&r->plan);
+      }
+      if (r->words != NULL && r->own_words)
+        tokens_destroy(r->words);
+      shell_last_status = 1;
+      pc = in->b;
+      break;
+    case OP_DEFINE:
+      func_define(prog->strings[in->b], prog->bodies[in->a]);
+      shell_last_status = 0;
+      break;
+    case OP_ARITH:
+      shell_last_status = arith_command(prog->strings[in->a], in->b);
+      break;
+    case OP_TEST:
+      cmd = prog->cmds[in->a];
+      shell_last_status = test_command(cmd, 0, tokens_get_length(cmd));
+      break;
+    case OP_SUBSHELL:
+      shell_last_status = subshell(prog->bodies[in->a]);
+      break;
+    case OP_PIPE:
+      shell_last_status = pipeline(prog, in);
+      break;
+    case OP_UNREDIR:
+      r = &applied[--napplied];
+      redir_restore(&r->saved);
+      redir_plan_free(&r->plan);
+      if (r->own_words)
+        tokens_destroy(r->words);
+      break;
+    }
+  }
+
+  /* return leaves redirections of the compound commands it was in */
+  while (napplied > 0) {
+    struct applied *r = &applied[--napplied];
+    redir_restore(&r->saved);
+    redir_plan_free(&r->plan);
+    if (r->own_words)
+      tokens_destroy(r->words);
+  }
+  for (size_t i = 0; i < prog->nslots; i++) {
+    if (slots[i].own_words)
+      tokens_destroy(slots[i].words);
+    free(slots[i].subject);
+  }
+  free(slots);
+  free(applied);
+  return shell_last_status;
+}